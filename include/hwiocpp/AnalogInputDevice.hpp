@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_ANALOGINPUTDEVICE_HPP
+#define HWIOCPP_ANALOGINPUTDEVICE_HPP
+
+#include <stdint.h>
+
+// Common channel-read interface of ADCs. Analog sensors should depend on it instead of
+// a specific ADC class, so they can work with any of them
+class AnalogInputDevice
+{
+public:
+    virtual ~AnalogInputDevice() = default;
+
+    // @brief Gets amount of single-ended channels
+    virtual uint8_t getChannelsCount() const = 0;
+
+    // @brief Gets a single-ended ADC reading from the specified channel
+    // @param channel
+    // @return the ADC reading
+    virtual int16_t readSingleChannel(uint8_t channel) = 0;
+
+    // @brief Converts ADC reading to volts
+    // @param counts the ADC reading in raw counts
+    // @return the ADC reading in volts
+    virtual float computeVolts(int16_t counts) = 0;
+};
+
+#endif // HWIOCPP_ANALOGINPUTDEVICE_HPP
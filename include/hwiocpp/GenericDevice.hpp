@@ -5,8 +5,10 @@
 #ifndef HWIOCPP_GENERICDEVICE_HPP
 #define HWIOCPP_GENERICDEVICE_HPP
 
+#include "utils/ByteOrder.hpp"
 #include <stdint.h>
 #include <vector>
+#include <time.h>
 
 #define INVALID_FD              (-1)
 
@@ -15,19 +17,22 @@
 #define GET_BYTE2(_val)         (((_val) >> 16) & 0xFF)
 #define GET_BYTE3(_val)         (((_val) >> 24) & 0xFF)
 
-typedef unsigned char  byte;
+// waits shorter than this are done by spinning after waking up from sleep (can be changed by calibration)
+#define DEFAULT_SPIN_THRESHOLD_NS   (50000)
 
-enum class Endianness
+// Overshoot statistics of deadline based waits (in nanoseconds)
+struct TimingStats
 {
-    BIG,
-    LITTLE,
-    NATIVE
+    uint64_t waitsCount = 0;
+    uint64_t totalOvershoot = 0;
+    uint64_t maxOvershoot = 0;
+    uint64_t lastOvershoot = 0;
 };
 
 class GenericDevice
 {
 public:
-    GenericDevice();
+    GenericDevice() = default;
     virtual ~GenericDevice() = default;
 
     // virtual bool openDevice() = 0;
@@ -35,23 +40,36 @@ public:
     virtual bool isDeviceOpen() = 0;
 
     static void wait(const unsigned int milliseconds);
+    static void waitUs(const unsigned int microseconds);
+    static void waitNs(const uint64_t nanoseconds);
+    // Waits until absolute CLOCK_MONOTONIC deadline. Sleeps with clock_nanosleep(TIMER_ABSTIME) and
+    // spins for the last part of the wait (see DEFAULT_SPIN_THRESHOLD_NS).
+    // Returns overshoot in nanoseconds
+    static uint64_t waitUntil(const struct timespec& deadline);
+
+    static struct timespec getMonotonicTime();
+    static struct timespec addNanoseconds(const struct timespec& base, const uint64_t nanoseconds);
+    static int64_t diffNanoseconds(const struct timespec& end, const struct timespec& start);
+
+    // Measures sleep wake up latency and speed of busy loops. Is called automatically on first wait,
+    // but can be called again manually (for example after changing CPU frequency governor or thread priority)
+    static void calibrateTiming();
+    static uint64_t getSpinThreshold();
+    static TimingStats getTimingStats();
+    static void resetTimingStats();
     static double remap(double value, double oldMin, double oldMax, double newMin, double newMax);
 
-    inline Endianness getNativeBytesOrder() const;
-    uint16_t normalizeBytes(const uint16_t value, const Endianness expectedOrder);
-    uint32_t normalizeBytes(const uint32_t value, const Endianness expectedOrder);
-    // returns pointer to a buffer with normalized bytes
-    // NOTE: do not free this pointer!
-    // NOTE: this function is NOT tread-safe!
-    const byte* normalizeBytes(const byte* buffer, const size_t bytesCount, const Endianness expectedOrder);
+    static constexpr Endianness getNativeBytesOrder();
+    static inline uint16_t normalizeBytes(const uint16_t value, const Endianness expectedOrder);
+    static inline uint32_t normalizeBytes(const uint32_t value, const Endianness expectedOrder);
+    // Reverses buffer in place if expectedOrder doesn't match native bytes order
+    static inline void normalizeBytes(byte* buffer, const size_t bytesCount, const Endianness expectedOrder);
+    // Returns buffer itself if bytes order matches. Otherwise returns reversed copy stored in scratch buffer
+    template <size_t LocalSize>
+    static inline const byte* normalizeBytes(const byte* buffer, const size_t bytesCount, const Endianness expectedOrder, ScratchBuffer<LocalSize>& scratch);
 
     // virtual int read();
     // virtual int write();
-
-private:
-    // int mFD = INVALID_FD;
-    Endianness mNativeBytesOrder;
-    std::vector<byte> mBuffer;// used for bytes order normalization
 };
 
 // inline bool DeviceI2C::isDeviceOpen()
@@ -59,9 +77,43 @@ private:
 //     return mFD != INVALID_FD;
 // }
 
-inline Endianness GenericDevice::getNativeBytesOrder() const
+constexpr Endianness GenericDevice::getNativeBytesOrder()
+{
+    return HWIOCPP_NATIVE_BYTES_ORDER;
+}
+
+inline uint16_t GenericDevice::normalizeBytes(const uint16_t value, const Endianness expectedOrder)
+{
+    return toBytesOrder(value, expectedOrder);
+}
+
+inline uint32_t GenericDevice::normalizeBytes(const uint32_t value, const Endianness expectedOrder)
 {
-    return mNativeBytesOrder;
+    return toBytesOrder(value, expectedOrder);
+}
+
+inline void GenericDevice::normalizeBytes(byte* buffer, const size_t bytesCount, const Endianness expectedOrder)
+{
+    if (true == isByteSwapNeeded(expectedOrder))
+    {
+        reverseBytes(buffer, bytesCount);
+    }
+}
+
+template <size_t LocalSize>
+inline const byte* GenericDevice::normalizeBytes(const byte* buffer, const size_t bytesCount, const Endianness expectedOrder, ScratchBuffer<LocalSize>& scratch)
+{
+    const byte* result = buffer;
+
+    if (true == isByteSwapNeeded(expectedOrder))
+    {
+        byte* outBuffer = scratch.get(bytesCount);
+
+        reverseBytes(outBuffer, buffer, bytesCount);
+        result = outBuffer;
+    }
+
+    return result;
 }
 
 #endif // HWIOCPP_GENERICDEVICE_HPP
\ No newline at end of file
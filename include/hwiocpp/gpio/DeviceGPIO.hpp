@@ -6,10 +6,12 @@
 #define HWIOCPP_GPIO_DEVICEGPIO_HPP
 
 #include "GenericDevice.hpp"
+#include "utils/TimerWheel.hpp"
 #include <string>
 #include <map>
 #include <memory>
 #include <thread>
+#include <mutex>
 #include <functional>
 #include <gpiod.h>
 
@@ -126,7 +128,8 @@ enum class GPIO_PIN_MODE
     INPUT = 1,
     OUTPUT = 2,
     EDGE_DETECTION = 3,
-    AS_IS = 3
+    AS_IS = 3,
+    OPEN_DRAIN = 4// output which is only driven low. writing 1 releases the line
 };
 
 enum class GPIO_PIN_EDGE_EVENT
@@ -139,7 +142,20 @@ enum class GPIO_PIN_EDGE_EVENT
 using GpioPinsGroupID_t = int;
 #define INVALID_GPIO_GROUP_ID           (-1)
 
+// Memory mapped registers of a single pin (see DeviceGPIO::getPinRegisters())
+struct GpioPinRegisters
+{
+    volatile uint32_t* set = nullptr;// GPSETn
+    volatile uint32_t* clear = nullptr;// GPCLRn
+    volatile uint32_t* level = nullptr;// GPLEVn
+    volatile uint32_t* function = nullptr;// GPFSELn
+    uint32_t mask = 0;
+    uint32_t functionShift = 0;// position of pin function bits in GPFSELn
+};
+
 using EdgeEventCallback_t = std::function<void(const RP_GPIO, const GPIO_PIN_EDGE_EVENT)>;
+// timestamp is provided by the kernel at the moment of the edge (CLOCK_MONOTONIC on Linux 5.7+)
+using TimestampedEdgeEventCallback_t = std::function<void(const RP_GPIO, const GPIO_PIN_EDGE_EVENT, const struct timespec&)>;
 
 class DeviceGPIO: public GenericDevice
 {
@@ -155,6 +171,8 @@ class DeviceGPIO: public GenericDevice
         struct gpiod_line* line = nullptr;
         GPIO_PIN_MODE mode = GPIO_PIN_MODE::UNKNOWN;
         GPIO_PIN_PULL pull = GPIO_PIN_PULL::DISABLE;
+        // edge events were requested for this line. monitoring continues while its direction is temporarily changed
+        bool monitored = false;
     };
 
 public:
@@ -187,6 +205,18 @@ public:
     bool getGroupValues(const GpioPinsGroupID_t id, std::vector<int>& outValues);
 
     void shiftWrite(const byte value, const RP_GPIO dataPin, const RP_GPIO clockPin, const RP_GPIO latchPin);
+    // Minimal time between signal changes in bit-banged protocols (0 - as fast as possible)
+    inline void setBitBangHalfPeriod(const unsigned int nanoseconds);
+
+    // Timed actions. They are executed by the library-wide TimerWheel thread and are canceled when device is closed.
+    // NOTE: DeviceGPIO is not thread-safe. Don't access pins used by timed actions until they are finished
+    // Sets pin value now and restores opposite value after durationMs
+    TimerID_t pulsePin(const RP_GPIO pin, const int value, const unsigned int durationMs);
+    TimerID_t setPinValueDelayed(const RP_GPIO pin, const int value, const unsigned int delayMs);
+    // Sets pin to 1 and then toggles it every periodMs. Stops after togglesCount toggles (0 - run until canceled)
+    TimerID_t togglePin(const RP_GPIO pin, const unsigned int periodMs, const unsigned int togglesCount = 0);
+    bool cancelTimedAction(const TimerID_t id);
+    void cancelAllTimedActions();
 
     bool openPin(const RP_GPIO pin, const GPIO_PIN_MODE direction, const GPIO_PIN_PULL pullMode = GPIO_PIN_PULL::AS_IS);
     bool openPin(const RP_GPIO pin, const GPIO_PIN_PULL pullMode = GPIO_PIN_PULL::AS_IS);
@@ -194,15 +224,27 @@ public:
     void closeAllPins();
 
     void registerEdgeEventsCallback(const EdgeEventCallback_t& callback);
+    void registerTimestampedEdgeEventsCallback(const TimestampedEdgeEventCallback_t& callback);
     void unregisterEdgeEventsCallback();
 
     // void stopEdgeEventsMonitorining(const RP_GPIO pin);
     // void stopEdgeEventsMonitorining(const GpioPinsGroupID_t groupID);
 
 protected:
+    // starts a timer which will be canceled when device is closed
+    TimerID_t startTimedAction(const unsigned int delayMs, const TimerCallback_t& callback, const unsigned int periodMs = 0);
+
     bool startEdgeEventsMonitorining(const RP_GPIO pin);
     void startEdgeEventsMonitorining(const GpioPinsGroupID_t groupID);
 
+    // Returns libgpiod line of an opened pin (or nullptr). Can be used to skip pins lookup in time critical code
+    struct gpiod_line* getPinLine(const RP_GPIO pin) const;
+
+    // Direct access to GPIO registers (BCM2835/BCM2711 gpiochip0 only). Returns false if registers can't be used
+    bool getPinRegisters(const RP_GPIO pin, GpioPinRegisters& outRegisters);
+
+    // Reconfigures an already opened pin. Switching an edge monitored pin to output and back to EDGE_DETECTION
+    // keeps edge monitoring thread running
     bool changePinDirection(const RP_GPIO pin, const GPIO_PIN_MODE direction);
     bool changePinPullMode(const RP_GPIO pin, const GPIO_PIN_PULL pullMode);
     bool changeGroupDirection(const GpioPinsGroupID_t id, const GPIO_PIN_MODE direction);
@@ -211,6 +253,11 @@ protected:
     bool gpio_set_pull(const int gpio, const GPIO_PIN_PULL type);
 
     void threadEdgeMonitoring();
+    // interrupts edge events waiting so that monitoring thread picks up changes in mActiveLines
+    void wakeEdgeMonitoring();
+    inline bool hasEdgeEventsCallback() const;
+
+    static volatile uint32_t* getGpioRegistersBase();
 
 private:
     static std::map<std::string, GpioChipInfo> sOpenChips;
@@ -218,13 +265,30 @@ private:
     std::string mChipName;
     struct gpiod_chip *mChip = nullptr;
     std::map<RP_GPIO, GpioLineInfo> mActiveLines;
+    // protects mActiveLines and lines requests. shared with edge monitoring thread
+    mutable std::recursive_mutex mLinesSync;
     std::map<GpioPinsGroupID_t, std::vector<RP_GPIO>> mGroupPins;
     std::map<GpioPinsGroupID_t, struct gpiod_line_bulk> mGroups;
     GpioPinsGroupID_t mNextID = 1;
 
+    std::vector<TimerID_t> mTimedActions;
+    unsigned int mBitBangHalfPeriod = 0;
+
     EdgeEventCallback_t mEdgeCallback;
+    TimestampedEdgeEventCallback_t mTimestampedEdgeCallback;
     std::thread mMonitoringThread;
     bool mIsMonitoring = false;
+    int mMonitoringWakeFD = -1;
 };
 
+inline bool DeviceGPIO::hasEdgeEventsCallback() const
+{
+    return (mEdgeCallback || mTimestampedEdgeCallback);
+}
+
+inline void DeviceGPIO::setBitBangHalfPeriod(const unsigned int nanoseconds)
+{
+    mBitBangHalfPeriod = nanoseconds;
+}
+
 #endif // HWIOCPP_GPIO_DEVICEGPIO_HPP
\ No newline at end of file
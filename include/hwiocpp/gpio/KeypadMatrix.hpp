@@ -19,7 +19,26 @@ enum class KeypadEvent
     KEY_RELEASED
 };
 
+// key code is an index of the key in the keypad: row * cols + col
+using KeypadKeyCode_t = int;
+#define INVALID_KEYPAD_KEY_CODE         (-1)
+
+struct KeypadKeyEvent
+{
+    KeypadEvent event = KeypadEvent::UNKNOWN;
+    int x = -1;
+    int y = -1;
+    KeypadKeyCode_t keyCode = INVALID_KEYPAD_KEY_CODE;
+    // points to an entry in the keys table owned by KeypadMatrix (never nullptr).
+    // NOTE: valid only until next call to setKeymapping()
+    const std::string* key = nullptr;
+};
+
+// NOTE: key string references an entry in the keys table owned by KeypadMatrix. Copy it if it's needed after callback returns
 using KeypadCallback_t = std::function<void(const KeypadEvent, const int, const int, const std::string&)>;
+// receives all key events detected during a single scan. events buffer is owned by KeypadMatrix
+using KeypadBatchCallback_t = std::function<void(const KeypadKeyEvent*, const size_t)>;
+// <<x, y>, key>
 using KeypadKeyMap_t = std::map<std::pair<int, int>, std::string>;
 
 class KeypadMatrix: protected DeviceGPIO
@@ -29,19 +48,45 @@ public:
 
     bool initialize(const std::vector<RP_GPIO>& rowPins, const std::vector<RP_GPIO>& colPins, const KeypadCallback_t& keyEventFunc);
     void setKeymapping(const KeypadKeyMap_t& mapping);
+    void setBatchEventsCallback(const KeypadBatchCallback_t& callback);
+
+    inline KeypadKeyCode_t getKeyCode(const int x, const int y) const;
+    const std::string& getKey(const KeypadKeyCode_t keyCode) const;
 
 private:
     bool hasKeyPressed() const;
+    // converts key mapping to a flat table indexed by key code
+    void compileKeymapping();
 
     void onPinEdgeEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT event);
 
 private:
     KeypadCallback_t mOnKeyEventCallback;
+    KeypadBatchCallback_t mOnBatchEventsCallback;
     std::vector<RP_GPIO> mRowPins;
     std::vector<RP_GPIO> mColPins;
-    KeypadKeyMap_t mKeys;
+    KeypadKeyMap_t mKeyMapping;
+    std::vector<std::string> mKeys;// indexed by key code
     GpioPinsGroupID_t mColsGroupID;
     matrix<bool> mKeysState;
+    matrix<bool> mPrevKeysState;
+
+    // preallocated buffers to avoid allocations during scan
+    std::vector<KeypadKeyEvent> mEventsBuffer;
+    std::vector<int> mColValues;
+    std::vector<int> mColValuesLow;
 };
 
+inline KeypadKeyCode_t KeypadMatrix::getKeyCode(const int x, const int y) const
+{
+    KeypadKeyCode_t keyCode = INVALID_KEYPAD_KEY_CODE;
+
+    if ((x >= 0) && (y >= 0) && (static_cast<size_t>(x) < mColPins.size()) && (static_cast<size_t>(y) < mRowPins.size()))
+    {
+        keyCode = y * mColPins.size() + x;
+    }
+
+    return keyCode;
+}
+
 #endif // HWIOCPP_GPIO_KEYPADMATRIX_HPP
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_GPIO_ONEWIRE_HPP
+#define HWIOCPP_GPIO_ONEWIRE_HPP
+
+#include "DeviceGPIO.hpp"
+#include <vector>
+
+// 64bit ROM code. Family code is in the lowest byte, CRC in the highest
+using OneWireRom_t = uint64_t;
+#define ONEWIRE_ROM_FAMILY(_rom)        static_cast<byte>((_rom) & 0xFF)
+
+#define ONEWIRE_CMD_SEARCH_ROM          (0xF0)
+#define ONEWIRE_CMD_ALARM_SEARCH        (0xEC)
+#define ONEWIRE_CMD_MATCH_ROM           (0x55)
+#define ONEWIRE_CMD_SKIP_ROM            (0xCC)
+
+// Dallas 1-Wire bus master (standard speed) on a single open-drain GPIO pin.
+// Bus requires an external pull-up resistor (usually 4.7k).
+//
+// Slot timings are aligned to absolute deadlines (see GenericDevice::waitUntil()). On BCM2835/BCM2711
+// line is switched directly through GPIO registers, otherwise libgpiod open-drain line is used.
+// For reliable communication on a loaded system, run the thread which uses the bus with real-time priority.
+//
+// NOTE: not thread-safe
+class OneWire: protected DeviceGPIO
+{
+public:
+    virtual ~OneWire() = default;
+
+    bool initialize(const RP_GPIO pin, const GPIO_PIN_PULL pullMode = GPIO_PIN_PULL::AS_IS);
+    void close();
+
+    // Sends reset pulse. Returns true if at least one device responded with presence pulse
+    bool reset();
+
+    void writeBit(const int value);
+    int readBit();
+    void writeByte(const byte value);
+    byte readByte();
+    void write(const byte* buffer, const size_t size);
+    void read(byte* buffer, const size_t size);
+
+    // Reset + ROM selection. Following commands will be handled only by selected device
+    bool select(const OneWireRom_t rom);
+    // Reset + Skip ROM. Following commands will be handled by all devices on the bus
+    bool selectAll();
+
+    // Finds ROM codes of all devices on the bus (or only devices with alarm flag set).
+    // If familyCode is not 0 only devices of that family are returned
+    bool search(std::vector<OneWireRom_t>& outRoms, const byte familyCode = 0, const bool alarmOnly = false);
+
+    static byte crc8(const byte* data, const size_t size);
+
+private:
+    void busLow();
+    void busRelease();
+    int busRead();
+
+private:
+    struct gpiod_line* mLine = nullptr;
+    GpioPinRegisters mRegisters;
+    bool mUseRegisters = false;
+};
+
+#endif // HWIOCPP_GPIO_ONEWIRE_HPP
@@ -7,6 +7,9 @@
 
 #include "DeviceGPIO.hpp"
 #include <vector>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 enum class RelayNormalState
 {
@@ -14,19 +17,138 @@ enum class RelayNormalState
     NORMALLY_CLOSED
 };
 
+#define RELAY_ZERO_CROSS_TIMEOUT_MS         (100)
+
+// All relays are controlled as a single pins group. Current pins state is cached, so writes
+// which don't change anything never reach the kernel.
+//
+// Switching of AC loads can be synchronized with mains using a zero-cross detector connected to
+// one of the GPIO pins. Outputs are written directly from the edge monitoring thread at a fixed
+// offset after the kernel timestamp of the zero crossing.
 class Relay: protected DeviceGPIO
 {
 public:
     virtual ~Relay();
 
     bool initialize(const std::vector<RP_GPIO>& pins, const std::vector<RelayNormalState>& pinStates, const bool initiallyOpen = true);
+
+    // NOTE: these functions also commit all previously staged changes
     bool openRelay(const int index);
     bool closeRelay(const int index);
     bool setRelayValue(const int index, const bool closed);
+    // Sets relay value now and restores previous value after durationMs (using TimerWheel)
+    TimerID_t setRelayValueFor(const int index, const bool valueOpen, const unsigned int durationMs);
+    bool cancelRelayTimeout(const TimerID_t id);
+
+    // Queue relay state change. Changes are applied by commitRelayValues()
+    bool stageRelayValue(const int index, const bool valueOpen);
+    // Apply all staged changes with a single group write (or several writes if energizing spacing is enabled)
+    bool commitRelayValues();
+    // Revert staged changes which were not committed yet
+    void discardStagedValues();
+
+    // Limit inrush current for large relay banks. Relay coils are energized one by one with at least
+    // 'milliseconds' between them. De-energizing is never delayed.
+    // energizedPinValue - pin value which powers relay coil (depends on relay module)
+    // Set milliseconds to 0 to disable
+    void setEnergizeSpacing(const unsigned int milliseconds, const int energizedPinValue = 1);
+
+    // Use zero-cross detector connected to pin. Only events of the specified edge are used
+    // (GPIO_PIN_EDGE_EVENT::UNKNOWN - both edges).
+    // offsetUs - delay between zero crossing and output write (can be used to compensate relay operate time)
+    bool bindZeroCrossDetector(const RP_GPIO pin,
+                               const GPIO_PIN_EDGE_EVENT edge,
+                               const unsigned int offsetUs = 0,
+                               const GPIO_PIN_PULL pullMode = GPIO_PIN_PULL::AS_IS);
+    void unbindZeroCrossDetector();
+    void setZeroCrossOffset(const unsigned int offsetUs);
+
+    // Apply staged changes at the next zero crossing. If waitForCommit is true, blocks until changes are
+    // applied or timeout expires (in which case changes stay staged and false is returned).
+    // If energizing spacing is enabled, one relay is energized at each of the following zero crossings
+    // (timeout should be long enough for that)
+    bool commitRelayValuesOnZeroCross(const bool waitForCommit = true,
+                                      const unsigned int timeoutMs = RELAY_ZERO_CROSS_TIMEOUT_MS);
+
+    // Phase-angle control (for outputs driving a triac or SSR without zero-cross circuit).
+    // After every zero crossing output is activated for pulseUs microseconds with delayUs delay.
+    // Set delayUs to 0 to disable phase control for the output.
+    // NOTE: outputs under phase control should not be changed using other functions
+    bool setPhaseAngleControl(const int index, const unsigned int delayUs, const unsigned int pulseUs = 100);
+
+private:
+    int toPinValue(const int index, const bool valueOpen) const;
+    // Copies staged values for applying. Returns sequence number of the commit.
+    // NOTE: must be called with mSync locked
+    uint64_t snapshotStagedValues(std::vector<int>& outValues);
+    // NOTE: must be called with mWriteSync locked
+    bool writeRelayValues(const bool isEnergizing);
+    // Applies values and waits until all relays are energized. Must be called without holding mSync
+    bool applyStagedValues(const std::vector<int>& stagedValues, const uint64_t sequence);
+    // Writes all changes which don't energize relays or energizes the next relay (if energizing spacing
+    // has passed). outNextStepTime - when the next energizing step can be done
+    bool applyNextStep(const std::vector<int>& stagedValues,
+                       const uint64_t sequence,
+                       bool& outIsDone,
+                       std::chrono::steady_clock::time_point& outNextStepTime);
+
+    void onZeroCrossEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT event, const struct timespec& timestamp);
+    void runPhaseAngleControl(const struct timespec& timestamp);
+    void updatePhaseEdges();
 
 private:
     std::vector<RP_GPIO> mControlPins;
     std::vector<RelayNormalState> mPinNormalStates;
+    GpioPinsGroupID_t mRelaysGroup = INVALID_GPIO_GROUP_ID;
+
+    std::vector<int> mPinValues;// current pins state (-1 if unknown)
+    std::vector<int> mStagedValues;
+    std::vector<int> mCommittedValues;// staged values of the last commit (restored by discardStagedValues)
+    std::vector<int> mWriteValues;
+    uint64_t mStageSequence = 0;// incremented for every commit (protected by mSync)
+    uint64_t mAppliedSequence = 0;// latest commit which was started (protected by mWriteSync)
+
+    unsigned int mEnergizeSpacing = 0;
+    int mEnergizedPinValue = 1;
+    std::chrono::steady_clock::time_point mLastEnergizeTime;
+
+    struct PhaseControl
+    {
+        int index = 0;
+        unsigned int delay = 0;
+        unsigned int pulse = 0;
+    };
+
+    struct PhaseEdge
+    {
+        unsigned int time = 0;// microseconds since zero crossing
+        int index = 0;
+        bool activate = false;
+    };
+
+    RP_GPIO mZeroCrossPin = RP_GPIO::UNKNOWN;
+    GPIO_PIN_EDGE_EVENT mZeroCrossEdge = GPIO_PIN_EDGE_EVENT::UNKNOWN;
+    unsigned int mZeroCrossOffset = 0;
+    bool mZeroCrossCommitPending = false;
+    bool mZeroCrossCommitResult = false;
+    uint64_t mZeroCrossCommitId = 0;// identifies pending commit request
+    uint64_t mZeroCrossActiveId = 0;// commit which is being applied by edge monitoring thread (0 - none)
+    uint64_t mZeroCrossSequence = 0;
+    std::vector<PhaseControl> mPhaseControl;
+    std::vector<PhaseEdge> mPhaseEdges;// sorted by time
+
+    // copies of staged values and phase edges used by edge monitoring thread (so that it doesn't
+    // hold mSync while waiting for write time)
+    std::vector<int> mZeroCrossValues;
+    std::vector<int> mZeroCrossBaseValues;
+    std::vector<PhaseEdge> mZeroCrossPhaseEdges;
+
+    // protects staged values and configuration
+    std::mutex mSync;
+    // serializes pins writes. protects mPinValues, mWriteValues and energizing state. Is never held
+    // while waiting for energizing spacing
+    std::mutex mWriteSync;
+    std::condition_variable mZeroCrossCommitDone;
 };
 
-#endif // HWIOCPP_GPIO_RELAY_HPP
\ No newline at end of file
+#endif // HWIOCPP_GPIO_RELAY_HPP
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_GPIO_SOFTWARESPI_HPP
+#define HWIOCPP_GPIO_SOFTWARESPI_HPP
+
+#include "DeviceGPIO.hpp"
+#include "spi/DeviceSPI.hpp"
+
+// Bit-banged SPI master on arbitrary GPIO pins.
+//
+// Pins are resolved once in initialize(). On BCM2835/BCM2711 clock and data lines are driven by
+// writing directly to GPSET/GPCLR registers (through /dev/gpiomem), which allows multi-megabit rates.
+// On other chips pre-resolved libgpiod lines are used.
+//
+// NOTE: not thread-safe
+class SoftwareSPI: protected DeviceGPIO
+{
+    struct SpiPin
+    {
+        struct gpiod_line* line = nullptr;
+        GpioPinRegisters registers;
+    };
+
+public:
+    virtual ~SoftwareSPI() = default;
+
+    // misoPin and csPin can be RP_GPIO::UNKNOWN if they are not used
+    // speedHz - clock frequency (0 - as fast as possible)
+    bool initialize(const RP_GPIO sclkPin,
+                    const RP_GPIO mosiPin,
+                    const RP_GPIO misoPin,
+                    const RP_GPIO csPin,
+                    const SpiMode mode = SpiMode::MODE_0,
+                    const SpiBitOrder bitOrder = SpiBitOrder::MSB_FIRST,
+                    const unsigned int speedHz = 0);
+    void close();
+
+    void setMode(const SpiMode mode);
+    inline void setBitOrder(const SpiBitOrder bitOrder);
+    void setSpeed(const unsigned int speedHz);
+    inline bool isUsingRegisters() const;
+
+    // Full-duplex transfer. txBuffer or rxBuffer can be nullptr (zeros are sent if txBuffer is nullptr).
+    // Chip select is asserted during transfer unless beginTransaction() was called before
+    bool transfer(const byte* txBuffer, byte* rxBuffer, const size_t size);
+    inline bool write(const byte* buffer, const size_t size);
+    inline bool read(byte* buffer, const size_t size);
+
+    // Keeps chip select asserted for multiple transfers
+    bool beginTransaction();
+    void endTransaction();
+
+private:
+    bool resolvePin(const RP_GPIO pin, SpiPin& outPin);
+    void setChipSelect(const bool active);
+
+    template <typename Pins>
+    void transferBytes(const Pins& pins, const byte* txBuffer, byte* rxBuffer, const size_t size);
+
+private:
+    SpiPin mSclk;
+    SpiPin mMosi;
+    SpiPin mMiso;
+    SpiPin mCs;
+    bool mHasMiso = false;
+    bool mHasCs = false;
+    bool mUseRegisters = false;
+    bool mInTransaction = false;
+
+    int mIdleClock = 0;// CPOL
+    bool mSampleOnTrailingEdge = false;// CPHA
+    SpiBitOrder mBitOrder = SpiBitOrder::MSB_FIRST;
+    unsigned int mHalfPeriodNs = 0;
+};
+
+inline void SoftwareSPI::setBitOrder(const SpiBitOrder bitOrder)
+{
+    mBitOrder = bitOrder;
+}
+
+inline bool SoftwareSPI::isUsingRegisters() const
+{
+    return mUseRegisters;
+}
+
+inline bool SoftwareSPI::write(const byte* buffer, const size_t size)
+{
+    return transfer(buffer, nullptr, size);
+}
+
+inline bool SoftwareSPI::read(byte* buffer, const size_t size)
+{
+    return transfer(nullptr, buffer, size);
+}
+
+#endif // HWIOCPP_GPIO_SOFTWARESPI_HPP
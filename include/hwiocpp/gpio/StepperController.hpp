@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_GPIO_STEPPERCONTROLLER_HPP
+#define HWIOCPP_GPIO_STEPPERCONTROLLER_HPP
+
+#include "DeviceGPIO.hpp"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+using StepperID_t = int;
+#define INVALID_STEPPER_ID                  (-1)
+
+#define STEPPER_DEFAULT_PULSE_NS            (2000)// DRV8825 needs 1.9 us, A4988 - 1 us
+#define STEPPER_DEFAULT_DIR_SETUP_NS        (1000)// delay between DIR change and next STEP pulse
+#define STEPPER_DEFAULT_COALESCE_NS         (5000)// steps of different motors closer than this are written together
+#define STEPPER_LATE_STEP_NS                (20000)// step is counted as late if it was written this much after its deadline
+
+enum class MotionProfile
+{
+    TRAPEZOID,// constant acceleration
+    S_CURVE// acceleration changes smoothly (smoothstep velocity ramp), no jerk spikes at ramp start/end
+};
+
+struct StepperConfig
+{
+    RP_GPIO stepPin = RP_GPIO::UNKNOWN;
+    RP_GPIO dirPin = RP_GPIO::UNKNOWN;
+    RP_GPIO enablePin = RP_GPIO::UNKNOWN;// optional
+    bool enableActiveLow = true;
+    bool invertDirection = false;
+    double maxSpeed = 1000.0;// steps/s
+    double acceleration = 5000.0;// steps/s^2 (peak acceleration for S_CURVE)
+    MotionProfile profile = MotionProfile::TRAPEZOID;
+};
+
+struct StepperStats
+{
+    uint64_t stepsGenerated = 0;
+    uint64_t groupWrites = 0;// every group write can contain steps of multiple motors
+    uint64_t lateSteps = 0;// written more than STEPPER_LATE_STEP_NS after deadline
+    uint64_t maxLatency = 0;// nanoseconds
+};
+
+// completed is false if move was aborted by stopMotor()
+using StepperMoveCallback_t = std::function<void(const StepperID_t id, const int64_t position, const bool completed)>;
+
+// Step/dir stepper motor drivers (A4988, DRV8825, TMC2208 in step/dir mode, etc.).
+//
+// When a move is requested, acceleration ramp is precomputed in the calling thread. Step pulses of all motors
+// are generated by a single dedicated thread (HwioThread::STEPPER_MOTION) which waits for absolute deadlines, so
+// timing error doesn't accumulate. Steps of different motors which are due at (almost) the same time are written
+// with a single GPSET/GPCLR register write on BCM2835/BCM2711 (libgpiod lines are used on other chips).
+//
+// NOTE: motors must be added before start(). Use ThreadPolicyManager to give motion thread real-time priority
+class StepperController: protected DeviceGPIO
+{
+    // Precomputed velocity profile of a single move
+    struct MotionPlan
+    {
+        bool forward = true;
+        uint64_t totalSteps = 0;
+        std::vector<uint32_t> ramp;// intervals (ns) of acceleration steps. deceleration uses them in reverse order
+        uint32_t cruiseInterval = 0;// ns
+    };
+
+    struct Motor
+    {
+        StepperConfig config;
+        struct gpiod_line* stepLine = nullptr;
+        struct gpiod_line* dirLine = nullptr;
+        GpioPinRegisters stepRegisters;
+
+        std::atomic<int64_t> position{0};
+        std::atomic<bool> isMoving{false};
+
+        // pending command (protected by mSync)
+        std::unique_ptr<MotionPlan> pendingPlan;
+        bool stopRequested = false;
+        bool decelerateOnStop = false;
+
+        // motion thread state
+        std::unique_ptr<MotionPlan> plan;
+        uint64_t stepIndex = 0;
+        struct timespec nextStep = {0, 0};
+        int dirValue = -1;
+        bool isAborted = false;
+    };
+
+public:
+    StepperController() = default;
+    virtual ~StepperController();
+
+    bool initialize(const RP_GPIOCHIP chip = RP_GPIOCHIP::GPIOCHIP0);
+    StepperID_t addMotor(const StepperConfig& config);
+
+    // Starts motion thread
+    bool start();
+    // Stops motion thread. Active moves are aborted
+    void stop();
+    inline bool isRunning() const;
+
+    bool setMaxSpeed(const StepperID_t id, const double stepsPerSecond);
+    bool setAcceleration(const StepperID_t id, const double stepsPerSecond2);
+    bool setProfile(const StepperID_t id, const MotionProfile profile);
+    bool setEnabled(const StepperID_t id, const bool enabled);
+    // Steps of different motors closer than this are written together
+    inline void setCoalesceWindow(const unsigned int nanoseconds);
+    inline void setStepPulseWidth(const unsigned int nanoseconds);
+
+    // Moves are only accepted when motor is idle
+    bool moveTo(const StepperID_t id, const int64_t position);
+    bool move(const StepperID_t id, const int64_t steps);
+    // Aborts current move. If decelerate is true motor follows deceleration ramp before stopping
+    bool stopMotor(const StepperID_t id, const bool decelerate = true);
+
+    int64_t getPosition(const StepperID_t id) const;
+    bool setPosition(const StepperID_t id, const int64_t position);
+    bool isMoving(const StepperID_t id) const;
+    // Returns false if move didn't finish in timeoutMs (0 - wait forever)
+    bool waitMoveComplete(const StepperID_t id, const unsigned int timeoutMs = 0);
+
+    // Callback is executed in motion thread, so it must be short
+    void registerMoveCallback(const StepperMoveCallback_t& callback);
+
+    StepperStats getStats() const;
+    void resetStats();
+
+private:
+    bool isValidMotor(const StepperID_t id) const;
+    std::unique_ptr<MotionPlan> createPlan(const StepperConfig& config, const int64_t steps) const;
+    static uint32_t getStepInterval(const MotionPlan& plan, const uint64_t stepIndex);
+
+    void threadMotion();
+    bool waitForWork();
+    void applyCommands();
+    void writeSteps(const std::vector<size_t>& motors);
+    void finishMove(const size_t index, const bool completed);
+
+private:
+    std::vector<std::unique_ptr<Motor>> mMotors;
+    std::thread mThread;
+    std::atomic<bool> mIsRunning{false};
+
+    mutable std::mutex mSync;
+    std::condition_variable mCommandsCondition;
+    std::condition_variable mMoveFinishedCondition;
+    std::atomic<bool> mHasCommands{false};
+    StepperMoveCallback_t mMoveCallback;
+
+    bool mUseRegisters = false;
+    unsigned int mCoalesceWindow = STEPPER_DEFAULT_COALESCE_NS;
+    unsigned int mStepPulseWidth = STEPPER_DEFAULT_PULSE_NS;
+
+    std::vector<size_t> mDueMotors;// used by motion thread
+
+    std::atomic<uint64_t> mStepsGenerated{0};
+    std::atomic<uint64_t> mGroupWrites{0};
+    std::atomic<uint64_t> mLateSteps{0};
+    std::atomic<uint64_t> mMaxLatency{0};
+};
+
+inline bool StepperController::isRunning() const
+{
+    return mIsRunning;
+}
+
+inline void StepperController::setCoalesceWindow(const unsigned int nanoseconds)
+{
+    mCoalesceWindow = nanoseconds;
+}
+
+inline void StepperController::setStepPulseWidth(const unsigned int nanoseconds)
+{
+    mStepPulseWidth = nanoseconds;
+}
+
+#endif // HWIOCPP_GPIO_STEPPERCONTROLLER_HPP
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_GPIO_SENSORS_DHT_HPP
+#define HWIOCPP_GPIO_SENSORS_DHT_HPP
+
+#include "gpio/DeviceGPIO.hpp"
+#include <vector>
+#include <mutex>
+
+enum class DHTType
+{
+    DHT11,
+    DHT22// also AM2302
+};
+
+using DHTSensorID_t = int;
+#define INVALID_DHT_SENSOR_ID           (-1)
+
+struct SensorDataDHT
+{
+    double temperature = 0.0;// celsius
+    double humidity = 0.0;// %
+    bool valid = false;// false if sensor didn't respond or checksum didn't match
+};
+
+// DHT11/DHT22 sensors decoder.
+//
+// Host sends start pulse and then response of the sensor is captured from kernel timestamped edge events
+// (DeviceGPIO edge monitoring thread). Bits are decoded by measuring duration of high pulses, so no CPU
+// time is spent on sampling the pin. Multiple sensors (on different pins) are read at the same time.
+//
+// On BCM2835/BCM2711 start pulse is generated through GPIO registers while pin stays in edge detection
+// mode. On other chips pin is temporarily reopened as an output, which can make the first bits unreliable.
+//
+// NOTE: DHT11 must not be read more often than once per second, DHT22 - once per 2 seconds
+// NOTE: for reliable capture run edge monitoring thread with real-time priority (see ThreadPolicyManager)
+class DHT: protected DeviceGPIO
+{
+    struct EdgeInfo
+    {
+        struct timespec timestamp;
+        bool rising = false;
+    };
+
+    struct SensorInfo
+    {
+        RP_GPIO pin = RP_GPIO::UNKNOWN;
+        DHTType type = DHTType::DHT22;
+        GpioPinRegisters registers;
+        bool useRegisters = false;
+        std::vector<EdgeInfo> edges;// preallocated
+        size_t edgesCount = 0;
+    };
+
+public:
+    DHT() = default;
+    virtual ~DHT();
+
+    DHTSensorID_t addSensor(const RP_GPIO pin, const DHTType type);
+
+    // Reads all sensors at the same time. Results are stored in order of addSensor() calls
+    bool readAll(std::vector<SensorDataDHT>& outData);
+    bool readSensor(const DHTSensorID_t id, SensorDataDHT& outData);
+
+private:
+    bool read(const DHTSensorID_t onlySensor, std::vector<SensorDataDHT>& outData);
+    void onEdgeEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT event, const struct timespec& timestamp);
+
+    void pullLow(SensorInfo& sensor);
+    void release(SensorInfo& sensor);
+    bool decode(const SensorInfo& sensor, SensorDataDHT& outData) const;
+
+private:
+    std::vector<SensorInfo> mSensors;
+    std::mutex mSync;
+    bool mIsCapturing = false;
+};
+
+#endif // HWIOCPP_GPIO_SENSORS_DHT_HPP
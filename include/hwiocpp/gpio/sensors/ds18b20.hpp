@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_GPIO_SENSORS_DS18B20_HPP
+#define HWIOCPP_GPIO_SENSORS_DS18B20_HPP
+
+#include "gpio/OneWire.hpp"
+#include <vector>
+
+#define DS18B20_FAMILY_CODE             (0x28)
+
+struct SensorDataDS18B20
+{
+    OneWireRom_t rom = 0;
+    double temperature = 0.0;// celsius
+    bool valid = false;// false if sensor didn't respond or data was corrupted
+};
+
+// All DS18B20 sensors connected to a single 1-Wire bus.
+//
+// Temperature conversion is started with a single broadcast command (Skip ROM + Convert T),
+// so the whole bus is measured in one conversion time (750 ms for 12 bit resolution) instead
+// of one conversion time per sensor. After that scratchpads are read one by one.
+//
+// NOTE: bus object is not owned and must stay alive while DS18B20 is used
+class DS18B20
+{
+public:
+    DS18B20() = default;
+    ~DS18B20() = default;
+
+    // Finds all DS18B20 sensors on the bus
+    bool initialize(OneWire* bus);
+    inline const std::vector<OneWireRom_t>& getSensors() const;
+
+    // Sets resolution (9 ~ 12 bits) of all sensors
+    bool setResolution(const int bits);
+
+    // Starts conversion on all sensors at the same time
+    bool startConversion();
+    // Waits until conversion is finished. Powered sensors are polled, for parasite powered sensors full
+    // conversion time is waited
+    bool waitConversion();
+
+    bool readTemperature(const OneWireRom_t rom, double& outTemperature);
+
+    // Broadcast conversion + read of all sensors
+    bool readAll(std::vector<SensorDataDS18B20>& outData);
+
+private:
+    bool readScratchpad(const OneWireRom_t rom, byte* outData);
+    unsigned int getConversionTime() const;
+
+private:
+    OneWire* mBus = nullptr;
+    std::vector<OneWireRom_t> mSensors;
+    bool mHasParasitePower = false;
+    int mResolution = 12;
+};
+
+inline const std::vector<OneWireRom_t>& DS18B20::getSensors() const
+{
+    return mSensors;
+}
+
+#endif // HWIOCPP_GPIO_SENSORS_DS18B20_HPP
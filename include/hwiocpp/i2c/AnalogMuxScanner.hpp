@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_I2C_ANALOGMUXSCANNER_HPP
+#define HWIOCPP_I2C_ANALOGMUXSCANNER_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+class ADS1X15;
+class Dev74HC4051;
+
+using AnalogInputID_t = int;
+#define INVALID_ANALOG_INPUT_ID         (-1)
+
+#define ANALOG_MUX_CHANNELS             (8)
+#define ANALOG_MUX_DEFAULT_SETTLING_US  (10)
+
+// Scans multiple analog channels connected to ADS1X15 ADCs directly or through 74HC4051 muxes.
+//
+// Every registered input is a pair of ADC channel + optional mux in front of it. Frame contains
+// 8 values for inputs with a mux and 1 value for inputs without it (in order of registration).
+//
+// To increase scan rate:
+//   - conversions on different ADCs run in parallel;
+//   - conversions on the same ADC alternate between its inputs, so mux of the next input is
+//     switched (and settles) while ADC is converting current input;
+//   - mux channels are visited in Gray code order, so only one select line changes per switch.
+//
+// Several inputs can share the same mux object (for example muxes with common select lines). Such mux
+// is never switched while any of its inputs is converting. Conversions which need another channel of
+// a busy mux are postponed to the next round.
+//
+// NOTE: scanner doesn't own ADCs and muxes. They must be initialized before calling prepare()
+//       and should not be used by anybody else during scanFrame()
+class AnalogMuxScanner
+{
+    struct ScanInput
+    {
+        ADS1X15* adc = nullptr;
+        uint8_t adcChannel = 0;
+        Dev74HC4051* mux = nullptr;
+        int muxIndex = -1;// index in mMuxes
+        size_t frameOffset = 0;
+    };
+
+    struct MuxState
+    {
+        Dev74HC4051* mux = nullptr;
+        int selectedChannel = -1;
+        int claimedChannel = -1;// channel used by a conversion of the current round (-1 if mux is free)
+        std::chrono::steady_clock::time_point readyTime;// time when selected mux channel settles
+    };
+
+    struct ScanStep
+    {
+        int input = 0;
+        int muxChannel = 0;
+        size_t frameIndex = 0;
+    };
+
+    struct AdcQueue
+    {
+        ADS1X15* adc = nullptr;
+        std::vector<ScanStep> steps;
+        size_t position = 0;
+    };
+
+public:
+    AnalogMuxScanner() = default;
+    ~AnalogMuxScanner() = default;
+
+    // Registers an analog input. mux can be nullptr if sensor is connected directly to ADC
+    AnalogInputID_t addInput(ADS1X15* adc, const uint8_t adcChannel, Dev74HC4051* mux = nullptr);
+
+    // Time to wait after switching mux channel before starting conversion
+    void setSettlingTime(const unsigned int microseconds);
+
+    // Builds scan plan and allocates frame buffer. Must be called after all inputs were added
+    bool prepare();
+
+    // Returns total amount of values in a single frame
+    inline size_t getFrameSize() const;
+
+    // Returns index of the value in frame buffer (or -1 if arguments are invalid)
+    int getFrameIndex(const AnalogInputID_t input, const int muxChannel = 0) const;
+
+    // Scans all channels and writes results to internal frame buffer
+    bool scanFrame();
+
+    // Scans all channels and writes results to provided buffer (must fit at least getFrameSize() values)
+    bool scanFrame(int16_t* outFrame, const size_t frameSize);
+
+    // Returns results of the last scan
+    inline const std::vector<int16_t>& getFrame() const;
+
+    // Returns duration of the last scan in microseconds
+    inline unsigned int getLastScanDuration() const;
+
+private:
+    bool selectMuxChannel(MuxState& mux, const int muxChannel);
+    void waitUntil(const std::chrono::steady_clock::time_point& deadline);
+
+private:
+    std::vector<ScanInput> mInputs;
+    std::vector<MuxState> mMuxes;
+    std::vector<AdcQueue> mQueues;
+    std::vector<int16_t> mFrame;
+    std::vector<ScanStep*> mActiveSteps;// one per ADC queue. used during scan
+    unsigned int mSettlingTime = ANALOG_MUX_DEFAULT_SETTLING_US;
+    unsigned int mLastScanDuration = 0;
+};
+
+inline size_t AnalogMuxScanner::getFrameSize() const
+{
+    return mFrame.size();
+}
+
+inline const std::vector<int16_t>& AnalogMuxScanner::getFrame() const
+{
+    return mFrame;
+}
+
+inline unsigned int AnalogMuxScanner::getLastScanDuration() const
+{
+    return mLastScanDuration;
+}
+
+#endif // HWIOCPP_I2C_ANALOGMUXSCANNER_HPP
@@ -6,8 +6,15 @@
 #define HWIOCPP_I2C_DEVICEI2C_HPP
 
 #include "GenericDevice.hpp"
+#include "I2CBus.hpp"
+#include "I2CRegisterBlock.hpp"
+#include "utils/BufferView.hpp"
 #include <linux/i2c.h>
 #include <vector>
+#include <memory>
+#include <future>
+#include <functional>
+#include <type_traits>
 
 // doc: https://www.kernel.org/doc/Documentation/i2c/
 // DOC: https://www.kernel.org/doc/html/latest/driver-api/i2c.html
@@ -16,6 +23,54 @@
 
 #define I2C_ADAPTER_DEFAULT             (1)
 
+enum class I2CError
+{
+    OK,
+    NOT_OPEN,// device is not opened
+    INVALID_ARGUMENT,
+    NOT_SUPPORTED,// operation is not supported by the adapter
+    TRANSFER_FAILED
+};
+
+// Primitive used for data transfers. Is selected based on adapter capabilities (from the fastest to the slowest)
+enum class I2CTransferStrategy
+{
+    NONE,
+    SMBUS_BYTE,// byte transfers (I2C_FUNC_SMBUS_BYTE_DATA). Block transfers are emulated
+    SMBUS_BLOCK,// SMBus I2C block transfers (up to I2C_SMBUS_BLOCK_MAX bytes)
+    NATIVE_I2C// I2C_RDWR messages (I2C_FUNC_I2C)
+};
+
+// Result of asynchronous operation
+struct I2CAsyncResult
+{
+    bool success = false;
+    std::vector<byte> data;// received bytes (empty if operation failed)
+};
+
+using I2CAsyncCallback_t = std::function<void(I2CAsyncResult& result)>;
+
+#define I2C_REGISTER_NON_VOLATILE       (0x0u)
+#define I2C_REGISTER_VOLATILE           (0xFFFFFFFFu)
+
+// Shadow copy of a device register (see DeviceI2C::declareRegister)
+struct I2CRegisterShadow
+{
+    uint8_t size = 0;// register width in bytes (1..4). 0 - register is not declared
+    Endianness bytesOrder = Endianness::BIG;
+    uint32_t volatileMask = I2C_REGISTER_NON_VOLATILE;
+    uint32_t value = 0;// last known value of non-volatile bits
+    bool isValid = false;
+};
+
+struct I2CRegisterCacheStats
+{
+    uint64_t busReads = 0;
+    uint64_t busWrites = 0;
+    uint64_t cachedReads = 0;// reads served from the shadow
+    uint64_t skippedWrites = 0;// writes of a value which register already had
+};
+
 class DeviceI2C: public GenericDevice
 {
 public:
@@ -23,6 +78,12 @@ public:
     virtual ~DeviceI2C();
 
     bool openDevice(const int adapterNumber, const int address, const int capabilities = 0);
+    // Attaches device to a shared adapter instead of opening its own file descriptor. All transactions
+    // are executed by the bus worker thread, so devices can be safely used from different threads
+    bool openDevice(const std::shared_ptr<I2CBus>& bus, const int address, const int capabilities = 0);
+    // Attaches device which is connected to a channel of I2C multiplexer (see i2c/tca9548a.hpp). Bus
+    // selects the channel before device transactions (only if other channel is currently selected)
+    bool openDevice(const std::shared_ptr<I2CBus>& bus, const I2CMuxRoute& route, const int address, const int capabilities = 0);
     void closeDevice() override;
     bool isDeviceOpen() override;
 
@@ -30,6 +91,14 @@ public:
     byte readByte(const byte cmd);
     uint16_t readWord(const byte cmd, const Endianness bytesOrder = Endianness::NATIVE);
     int readBuffer(byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
+    // Writes register pointer and reads data after repeated START (single I2C_RDWR ioctl)
+    int readBuffer(const byte cmd, byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
+    int writeThenRead(const byte* cmd, const size_t cmdSize, byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
+
+    // Submits all messages as a single combined transaction (one I2C_RDWR ioctl, up to I2C_RDWR_IOCTL_MAX_MSGS messages).
+    // Requires I2C_FUNC_I2C adapter capability
+    bool transfer(const I2CMessage* messages, const size_t messagesCount);
+    bool transfer(const std::vector<I2CMessage>& messages);
 
     bool writeData(const uint8_t data);
     bool writeData(const uint16_t data, const Endianness bytesOrder = Endianness::NATIVE);
@@ -44,16 +113,156 @@ public:
     bool writeBuffer(const byte cmd, const byte* buffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
     bool writeBuffer(const byte cmd, const std::vector<byte>& buffer, const Endianness bytesOrder = Endianness::NATIVE);
 
+    // Allocation-free API. Data is transferred as is (no bytes order normalization). Buffers can be passed
+    // as C arrays, std::array, std::vector or BufferView.
+    //
+    // Transfers use the fastest primitive supported by the adapter (see getTransferStrategy()). Transfers with
+    // register address which are longer than primitive limit are split into chunks and register address is
+    // incremented for each of them. Transfers without register address are never split (NOT_SUPPORTED is
+    // returned if they don't fit)
+    I2CError readBytes(ByteView outBuffer);
+    I2CError readBytes(const byte cmd, ByteView outBuffer);
+    I2CError writeBytes(ConstByteView buffer);
+    I2CError writeBytes(const byte cmd, ConstByteView buffer);
+    I2CError readByte(const byte cmd, byte& outValue);
+    // Burst read of consecutive registers in a single combined transaction (or SMBus I2C block read).
+    // Device must auto increment register pointer (see setAutoIncrementFlag()). Usage:
+    //     I2CRegisterBlock<6> accel;
+    //     if (I2CError::OK == readRegisters(REG_OUT_X_L, accel)) { x = accel.get<int16_t>(0, Endianness::LITTLE); ... }
+    I2CError readRegisters(const byte startReg, byte* outBuffer, const size_t count);
+    template <size_t N>
+    I2CError readRegisters(const byte startReg, I2CRegisterBlock<N>& outBlock);
+    // For devices without auto increment. Reads registers from the list (outBuffer[i] = value of registers[i])
+    // using as few transactions as possible (up to I2C_RDWR_IOCTL_MAX_MSGS/2 registers per transaction)
+    I2CError readRegisters(ConstByteView registers, ByteView outBuffer);
+    // Some devices increment register pointer only if a special bit is set in register address (for
+    // example 0x80 for most ST sensors). This flag is added to start register of multi-byte reads
+    inline void setAutoIncrementFlag(const byte flag);
+
+    // Reads consecutive registers starting from startReg directly into a trivially copyable struct
+    // (register layout must match struct layout. Multi-byte fields are in device bytes order)
+    template <typename T>
+    I2CError readStruct(const byte startReg, T& outValue);
+
+    // Asynchronous operations. When device is attached to I2CBus they are executed by the bus worker thread
+    // and calling thread is not blocked (otherwise operation is executed synchronously before function returns).
+    // Data is transferred as is (no bytes order normalization).
+    //
+    // Writes txData and then reads rxSize bytes after repeated START (any of them can be empty).
+    // Callback is always called exactly once (from the bus worker thread). Returns false if operation
+    // couldn't be started
+    bool startAsync(const std::vector<byte>& txData, const size_t rxSize, const I2CAsyncCallback_t& callback);
+    std::future<I2CAsyncResult> readBufferAsync(const size_t bytesCount);
+    std::future<I2CAsyncResult> readBufferAsync(const byte cmd, const size_t bytesCount);
+    std::future<bool> writeBufferAsync(const std::vector<byte>& buffer);
+    std::future<bool> writeBufferAsync(const byte cmd, const std::vector<byte>& buffer);
+
+    // Register shadow. Device keeps a copy of the declared registers and skips bus transactions which
+    // wouldn't change anything: writes of the value register already has and reads of registers
+    // which only change when they are written.
+    //
+    // volatileMask defines bits which can be changed by the device itself (status, self-clearing
+    // trigger bits, measurement results, etc.). Reading a register with volatile bits always goes to the
+    // bus. Writing 0 to volatile bits is expected to have no effect, so write is skipped only if all
+    // non-volatile bits are unchanged and no volatile bits are set. Fully volatile registers are never cached.
+    //
+    // Shadow is invalidated when device is closed. Call invalidateRegister() if register was changed
+    // bypassing these functions (for example with writeBuffer() or after device reset)
+    bool declareRegister(const byte reg, const uint8_t size, const uint32_t volatileMask = I2C_REGISTER_NON_VOLATILE,
+                         const Endianness bytesOrder = Endianness::BIG);
+    bool readRegister(const byte reg, uint32_t& outValue);
+    bool writeRegister(const byte reg, const uint32_t value);
+    // Read-modify-write of the bits specified by mask. Uses shadow value of other bits if it's available.
+    // Nothing is written to the device if masked bits already have the requested value
+    bool updateRegister(const byte reg, const uint32_t mask, const uint32_t value);
+    void invalidateRegister(const byte reg);
+    void invalidateRegisters();
+    inline const I2CRegisterCacheStats& getRegisterCacheStats() const;
+    inline void resetRegisterCacheStats();
+
+    // Forces slower transfer strategy (for example for devices which don't handle repeated START). Returns false
+    // if strategy is not supported by the adapter
+    bool setTransferStrategy(const I2CTransferStrategy strategy);
+    inline I2CTransferStrategy getTransferStrategy() const;
+    // Max amount of data which is transferred in one transaction with the current strategy
+    size_t getMaxChunkSize() const;
+
     void printCapabilities();
+    inline int getAddress() const;
+    inline const I2CMuxRoute& getRoute() const;
+    // Shared adapter device is attached to (nullptr if device uses its own file descriptor)
+    inline const std::shared_ptr<I2CBus>& getBus() const;
+
+private:
+    static I2CTransferStrategy selectTransferStrategy(const int capabilities);
+    I2CError checkTransferArguments(const size_t bytesCount) const;
+    I2CRegisterShadow* getRegisterShadow(const byte reg);
+    bool readRegisterData(const byte reg, byte* outBuffer, const size_t bytesCount);
+    bool writeRegisterData(const byte reg, const byte* buffer, const size_t bytesCount);
 
 private:
     int mFD = INVALID_FD;
     int mCapabilites = 0;
+    int mAddress = 0;
+    I2CTransferStrategy mTransferStrategy = I2CTransferStrategy::NONE;
+    byte mAutoIncrementFlag = 0;
+    std::shared_ptr<I2CBus> mBus;
+    I2CMuxRoute mRoute;
+    std::vector<I2CRegisterShadow> mRegisters;// indexed by register address. allocated by declareRegister()
+    I2CRegisterCacheStats mRegisterCacheStats;
 };
 
 inline bool DeviceI2C::isDeviceOpen()
 {
-    return mFD != INVALID_FD;
+    return (mFD != INVALID_FD) || (nullptr != mBus);
+}
+
+inline int DeviceI2C::getAddress() const
+{
+    return mAddress;
+}
+
+inline const I2CMuxRoute& DeviceI2C::getRoute() const
+{
+    return mRoute;
+}
+
+inline const std::shared_ptr<I2CBus>& DeviceI2C::getBus() const
+{
+    return mBus;
+}
+
+template <typename T>
+I2CError DeviceI2C::readStruct(const byte startReg, T& outValue)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    return readRegisters(startReg, reinterpret_cast<byte*>(&outValue), sizeof(T));
+}
+
+template <size_t N>
+I2CError DeviceI2C::readRegisters(const byte startReg, I2CRegisterBlock<N>& outBlock)
+{
+    return readRegisters(startReg, outBlock.view().data(), N);
+}
+
+inline void DeviceI2C::setAutoIncrementFlag(const byte flag)
+{
+    mAutoIncrementFlag = flag;
+}
+
+inline I2CTransferStrategy DeviceI2C::getTransferStrategy() const
+{
+    return mTransferStrategy;
+}
+
+inline const I2CRegisterCacheStats& DeviceI2C::getRegisterCacheStats() const
+{
+    return mRegisterCacheStats;
+}
+
+inline void DeviceI2C::resetRegisterCacheStats()
+{
+    mRegisterCacheStats = I2CRegisterCacheStats();
 }
 
 #endif // HWIOCPP_I2C_DEVICEI2C_HPP
\ No newline at end of file
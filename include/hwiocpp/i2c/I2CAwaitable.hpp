@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_I2C_I2CAWAITABLE_HPP
+#define HWIOCPP_I2C_I2CAWAITABLE_HPP
+
+#ifdef HWIOCPP_ENABLE_COROUTINES
+
+#include "DeviceI2C.hpp"
+#include "utils/Task.hpp"
+#include <coroutine>
+#include <utility>
+
+// Awaitable asynchronous I2C operation. Coroutine is suspended while transaction is executed by
+// I2CBus worker thread and is resumed from AsyncScheduler thread.
+//
+// Usage:
+//     I2CAsyncResult res = co_await i2cTransfer(scheduler, device, {REG_STATUS}, 1);
+class I2CAwaitable
+{
+public:
+    I2CAwaitable(AsyncScheduler& scheduler, DeviceI2C& device, std::vector<byte> txData, const size_t rxSize)
+        : mScheduler(scheduler)
+        , mDevice(device)
+        , mTxData(std::move(txData))
+        , mRxSize(rxSize)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        AsyncScheduler* scheduler = &mScheduler;
+        I2CAsyncResult* result = &mResult;
+
+        // keep scheduler running while transaction is in progress. callback is called even if
+        // operation couldn't be started, so coroutine is always resumed
+        scheduler->retainTask();
+        mDevice.startAsync(mTxData, mRxSize, [scheduler, result, handle](I2CAsyncResult& asyncResult)
+        {
+            *result = std::move(asyncResult);
+            scheduler->post([handle](){ handle.resume(); });
+            scheduler->releaseTask();
+        });
+    }
+
+    I2CAsyncResult await_resume() noexcept
+    {
+        return std::move(mResult);
+    }
+
+private:
+    AsyncScheduler& mScheduler;
+    DeviceI2C& mDevice;
+    std::vector<byte> mTxData;
+    size_t mRxSize = 0;
+    I2CAsyncResult mResult;
+};
+
+// Writes txData and reads rxSize bytes after repeated START
+inline I2CAwaitable i2cTransfer(AsyncScheduler& scheduler, DeviceI2C& device, std::vector<byte> txData, const size_t rxSize)
+{
+    return I2CAwaitable(scheduler, device, std::move(txData), rxSize);
+}
+
+inline I2CAwaitable i2cWrite(AsyncScheduler& scheduler, DeviceI2C& device, std::vector<byte> txData)
+{
+    return I2CAwaitable(scheduler, device, std::move(txData), 0);
+}
+
+#endif // HWIOCPP_ENABLE_COROUTINES
+
+#endif // HWIOCPP_I2C_I2CAWAITABLE_HPP
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_I2C_I2CBUS_HPP
+#define HWIOCPP_I2C_I2CBUS_HPP
+
+#include "GenericDevice.hpp"
+#include <linux/i2c.h>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#define I2C_DEVICE_ADDRESS              (-1)// use address of the opened device
+
+// Single message of a combined I2C transaction. Buffer is owned by the caller and is passed to the kernel as is.
+// Messages of the same transaction are separated by repeated START (STOP is sent only after the last one)
+struct I2CMessage
+{
+    int address = I2C_DEVICE_ADDRESS;// 7 bit address. messages of one transaction can target different devices
+    byte* buffer = nullptr;// data to write or storage for data to read
+    size_t size = 0;
+    bool isRead = false;
+};
+
+#define I2C_NO_MUX                      (-1)
+#define I2C_MUX_MAX_CHANNELS            (8)
+
+// Location of a device behind an I2C multiplexer with one-byte channel mask control register
+// (TCA9548A, PCA9548A, etc. see i2c/tca9548a.hpp)
+struct I2CMuxRoute
+{
+    int muxAddress = I2C_NO_MUX;// device is connected directly to the adapter
+    int channel = 0;
+};
+
+enum class I2CTransactionState
+{
+    IDLE,
+    PENDING,
+    COMPLETED,
+    FAILED
+};
+
+// success is true if transaction was completed successfully
+using I2CTransactionCallback_t = std::function<void(const bool success)>;
+
+// Transaction submitted to I2CBus. Owned by the caller and must stay alive (together with messages and
+// their buffers) until it's completed
+struct I2CTransaction
+{
+    const I2CMessage* messages = nullptr;
+    size_t messagesCount = 0;
+    int defaultAddress = 0;// used for messages with I2C_DEVICE_ADDRESS
+    I2CMuxRoute route;// mux channel which must be selected before transaction
+    // Optional. Called from the bus worker thread after transaction was executed. Transaction doesn't
+    // access its fields after this call, so it can be destroyed from the callback
+    I2CTransactionCallback_t onComplete;
+
+    std::atomic<I2CTransactionState> state{I2CTransactionState::IDLE};
+    I2CTransaction* next = nullptr;// used by submission queue
+};
+
+struct I2CBusStats
+{
+    uint64_t transactions = 0;
+    uint64_t failedTransactions = 0;
+    uint64_t ioctls = 0;// transactions coalesced into a single ioctl count as one
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t muxSwitches = 0;// channel select writes
+    uint64_t muxSwitchesAvoided = 0;// transactions groups which didn't need select write because channel was already selected
+    uint64_t busyTime = 0;// nanoseconds spent in I2C_RDWR
+    uint64_t elapsedTime = 0;// nanoseconds since stats were reset
+    double utilization = 0.0;// busyTime / elapsedTime
+};
+
+// I2C adapter (/dev/i2c-N) shared by all devices connected to it.
+//
+// Adapter is opened once and all transactions are executed by a single worker thread (HwioThread::I2C_BUS),
+// so transactions of different devices and threads never interleave. Transactions are submitted through a
+// lock-free multi-producer queue. Transactions which are waiting in the queue at the same time are coalesced
+// into a single I2C_RDWR ioctl (up to I2C_RDWR_IOCTL_MAX_MSGS messages).
+//
+// NOTE: coalesced transactions are separated by repeated START instead of STOP+START. If ioctl fails, all
+//       transactions in it are reported as failed. Use setCoalescing(false) if devices on the bus don't tolerate this
+//
+// Devices behind I2C multiplexers are supported through I2CTransaction::route. Bus remembers the selected
+// channel of every mux and writes mux control register only when channel has to be changed (mux applies
+// new channel after STOP, so select write is always a separate ioctl). Other muxes are disabled before
+// switching, so devices with the same address behind different muxes don't conflict. All known muxes are
+// disabled before transactions of directly connected devices for the same reason. Transactions of
+// the same batch are grouped by channel (currently selected one first) to reduce number of switches.
+// Order of transactions is preserved only within the same channel. Use setMuxGrouping(false) to disable it
+class I2CBus
+{
+    struct MuxState
+    {
+        int address = 0;
+        int selectedMask = -1;// -1 if unknown
+    };
+
+public:
+    // Returns shared instance of the adapter (opens it if needed). Returns nullptr if adapter can't be opened
+    static std::shared_ptr<I2CBus> getBus(const int adapterNumber);
+
+    ~I2CBus();
+
+    inline int getAdapterNumber() const;
+    inline int getCapabilities() const;
+
+    // Queues transaction for execution. Returns false if transaction is invalid or already pending
+    bool submit(I2CTransaction& transaction);
+    // Waits until transaction is executed. Returns true if it was completed successfully
+    bool wait(I2CTransaction& transaction);
+    // Submits transaction and waits for it
+    bool execute(const I2CMessage* messages, const size_t messagesCount, const int defaultAddress,
+                 const I2CMuxRoute& route = I2CMuxRoute());
+
+    inline void setCoalescing(const bool enable);
+    inline void setMuxGrouping(const bool enable);
+    // Forgets selected mux channels (for example after mux was reset externally)
+    void invalidateMuxState();
+
+    I2CBusStats getStats() const;
+    void resetStats();
+
+private:
+    explicit I2CBus(const int adapterNumber);
+
+    bool open();
+    void threadWorker();
+    // takes all submitted transactions from the queue (in submission order)
+    bool collectTransactions();
+    // orders batch by mux channel
+    void groupByRoute();
+    void executeGroup(const size_t first, const size_t count, const size_t messagesCount);
+    void completeTransaction(I2CTransaction* transaction, const bool success);
+    bool selectRoute(const I2CMuxRoute& route);
+    bool writeMuxMask(MuxState& mux, const int mask);
+
+private:
+    static std::mutex sBusesSync;
+    static std::map<int, std::weak_ptr<I2CBus>> sBuses;
+
+    int mAdapterNumber = 0;
+    int mFD = INVALID_FD;
+    int mCapabilities = 0;
+
+    std::thread mWorker;
+    std::atomic<bool> mIsRunning{false};
+    std::atomic<bool> mCoalescing{true};
+    std::atomic<bool> mMuxGrouping{true};
+    std::atomic<bool> mMuxStateInvalid{false};
+
+    std::atomic<I2CTransaction*> mQueueHead{nullptr};// lock-free stack of submitted transactions (newest first)
+    std::atomic<bool> mWorkerSleeping{false};
+    mutable std::mutex mSync;
+    std::condition_variable mSubmitCondition;
+    std::condition_variable mCompleteCondition;
+
+    // used by worker thread
+    std::vector<I2CTransaction*> mBatch;
+    std::vector<struct i2c_msg> mMessages;
+    std::vector<MuxState> mMuxes;
+
+    std::atomic<uint64_t> mTransactionsCount{0};
+    std::atomic<uint64_t> mFailedTransactions{0};
+    std::atomic<uint64_t> mIoctlsCount{0};
+    std::atomic<uint64_t> mMessagesCount{0};
+    std::atomic<uint64_t> mBytesCount{0};
+    std::atomic<uint64_t> mMuxSwitches{0};
+    std::atomic<uint64_t> mMuxSwitchesAvoided{0};
+    std::atomic<uint64_t> mBusyTime{0};
+    struct timespec mStatsStart = {0, 0};
+};
+
+inline int I2CBus::getAdapterNumber() const
+{
+    return mAdapterNumber;
+}
+
+inline int I2CBus::getCapabilities() const
+{
+    return mCapabilities;
+}
+
+inline void I2CBus::setCoalescing(const bool enable)
+{
+    mCoalescing = enable;
+}
+
+inline void I2CBus::setMuxGrouping(const bool enable)
+{
+    mMuxGrouping = enable;
+}
+
+#endif // HWIOCPP_I2C_I2CBUS_HPP
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_I2C_I2CBUSEXECUTOR_HPP
+#define HWIOCPP_I2C_I2CBUSEXECUTOR_HPP
+
+#include "DeviceI2C.hpp"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// Result of a single sample of the plan
+struct I2CFrameSample
+{
+    bool success = false;
+    std::vector<byte> data;// received bytes (rxSize of the sample)
+    struct timespec timestamp = {0, 0};// moment transaction was completed (CLOCK_MONOTONIC)
+};
+
+// Results of all samples of the plan collected in one pass
+struct I2CFrame
+{
+    uint64_t sequence = 0;// incremented for every frame
+    struct timespec startTime = {0, 0};// moment first transaction was submitted (CLOCK_MONOTONIC)
+    struct timespec endTime = {0, 0};// moment last transaction was completed
+    bool isComplete = false;// true if all samples were successful
+    std::vector<I2CFrameSample> samples;// in the same order as samples were added to the plan
+};
+
+// Sampling plan which is executed on multiple I2C adapters in parallel.
+//
+// Every adapter (I2CBus) has its own worker thread, so executor just submits transactions of all samples
+// at once and waits until all of them are completed. Samples of different adapters are executed at the
+// same time, samples of the same adapter are executed in the order they were added (and are coalesced
+// by the bus). To increase throughput spread devices across adapters (/dev/i2c-1, -3, -4, ...):
+//     I2CBusExecutor plan;
+//     adc1.initialize(I2CBus::getBus(1), ADS1X15_ADDRESS_GND);
+//     adc2.initialize(I2CBus::getBus(3), ADS1X15_ADDRESS_GND);
+//     plan.addSample(adc1, {ADS1X15_REG_POINTER_CONVERT}, 2);
+//     plan.addSample(adc2, {ADS1X15_REG_POINTER_CONVERT}, 2);
+//     ...
+//     if (true == plan.sample(frame)) { ... frame.samples[1].data ... }
+//
+// Samples are executed as plain write+read transactions (register shadow of the device is not used).
+// NOTE: executor is not thread safe. Plan can't be modified while sample() is running
+class I2CBusExecutor
+{
+    struct Entry
+    {
+        std::shared_ptr<I2CBus> bus;
+        int address = 0;
+        std::vector<byte> txData;
+        size_t rxSize = 0;
+        I2CMessage messages[2];
+        I2CTransaction transaction;
+    };
+
+public:
+    I2CBusExecutor() = default;
+    ~I2CBusExecutor();
+
+    // Adds write txData + read rxSize bytes transaction to the plan (any of them can be empty).
+    // Device must be attached to I2CBus. Returns index of the sample in I2CFrame::samples or -1 on error
+    int addSample(const DeviceI2C& device, const std::vector<byte>& txData, const size_t rxSize);
+    int addSample(const std::shared_ptr<I2CBus>& bus, const I2CMuxRoute& route, const int address,
+                  const std::vector<byte>& txData, const size_t rxSize);
+    void clear();
+
+    inline size_t getSamplesCount() const;
+    // Amount of different adapters used by the plan (max amount of transactions executed in parallel)
+    size_t getBusesCount() const;
+
+    // Executes all samples and blocks until they are completed. outFrame can be reused between calls
+    // to avoid allocations. Returns true if all samples were successful
+    bool sample(I2CFrame& outFrame);
+
+private:
+    void onSampleCompleted(const size_t index, const bool success);
+
+private:
+    std::vector<std::unique_ptr<Entry>> mEntries;
+    I2CFrame* mCurrentFrame = nullptr;
+    uint64_t mSequence = 0;
+    size_t mPendingCount = 0;// protected by mSync
+    std::mutex mSync;
+    std::condition_variable mCompleteCondition;
+};
+
+inline size_t I2CBusExecutor::getSamplesCount() const
+{
+    return mEntries.size();
+}
+
+#endif // HWIOCPP_I2C_I2CBUSEXECUTOR_HPP
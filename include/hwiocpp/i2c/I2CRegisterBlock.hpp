@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_I2C_I2CREGISTERBLOCK_HPP
+#define HWIOCPP_I2C_I2CREGISTERBLOCK_HPP
+
+#include "utils/ByteOrder.hpp"
+#include "utils/BufferView.hpp"
+#include <array>
+
+// Raw copy of consecutive device registers read in a single burst (see DeviceI2C::readRegisters()).
+// Values are decoded from the block after transaction is completed, so a whole sensor data block
+// (IMU axes, environmental sensor measurements, RTC time) is always consistent.
+//
+// Offsets are relative to the first register of the block. Reading out of block bounds returns 0.
+template <size_t N>
+class I2CRegisterBlock
+{
+public:
+    inline ByteView view();
+    inline const byte* data() const;
+    constexpr size_t size() const;
+
+    inline uint8_t getByte(const size_t offset) const;
+    // Multi-byte value stored in device bytes order (for example get<int16_t>(0, Endianness::BIG))
+    template <typename T>
+    inline T get(const size_t offset, const Endianness bytesOrder) const;
+    // Bits of a single register (value is shifted to bit 0)
+    inline uint8_t getBits(const size_t offset, const uint8_t mask, const uint8_t shift) const;
+    // Binary-coded decimal register (used by RTCs)
+    inline uint8_t getBCD(const size_t offset, const uint8_t mask = 0xFF) const;
+
+private:
+    std::array<byte, N> mData = {};
+};
+
+template <size_t N>
+inline ByteView I2CRegisterBlock<N>::view()
+{
+    return ByteView(mData.data(), mData.size());
+}
+
+template <size_t N>
+inline const byte* I2CRegisterBlock<N>::data() const
+{
+    return mData.data();
+}
+
+template <size_t N>
+constexpr size_t I2CRegisterBlock<N>::size() const
+{
+    return N;
+}
+
+template <size_t N>
+inline uint8_t I2CRegisterBlock<N>::getByte(const size_t offset) const
+{
+    return (offset < N ? mData[offset] : 0);
+}
+
+template <size_t N>
+template <typename T>
+inline T I2CRegisterBlock<N>::get(const size_t offset, const Endianness bytesOrder) const
+{
+    T result = 0;
+
+    if (offset + sizeof(T) <= N)
+    {
+        result = loadBytes<T>(mData.data() + offset, bytesOrder);
+    }
+
+    return result;
+}
+
+template <size_t N>
+inline uint8_t I2CRegisterBlock<N>::getBits(const size_t offset, const uint8_t mask, const uint8_t shift) const
+{
+    return (getByte(offset) & mask) >> shift;
+}
+
+template <size_t N>
+inline uint8_t I2CRegisterBlock<N>::getBCD(const size_t offset, const uint8_t mask) const
+{
+    const uint8_t value = getByte(offset) & mask;
+
+    return ((value >> 4) * 10) + (value & 0x0F);
+}
+
+#endif // HWIOCPP_I2C_I2CREGISTERBLOCK_HPP
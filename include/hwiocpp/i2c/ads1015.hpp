@@ -18,6 +18,29 @@ public:
     }
 
     virtual ~ADS1015() = default;
+
+protected:
+    unsigned int getSamplesPerSecond(const uint16_t rate) const override
+    {
+        switch (rate)
+        {
+            case RATE_ADS1015_128SPS:
+                return 128;
+            case RATE_ADS1015_250SPS:
+                return 250;
+            case RATE_ADS1015_490SPS:
+                return 490;
+            case RATE_ADS1015_920SPS:
+                return 920;
+            case RATE_ADS1015_1600SPS:
+                return 1600;
+            case RATE_ADS1015_2400SPS:
+                return 2400;
+            case RATE_ADS1015_3300SPS:
+            default:
+                return 3300;
+        }
+    }
 };
 
 #endif // HWIOCPP_I2C_ADS1015_HPP
\ No newline at end of file
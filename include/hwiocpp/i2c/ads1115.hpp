@@ -18,6 +18,31 @@ public:
     }
     
     virtual ~ADS1115() = default;
+
+protected:
+    unsigned int getSamplesPerSecond(const uint16_t rate) const override
+    {
+        switch (rate)
+        {
+            case RATE_ADS1115_8SPS:
+                return 8;
+            case RATE_ADS1115_16SPS:
+                return 16;
+            case RATE_ADS1115_32SPS:
+                return 32;
+            case RATE_ADS1115_64SPS:
+                return 64;
+            case RATE_ADS1115_128SPS:
+                return 128;
+            case RATE_ADS1115_250SPS:
+                return 250;
+            case RATE_ADS1115_475SPS:
+                return 475;
+            case RATE_ADS1115_860SPS:
+            default:
+                return 860;
+        }
+    }
 };
 
 #endif // HWIOCPP_I2C_ADS1115_HPP
\ No newline at end of file
@@ -44,9 +44,13 @@ BSD license, all text here must be included in any redistribution
 #define HWIOCPP_I2C_ADS1X15_HPP
 
 #include "DeviceI2C.hpp"
+#include "AnalogInputDevice.hpp"
 #include "ads1x15_defines.hpp"
+#ifdef HWIOCPP_ENABLE_COROUTINES
+  #include "I2CAwaitable.hpp"
+#endif
 
-class ADS1X15: public DeviceI2C
+class ADS1X15: public DeviceI2C, public AnalogInputDevice
 {
 public:
     // @brief Sets up the HW (reads coefficients values, etc.)
@@ -54,11 +58,44 @@ public:
     // @param wire I2C bus
     // @return true if successful, otherwise false
     bool initialize(const int adapterNumber, const int address);
+    // @brief Attaches ADC to a shared I2C adapter
+    // @param bus shared adapter
+    // @param address I2C address of device
+    // @param route mux channel device is connected to
+    // @return true if successful, otherwise false
+    bool initialize(const std::shared_ptr<I2CBus>& bus, const int address, const I2CMuxRoute& route = I2CMuxRoute());
+
+    // @brief Gets amount of single-ended channels
+    uint8_t getChannelsCount() const override;
 
     // @brief Gets a single-ended ADC reading from the specified channel (0 ~ 3)
     // @param channel 
     // @return the ADC reading
-    int16_t readSingleChannel(uint8_t channel);
+    int16_t readSingleChannel(uint8_t channel) override;
+
+    // @brief Starts a single-ended conversion on the specified channel (0 ~ 3)
+    //        without waiting for it to complete. Use conversionComplete() and
+    //        getLastConversionResults() to get the result.
+    // @param channel
+    // @return true if conversion was started
+    bool startSingleChannelConversion(uint8_t channel);
+
+#ifdef HWIOCPP_ENABLE_COROUTINES
+    // @brief Gets a single-ended ADC reading without blocking the calling thread.
+    //        Coroutine sleeps for the conversion time instead of polling the bus.
+    //        Device should be attached to I2CBus.
+    // @param scheduler scheduler which resumes the coroutine
+    // @param channel
+    // @return the ADC reading (0 if failed)
+    Task<int16_t> readSingleChannelAsync(AsyncScheduler& scheduler, uint8_t channel);
+#endif
+
+    // @brief Returns true if conversion is complete, false otherwise.
+    bool conversionComplete();
+
+    // @brief Gets expected duration of a single conversion for the current data rate
+    // @return conversion time in microseconds
+    unsigned int getConversionTime() const;
 
     // @brief  Reads the conversion results, measuring the voltage
     //         difference between the P (AIN0) and N (AIN1) input.
@@ -90,7 +127,7 @@ public:
     // @brief Returns true if conversion is complete, false otherwise.
     // @param counts the ADC reading in raw counts
     // @return the ADC reading in volts
-    float computeVolts(int16_t counts);
+    float computeVolts(int16_t counts) override;
 
     // @brief Sets the gain and input voltage range
     // @param gain gain setting to use
@@ -108,19 +145,29 @@ public:
     // @return the data rate
     inline uint16_t getDataRate() const;
 
+protected:
+    // @brief Converts data rate setting to samples per second
+    // @param rate data rate setting
+    // @return samples per second (0 if unknown)
+    virtual unsigned int getSamplesPerSecond(const uint16_t rate) const;
+
 private:
-    // @brief Returns true if conversion is complete, false otherwise.
-    bool conversionComplete();
-    
-    // @brief Writes 16-bits to the specified destination register
-    // @param reg register address to write to
-    // @param value value to write to register
-    void writeRegister(uint8_t reg, uint16_t value);
-
-    // @brief Read 16-bits from the specified destination register
-    // @param reg register address to read from
-    // @return 16 bit register value read
-    uint16_t readRegister(uint8_t reg);
+    // @brief Builds config register value for a single-shot single-ended conversion
+    // @param channel ADC channel (0 ~ 3)
+    // @return config register value
+    uint16_t getSingleChannelConfig(const uint8_t channel) const;
+
+    // @brief Converts conversion register value to a signed ADC reading
+    // @param rawValue conversion register value
+    // @return the ADC reading
+    int16_t convertRawResult(const uint16_t rawValue) const;
+
+    // @brief Polls conversion status until conversion is complete
+    // @return false if conversion didn't complete within ADS1X15_CONVERSION_TIMEOUT_NS or status couldn't be read
+    bool waitForConversion();
+
+    // @brief Declares ADC registers in the register shadow (see DeviceI2C::declareRegister)
+    void declareRegisters();
 
 protected:
     uint8_t mBitShift;
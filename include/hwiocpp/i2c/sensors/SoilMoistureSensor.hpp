@@ -6,11 +6,14 @@
 #define HWIOCPP_I2C_SENSORS_SOILMOISTURESENSOR_HPP
 
 class ADS1X15;
+class AnalogInputDevice;
 
 class SoilMoistureSensor
 {
 public:
     SoilMoistureSensor(ADS1X15* ads, const int adsChannel);
+    // NOTE: default calibration values are for ADS1115. Call clibrate() when using other ADCs
+    SoilMoistureSensor(AnalogInputDevice* adc, const int adcChannel);
     ~SoilMoistureSensor();
 
     // dryValue - sensor value when moisture level is at 0% (ideally measure in dry soil or atkeast in dry air)
@@ -26,7 +29,8 @@ private:
     void readSensorValue();
 
 private:
-    ADS1X15* mADS;
+    ADS1X15* mADS;// set only if sensor is connected to ADS1X15
+    AnalogInputDevice* mADC;
     int mAdsChannel;
     int mLastSensorValue;
     int mDryValue;
@@ -6,6 +6,9 @@
 #define HWIOCPP_I2C_SENSORS_AHT10_HPP
 
 #include "i2c/DeviceI2C.hpp"
+#ifdef HWIOCPP_ENABLE_COROUTINES
+  #include "i2c/I2CAwaitable.hpp"
+#endif
 
 /*
  NOTE:
@@ -37,14 +40,24 @@ public:
     virtual ~AHT10();
 
     bool initialize(const int adapterNumber);
+    // route - mux channel sensor is connected to (AHT10 address is fixed, so multiple sensors require a mux)
+    bool initialize(const std::shared_ptr<I2CBus>& bus, const I2CMuxRoute& route = I2CMuxRoute());
     SensorDataAHT10 getSensorData();
 
+#ifdef HWIOCPP_ENABLE_COROUTINES
+    // Doesn't block calling thread while waiting for measurement. Must be awaited from a coroutine
+    // executed by the scheduler. Device should be attached to I2CBus
+    Task<SensorDataAHT10> getSensorDataAsync(AsyncScheduler& scheduler);
+#endif
+
     inline DeviceI2C* getDevice();
 
 private:
+    bool configure();
     // false - sensor idle and sleeping
     // true - sensor busy and in measurement state
     bool isBusy();
+    static void decodeSensorData(const byte* blockData, SensorDataAHT10& outData);
 };
 
 inline DeviceI2C* AHT10::getDevice()
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_I2C_TCA9548A_HPP
+#define HWIOCPP_I2C_TCA9548A_HPP
+
+#include "I2CBus.hpp"
+
+// TCA9548A (and compatible PCA9548A) 8-channel I2C multiplexer.
+// Datasheet: https://www.ti.com/lit/ds/symlink/tca9548a.pdf
+//
+// Mux doesn't need a driver object: channels are selected by I2CBus based on I2CMuxRoute of the
+// transaction. Usage:
+//     auto bus = I2CBus::getBus(1);
+//     AHT10 sensors[8];
+//
+//     for (int i = 0 ; i < TCA9548A_CHANNELS_COUNT; ++i)
+//     {
+//         sensors[i].initialize(bus, tca9548aRoute(TCA9548A_ADDRESS_DEFAULT, i));
+//     }
+//
+// NOTE: if mux is reset (RESET pin) or power cycled call I2CBus::invalidateMuxState()
+
+#define TCA9548A_ADDRESS_DEFAULT        0x70 // A0-A2 connected to GND. Range is 0x70-0x77
+#define TCA9548A_CHANNELS_COUNT         8
+
+inline I2CMuxRoute tca9548aRoute(const int muxAddress, const int channel)
+{
+    I2CMuxRoute route;
+
+    route.muxAddress = muxAddress;
+    route.channel = channel;
+    return route;
+}
+
+#endif // HWIOCPP_I2C_TCA9548A_HPP
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_SPI_DEVICESPI_HPP
+#define HWIOCPP_SPI_DEVICESPI_HPP
+
+#include "GenericDevice.hpp"
+#include <linux/spi/spidev.h>
+#include <vector>
+
+// doc: https://www.kernel.org/doc/html/latest/spi/spidev.html
+// Enable: sudo raspi-config -> Interface Options -> SPI
+
+#define SPI_DEFAULT_SPEED_HZ            (1000000)
+
+enum class SpiMode
+{
+    MODE_0,// CPOL=0, CPHA=0
+    MODE_1,// CPOL=0, CPHA=1
+    MODE_2,// CPOL=1, CPHA=0
+    MODE_3// CPOL=1, CPHA=1
+};
+
+enum class SpiBitOrder
+{
+    MSB_FIRST,
+    LSB_FIRST
+};
+
+enum class SpiChipSelect
+{
+    ACTIVE_LOW,
+    ACTIVE_HIGH,
+    NONE// chip select is not used (or is controlled manually)
+};
+
+// Single segment of a SPI message. Buffers are owned by the caller and are passed to the kernel as is.
+// txBuffer or rxBuffer can be nullptr (zeros are sent if txBuffer is nullptr)
+struct SpiTransfer
+{
+    const byte* txBuffer = nullptr;
+    byte* rxBuffer = nullptr;
+    size_t size = 0;
+    uint32_t speedHz = 0;// 0 - use device speed
+    uint16_t delayUs = 0;// delay after this segment
+    uint8_t bitsPerWord = 0;// 0 - use device setting
+    bool deselectAfter = false;// deassert chip select after this segment (before the next one)
+};
+
+// SPI device over /dev/spidevB.C
+//
+// Multiple segments can be submitted with a single SPI_IOC_MESSAGE ioctl. Chip select stays asserted between
+// segments of the same message unless SpiTransfer::deselectAfter is set. Device settings (mode, speed, bit order)
+// are cached, so setting them to the same value doesn't result in extra ioctl calls.
+//
+// NOTE: total size of all segments in a single message is limited by spidev 'bufsiz' module parameter (4096 by default)
+class DeviceSPI: public GenericDevice
+{
+public:
+    DeviceSPI() = default;
+    virtual ~DeviceSPI();
+
+    bool openDevice(const int bus,
+                    const int chipSelect,
+                    const SpiMode mode = SpiMode::MODE_0,
+                    const uint32_t speedHz = SPI_DEFAULT_SPEED_HZ,
+                    const SpiChipSelect csMode = SpiChipSelect::ACTIVE_LOW);
+    void closeDevice() override;
+    bool isDeviceOpen() override;
+
+    bool setMode(const SpiMode mode);
+    bool setBitOrder(const SpiBitOrder bitOrder);
+    bool setChipSelectMode(const SpiChipSelect csMode);
+    bool setSpeed(const uint32_t speedHz);
+    bool setBitsPerWord(const uint8_t bits);
+    inline uint32_t getSpeed() const;
+    inline size_t getMaxMessageSize() const;
+
+    // Submits all segments as a single message (one ioctl)
+    bool transfer(const SpiTransfer* segments, const size_t segmentsCount);
+    bool transfer(const std::vector<SpiTransfer>& segments);
+    // Full-duplex transfer of a single buffer
+    bool transfer(const byte* txBuffer, byte* rxBuffer, const size_t bytesCount);
+
+    int readBuffer(byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
+    bool writeBuffer(const byte* buffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
+    bool writeBuffer(const std::vector<byte>& buffer, const Endianness bytesOrder = Endianness::NATIVE);
+
+    bool writeData(const uint8_t data);
+    bool writeData(const uint16_t data, const Endianness bytesOrder = Endianness::NATIVE);
+    bool writeData(const uint32_t data, const Endianness bytesOrder = Endianness::NATIVE);
+
+    // Writes command and then reads response without deasserting chip select (typical register read)
+    int writeThenRead(const byte* cmd, const size_t cmdSize, byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder = Endianness::NATIVE);
+
+private:
+    bool applyModeFlags();
+
+private:
+    int mFD = INVALID_FD;
+    uint8_t mModeFlags = 0;// SPI_MODE_X | SPI_CS_HIGH | SPI_NO_CS | SPI_LSB_FIRST
+    SpiMode mMode = SpiMode::MODE_0;
+    SpiBitOrder mBitOrder = SpiBitOrder::MSB_FIRST;
+    SpiChipSelect mCsMode = SpiChipSelect::ACTIVE_LOW;
+    uint32_t mSpeed = SPI_DEFAULT_SPEED_HZ;
+    uint8_t mBitsPerWord = 8;
+    size_t mMaxMessageSize = 4096;
+    std::vector<struct spi_ioc_transfer> mMessage;// reused between calls
+};
+
+inline bool DeviceSPI::isDeviceOpen()
+{
+    return mFD != INVALID_FD;
+}
+
+inline uint32_t DeviceSPI::getSpeed() const
+{
+    return mSpeed;
+}
+
+inline size_t DeviceSPI::getMaxMessageSize() const
+{
+    return mMaxMessageSize;
+}
+
+#endif // HWIOCPP_SPI_DEVICESPI_HPP
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_SPI_MCP3008_HPP
+#define HWIOCPP_SPI_MCP3008_HPP
+
+#include "mcp3x08.hpp"
+
+// max SPI clock: 3.6 MHz at 5V, 1.35 MHz at 2.7V
+class MCP3008: public MCP3X08
+{
+public:
+    MCP3008()
+    {
+        mResolution = 10;
+    }
+
+    virtual ~MCP3008() = default;
+};
+
+// 4 channels version of MCP3008
+class MCP3004: public MCP3008
+{
+public:
+    MCP3004()
+    {
+        mChannelsCount = 4;
+    }
+
+    virtual ~MCP3004() = default;
+};
+
+#endif // HWIOCPP_SPI_MCP3008_HPP
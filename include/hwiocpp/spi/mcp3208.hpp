@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_SPI_MCP3208_HPP
+#define HWIOCPP_SPI_MCP3208_HPP
+
+#include "mcp3x08.hpp"
+
+// max SPI clock: 2 MHz at 5V, 1 MHz at 2.7V
+class MCP3208: public MCP3X08
+{
+public:
+    MCP3208()
+    {
+        mResolution = 12;
+    }
+
+    virtual ~MCP3208() = default;
+};
+
+// 4 channels version of MCP3208
+class MCP3204: public MCP3208
+{
+public:
+    MCP3204()
+    {
+        mChannelsCount = 4;
+    }
+
+    virtual ~MCP3204() = default;
+};
+
+#endif // HWIOCPP_SPI_MCP3208_HPP
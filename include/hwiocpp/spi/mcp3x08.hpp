@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_SPI_MCP3X08_HPP
+#define HWIOCPP_SPI_MCP3X08_HPP
+
+#include "DeviceSPI.hpp"
+#include "AnalogInputDevice.hpp"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#define MCP3X08_CHANNELS                    (8)
+
+// Channel configuration for differential readings. Can be used everywhere instead of channel number.
+// Pairs: 0 - CH0+/CH1-, 1 - CH0-/CH1+, 2 - CH2+/CH3-, 3 - CH2-/CH3+, 4 - CH4+/CH5-, 5 - CH4-/CH5+, 6 - CH6+/CH7-, 7 - CH6-/CH7+
+#define MCP3X08_DIFFERENTIAL(_pair)         static_cast<uint8_t>(0x80 | ((_pair) & 0x07))
+
+// Timing diagnostics of continuous acquisition
+struct AdcAcquisitionStats
+{
+    uint64_t framesAcquired = 0;
+    uint64_t framesDropped = 0;// ring buffer was full
+    uint64_t missedDeadlines = 0;// sampling started more than one period late
+    uint64_t maxStartLatency = 0;// nanoseconds between scheduled and actual frame start
+    uint64_t maxFrameDuration = 0;// nanoseconds spent on reading a single frame
+    uint64_t transferErrors = 0;
+};
+
+// MCP3004/3008 (10 bit) and MCP3204/3208 (12 bit) SPI ADCs.
+//
+// Every conversion is a separate 3 bytes SPI transfer. Multiple channels are read with a single
+// SPI_IOC_MESSAGE ioctl (one segment per channel, chip select is toggled between them).
+//
+// Continuous acquisition reads a frame (list of channels) at fixed rate from a dedicated thread and
+// stores it in a single-producer/single-consumer ring buffer. Frames are scheduled to absolute deadlines,
+// so jitter doesn't accumulate.
+class MCP3X08: public DeviceSPI, public AnalogInputDevice
+{
+public:
+    virtual ~MCP3X08();
+
+    bool initialize(const int bus, const int chipSelect, const uint32_t speedHz = SPI_DEFAULT_SPEED_HZ);
+
+    // @brief Sets reference voltage (VREF pin) used by computeVolts()
+    inline void setReferenceVoltage(const float volts);
+    inline uint8_t getResolution() const;
+
+    uint8_t getChannelsCount() const override;
+    int16_t readSingleChannel(uint8_t channel) override;
+    float computeVolts(int16_t counts) override;
+
+    // @brief Reads differential input (see MCP3X08_DIFFERENTIAL for pairs)
+    int16_t readDifferential(const uint8_t pair);
+
+    // @brief Reads multiple channels with a single ioctl
+    // @param channels channel numbers or MCP3X08_DIFFERENTIAL() values
+    bool readChannels(const uint8_t* channels, const size_t channelsCount, int16_t* outValues);
+
+    // @brief Starts continuous acquisition of the channels
+    // @param sampleRateHz frames per second
+    // @param bufferFrames capacity of the ring buffer (in frames)
+    bool startAcquisition(const std::vector<uint8_t>& channels, const unsigned int sampleRateHz, const size_t bufferFrames);
+    void stopAcquisition();
+    inline bool isAcquiring() const;
+
+    // @brief Takes acquired frames from the ring buffer
+    // @param outValues buffer for maxFrames * channels values
+    // @param outTimestamps buffer for maxFrames timestamps (CLOCK_MONOTONIC, start of frame). Can be nullptr
+    // @return amount of frames copied
+    size_t readFrames(int16_t* outValues, struct timespec* outTimestamps, const size_t maxFrames);
+    size_t getAvailableFrames() const;
+
+    AdcAcquisitionStats getAcquisitionStats() const;
+
+protected:
+    // resolution in bits (10 or 12). must be set by specific device class
+    uint8_t mResolution = 0;
+    uint8_t mChannelsCount = MCP3X08_CHANNELS;
+
+private:
+    bool readChannelsLocked(const uint8_t* channels, const size_t channelsCount, int16_t* outValues);
+    void threadAcquisition();
+
+private:
+    std::mutex mSync;
+    float mReferenceVoltage = 3.3f;
+
+    // preallocated transfer buffers (3 bytes per channel)
+    std::vector<byte> mTxBuffer;
+    std::vector<byte> mRxBuffer;
+    std::vector<SpiTransfer> mSegments;
+
+    // acquisition
+    std::thread mAcquisitionThread;
+    std::atomic<bool> mIsAcquiring{false};
+    std::vector<uint8_t> mAcquisitionChannels;
+    uint64_t mAcquisitionPeriod = 0;// nanoseconds
+    std::vector<int16_t> mRingValues;
+    std::vector<struct timespec> mRingTimestamps;
+    size_t mRingCapacity = 0;
+    std::atomic<size_t> mRingHead{0};// next frame to write (producer)
+    std::atomic<size_t> mRingTail{0};// next frame to read (consumer)
+
+    std::atomic<uint64_t> mFramesAcquired{0};
+    std::atomic<uint64_t> mFramesDropped{0};
+    std::atomic<uint64_t> mMissedDeadlines{0};
+    std::atomic<uint64_t> mMaxStartLatency{0};
+    std::atomic<uint64_t> mMaxFrameDuration{0};
+    std::atomic<uint64_t> mTransferErrors{0};
+};
+
+inline void MCP3X08::setReferenceVoltage(const float volts)
+{
+    mReferenceVoltage = volts;
+}
+
+inline uint8_t MCP3X08::getResolution() const
+{
+    return mResolution;
+}
+
+inline bool MCP3X08::isAcquiring() const
+{
+    return mIsAcquiring;
+}
+
+#endif // HWIOCPP_SPI_MCP3X08_HPP
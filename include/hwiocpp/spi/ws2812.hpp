@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_SPI_WS2812_HPP
+#define HWIOCPP_SPI_WS2812_HPP
+
+#include "DeviceSPI.hpp"
+#include <vector>
+
+// every data bit is sent as 3 SPI bits (1 -> 110, 0 -> 100), so 2.4 MHz gives 1.25 us per data bit
+#define WS2812_SPI_SPEED_HZ             (2400000)
+// SK6812 needs at least 80 us of low level to latch data (WS2812B - 50 us)
+#define WS2812_RESET_US                 (100)
+
+#define WS2812_COLOR(_r, _g, _b)        ((static_cast<uint32_t>(_r) << 16) | (static_cast<uint32_t>(_g) << 8) | static_cast<uint32_t>(_b))
+#define WS2812_COLOR_W(_r, _g, _b, _w)  ((static_cast<uint32_t>(_w) << 24) | WS2812_COLOR(_r, _g, _b))
+
+enum class LedStripType
+{
+    WS2812,// GRB
+    SK6812_RGBW// GRBW
+};
+
+// WS2812/WS2812B/SK6812 addressable LED strip connected to SPI MOSI pin.
+//
+// Pixels are kept in a framebuffer (0xWWRRGGBB). SPI symbols are kept in a separate persistent buffer and
+// only pixels which were changed since the last show() are encoded again (using a lookup table which
+// maps a color byte to 3 SPI bytes).
+//
+// NOTE: whole strip should fit into a single SPI message (9 or 12 bytes per LED + reset). Increase
+//       spidev.bufsiz if needed, otherwise strip is sent in multiple messages and gaps between them
+//       could be long enough for LEDs to latch partial frame.
+// NOTE: on Raspberry Pi SPI clock is derived from core clock. Set core_freq_min=core_freq (or
+//       force_turbo=1) in /boot/config.txt so it doesn't change
+class WS2812: public DeviceSPI
+{
+public:
+    WS2812() = default;
+    virtual ~WS2812() = default;
+
+    bool initialize(const int bus, const int chipSelect, const size_t ledsCount, const LedStripType type = LedStripType::WS2812);
+
+    inline size_t getLedsCount() const;
+
+    void setPixel(const size_t index, const uint32_t color);
+    void setPixel(const size_t index, const uint8_t red, const uint8_t green, const uint8_t blue, const uint8_t white = 0);
+    uint32_t getPixel(const size_t index) const;
+    void fill(const uint32_t color);
+    void clear();
+
+    // Global brightness (0-255). Applied during encoding, framebuffer keeps original colors
+    void setBrightness(const uint8_t brightness);
+    inline uint8_t getBrightness() const;
+
+    // Encodes changed pixels and sends whole strip
+    bool show();
+
+    inline bool hasChanges() const;
+
+private:
+    void markDirty(const size_t index);
+    void markAllDirty();
+    void encodePixel(const size_t index);
+
+private:
+    LedStripType mType = LedStripType::WS2812;
+    size_t mChannelsCount = 3;
+    uint8_t mBrightness = 255;
+    uint8_t mBrightnessTable[256];
+    std::vector<uint32_t> mPixels;
+    std::vector<uint64_t> mDirtyMask;// one bit per pixel
+    bool mHasChanges = false;
+    std::vector<byte> mSymbols;// encoded strip + reset
+};
+
+inline size_t WS2812::getLedsCount() const
+{
+    return mPixels.size();
+}
+
+inline uint8_t WS2812::getBrightness() const
+{
+    return mBrightness;
+}
+
+inline bool WS2812::hasChanges() const
+{
+    return mHasChanges;
+}
+
+#endif // HWIOCPP_SPI_WS2812_HPP
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_UTILS_ASYNCSCHEDULER_HPP
+#define HWIOCPP_UTILS_ASYNCSCHEDULER_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using AsyncCallback_t = std::function<void()>;
+
+// Single-threaded event loop. Callbacks are executed by the thread which calls run().
+//
+// Callbacks can be posted from any thread (for example from I2CBus worker when a transaction is completed).
+// Delayed callbacks are used instead of sleeping, so a single thread can drive many slow devices at the same time.
+// It's also used to resume coroutines (see utils/Task.hpp).
+class AsyncScheduler
+{
+    struct TimedCallback
+    {
+        struct timespec deadline;
+        uint64_t sequence;// keeps order of callbacks with the same deadline
+        AsyncCallback_t callback;
+    };
+
+public:
+    AsyncScheduler() = default;
+    ~AsyncScheduler() = default;
+
+    void post(const AsyncCallback_t& callback);
+    // Executes callback at absolute CLOCK_MONOTONIC time
+    void postAt(const struct timespec& deadline, const AsyncCallback_t& callback);
+    void postAfter(const unsigned int milliseconds, const AsyncCallback_t& callback);
+
+    // Active tasks keep run() working even if there are no queued callbacks (for example while
+    // waiting for an I2C transaction to complete)
+    void retainTask();
+    void releaseTask();
+
+    // Executes callbacks until stop() is called or there is no more work (no queued or delayed
+    // callbacks and no active tasks)
+    void run();
+    void stop();
+
+private:
+    static bool isLater(const TimedCallback& left, const TimedCallback& right);
+
+private:
+    std::mutex mSync;
+    std::condition_variable mWakeUp;
+    std::deque<AsyncCallback_t> mQueue;
+    std::vector<TimedCallback> mTimers;// min-heap by deadline
+    uint64_t mTimersSequence = 0;
+    size_t mActiveTasks = 0;
+    bool mStopRequested = false;
+};
+
+#endif // HWIOCPP_UTILS_ASYNCSCHEDULER_HPP
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_UTILS_BUFFERVIEW_HPP
+#define HWIOCPP_UTILS_BUFFERVIEW_HPP
+
+#include "utils/ByteOrder.hpp"
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+// Non-owning view of a contiguous buffer (same idea as C++20 std::span). Can be implicitly created from
+// C arrays, std::array, std::vector and other containers with data() and size(), so functions which
+// accept it don't force callers to allocate temporary containers (use std::array instead of initializer lists).
+//
+// NOTE: view must not outlive the buffer
+template <typename T>
+class BufferView
+{
+public:
+    BufferView() = default;
+
+    BufferView(T* data, const size_t size)
+        : mData(data)
+        , mSize(size)
+    {}
+
+    template <size_t N>
+    BufferView(T (&data)[N])
+        : mData(data)
+        , mSize(N)
+    {}
+
+    template <typename Container,
+              typename = typename std::enable_if<std::is_convertible<decltype(std::declval<Container&>().data()), T*>::value>::type>
+    BufferView(Container&& container)
+        : mData(container.data())
+        , mSize(container.size())
+    {}
+
+    inline T* data() const;
+    inline size_t size() const;
+    inline bool empty() const;
+    inline T& operator[](const size_t index) const;
+    // returns part of the view (clamped to the view size)
+    inline BufferView<T> subview(const size_t offset, const size_t count) const;
+
+private:
+    T* mData = nullptr;
+    size_t mSize = 0;
+};
+
+using ByteView = BufferView<byte>;
+using ConstByteView = BufferView<const byte>;
+
+template <typename T>
+inline T* BufferView<T>::data() const
+{
+    return mData;
+}
+
+template <typename T>
+inline size_t BufferView<T>::size() const
+{
+    return mSize;
+}
+
+template <typename T>
+inline bool BufferView<T>::empty() const
+{
+    return (0 == mSize);
+}
+
+template <typename T>
+inline T& BufferView<T>::operator[](const size_t index) const
+{
+    return mData[index];
+}
+
+template <typename T>
+inline BufferView<T> BufferView<T>::subview(const size_t offset, const size_t count) const
+{
+    const size_t validOffset = (offset < mSize ? offset : mSize);
+    const size_t validCount = (count < mSize - validOffset ? count : mSize - validOffset);
+
+    return BufferView<T>(mData + validOffset, validCount);
+}
+
+#endif // HWIOCPP_UTILS_BUFFERVIEW_HPP
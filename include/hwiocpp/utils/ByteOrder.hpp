@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_UTILS_BYTEORDER_HPP
+#define HWIOCPP_UTILS_BYTEORDER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+typedef unsigned char  byte;
+
+enum class Endianness
+{
+    BIG,
+    LITTLE,
+    NATIVE
+};
+
+// Bytes order of the target is known at compile time, so conversions are reduced to a single
+// bswap/rev instruction (or to nothing)
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  #define HWIOCPP_NATIVE_BYTES_ORDER    Endianness::BIG
+#else
+  #define HWIOCPP_NATIVE_BYTES_ORDER    Endianness::LITTLE
+#endif
+
+constexpr bool isByteSwapNeeded(const Endianness expectedOrder)
+{
+    return (Endianness::NATIVE != expectedOrder) && (HWIOCPP_NATIVE_BYTES_ORDER != expectedOrder);
+}
+
+constexpr uint8_t byteSwap(const uint8_t value)
+{
+    return value;
+}
+
+constexpr uint16_t byteSwap(const uint16_t value)
+{
+    return __builtin_bswap16(value);
+}
+
+constexpr uint32_t byteSwap(const uint32_t value)
+{
+    return __builtin_bswap32(value);
+}
+
+constexpr uint64_t byteSwap(const uint64_t value)
+{
+    return __builtin_bswap64(value);
+}
+
+constexpr int16_t byteSwap(const int16_t value)
+{
+    return static_cast<int16_t>(__builtin_bswap16(static_cast<uint16_t>(value)));
+}
+
+constexpr int32_t byteSwap(const int32_t value)
+{
+    return static_cast<int32_t>(__builtin_bswap32(static_cast<uint32_t>(value)));
+}
+
+template <typename T>
+constexpr T toBytesOrder(const T value, const Endianness expectedOrder)
+{
+    return (true == isByteSwapNeeded(expectedOrder) ? byteSwap(value) : value);
+}
+
+// Reads integer stored in a buffer with specified bytes order. Buffer doesn't have to be aligned
+template <typename T>
+inline T loadBytes(const byte* buffer, const Endianness bytesOrder)
+{
+    T value;
+
+    memcpy(&value, buffer, sizeof(value));
+    return toBytesOrder(value, bytesOrder);
+}
+
+template <typename T>
+inline void storeBytes(byte* buffer, const T value, const Endianness bytesOrder)
+{
+    const T orderedValue = toBytesOrder(value, bytesOrder);
+
+    memcpy(buffer, &orderedValue, sizeof(orderedValue));
+}
+
+template <typename T>
+inline T loadBE(const byte* buffer)
+{
+    return loadBytes<T>(buffer, Endianness::BIG);
+}
+
+template <typename T>
+inline T loadLE(const byte* buffer)
+{
+    return loadBytes<T>(buffer, Endianness::LITTLE);
+}
+
+template <typename T>
+inline void storeBE(byte* buffer, const T value)
+{
+    storeBytes<T>(buffer, value, Endianness::BIG);
+}
+
+template <typename T>
+inline void storeLE(byte* buffer, const T value)
+{
+    storeBytes<T>(buffer, value, Endianness::LITTLE);
+}
+
+// Reverses whole buffer in place (buffer is treated as a single multi-byte value)
+inline void reverseBytes(byte* buffer, const size_t bytesCount)
+{
+    for (size_t i = 0 ; i < bytesCount / 2; ++i)
+    {
+        const byte temp = buffer[i];
+
+        buffer[i] = buffer[bytesCount - 1 - i];
+        buffer[bytesCount - 1 - i] = temp;
+    }
+}
+
+inline void reverseBytes(byte* outBuffer, const byte* buffer, const size_t bytesCount)
+{
+    for (size_t i = 0 ; i < bytesCount; ++i)
+    {
+        outBuffer[bytesCount - 1 - i] = buffer[i];
+    }
+}
+
+// Converts array of words in place. Loops are simple enough to be vectorized by compiler
+// (pshufb/vrev16 when building with -O3 or -ftree-vectorize)
+inline void swapWords(uint16_t* words, const size_t wordsCount)
+{
+    for (size_t i = 0 ; i < wordsCount; ++i)
+    {
+        words[i] = __builtin_bswap16(words[i]);
+    }
+}
+
+inline void swapWords(uint32_t* words, const size_t wordsCount)
+{
+    for (size_t i = 0 ; i < wordsCount; ++i)
+    {
+        words[i] = __builtin_bswap32(words[i]);
+    }
+}
+
+template <typename T>
+inline void normalizeWords(T* words, const size_t wordsCount, const Endianness bytesOrder)
+{
+    if (true == isByteSwapNeeded(bytesOrder))
+    {
+        swapWords(words, wordsCount);
+    }
+}
+
+// Temporary buffer which is allocated on stack if it's small enough. Used instead of per-object buffers
+// so that objects don't share mutable state between calls
+template <size_t LocalSize>
+class ScratchBuffer
+{
+public:
+    byte* get(const size_t size)
+    {
+        byte* result = mLocal;
+
+        if (size > LocalSize)
+        {
+            mHeap.resize(size);
+            result = mHeap.data();
+        }
+
+        return result;
+    }
+
+private:
+    byte mLocal[LocalSize];
+    std::vector<byte> mHeap;
+};
+
+#endif // HWIOCPP_UTILS_BYTEORDER_HPP
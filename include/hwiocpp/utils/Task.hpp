@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_UTILS_TASK_HPP
+#define HWIOCPP_UTILS_TASK_HPP
+
+// C++20 coroutines support. Enabled with HWIOCPP_COROUTINES cmake option
+#ifdef HWIOCPP_ENABLE_COROUTINES
+
+#include "utils/AsyncScheduler.hpp"
+#include "GenericDevice.hpp"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+template <typename T>
+class Task;
+
+namespace hwiocpp_detail
+{
+    struct TaskPromiseBase
+    {
+        // resumes coroutine which is awaiting this task
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+
+                return (continuation ? continuation : std::noop_coroutine());
+            }
+
+            void await_resume() noexcept
+            {}
+        };
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void unhandled_exception() noexcept
+        {
+            // library doesn't use exceptions
+            std::terminate();
+        }
+
+        std::coroutine_handle<> continuation;
+    };
+
+    // Coroutine which is started immediately and destroys itself when finished
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() noexcept
+            {}
+
+            void unhandled_exception() noexcept
+            {
+                std::terminate();
+            }
+        };
+    };
+}
+
+// Lazy coroutine. Starts when it's awaited (or passed to spawnTask()) and resumes awaiting coroutine when finished
+template <typename T>
+class Task
+{
+public:
+    struct promise_type: public hwiocpp_detail::TaskPromiseBase
+    {
+        Task get_return_object() noexcept
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        void return_value(T value)
+        {
+            result = std::move(value);
+        }
+
+        std::optional<T> result;
+    };
+
+    Task(Task&& other) noexcept
+        : mHandle(std::exchange(other.mHandle, nullptr))
+    {}
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (mHandle)
+        {
+            mHandle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaitingCoroutine) noexcept
+    {
+        mHandle.promise().continuation = awaitingCoroutine;
+        return mHandle;
+    }
+
+    T await_resume()
+    {
+        return std::move(*mHandle.promise().result);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : mHandle(handle)
+    {}
+
+private:
+    std::coroutine_handle<promise_type> mHandle;
+};
+
+template <>
+class Task<void>
+{
+public:
+    struct promise_type: public hwiocpp_detail::TaskPromiseBase
+    {
+        Task get_return_object() noexcept
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        void return_void() noexcept
+        {}
+    };
+
+    Task(Task&& other) noexcept
+        : mHandle(std::exchange(other.mHandle, nullptr))
+    {}
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (mHandle)
+        {
+            mHandle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaitingCoroutine) noexcept
+    {
+        mHandle.promise().continuation = awaitingCoroutine;
+        return mHandle;
+    }
+
+    void await_resume() noexcept
+    {}
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : mHandle(handle)
+    {}
+
+private:
+    std::coroutine_handle<promise_type> mHandle;
+};
+
+// Suspends coroutine and resumes it from AsyncScheduler at the specified time
+class SchedulerSleepAwaiter
+{
+public:
+    SchedulerSleepAwaiter(AsyncScheduler& scheduler, const struct timespec& deadline)
+        : mScheduler(scheduler)
+        , mDeadline(deadline)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        mScheduler.postAt(mDeadline, [handle](){ handle.resume(); });
+    }
+
+    void await_resume() noexcept
+    {}
+
+private:
+    AsyncScheduler& mScheduler;
+    struct timespec mDeadline;
+};
+
+inline SchedulerSleepAwaiter sleepUntil(AsyncScheduler& scheduler, const struct timespec& deadline)
+{
+    return SchedulerSleepAwaiter(scheduler, deadline);
+}
+
+inline SchedulerSleepAwaiter sleepFor(AsyncScheduler& scheduler, const unsigned int milliseconds)
+{
+    return SchedulerSleepAwaiter(scheduler, GenericDevice::addNanoseconds(GenericDevice::getMonotonicTime(), milliseconds * 1000000ULL));
+}
+
+namespace hwiocpp_detail
+{
+    inline DetachedTask runDetached(AsyncScheduler& scheduler, Task<void> task)
+    {
+        co_await task;
+        scheduler.releaseTask();
+    }
+}
+
+// Starts task without waiting for its result. Task is executed until its first suspension point in the
+// calling thread, so it should be called before AsyncScheduler::run() or from the scheduler thread.
+// Scheduler keeps running until all spawned tasks are finished
+inline void spawnTask(AsyncScheduler& scheduler, Task<void> task)
+{
+    scheduler.retainTask();
+    hwiocpp_detail::runDetached(scheduler, std::move(task));
+}
+
+#endif // HWIOCPP_ENABLE_COROUTINES
+
+#endif // HWIOCPP_UTILS_TASK_HPP
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_UTILS_THREADPOLICY_HPP
+#define HWIOCPP_UTILS_THREADPOLICY_HPP
+
+#include <stddef.h>
+#include <vector>
+#include <mutex>
+#include <pthread.h>
+
+// Threads created by hwiocpp
+enum class HwioThread
+{
+    EDGE_MONITORING,// DeviceGPIO edge events
+    TIMER_WHEEL,// TimerWheel worker
+    ADC_ACQUISITION,// continuous ADC sampling (MCP3X08)
+    STEPPER_MOTION,// step pulses generation (StepperController)
+    I2C_BUS,// I2CBus transactions worker
+
+    COUNT
+};
+
+enum class ThreadSchedPolicy
+{
+    DEFAULT,// don't change scheduling of the thread
+    OTHER,// SCHED_OTHER
+    FIFO,// SCHED_FIFO
+    RR// SCHED_RR
+};
+
+struct ThreadPolicy
+{
+    ThreadSchedPolicy scheduling = ThreadSchedPolicy::DEFAULT;
+    int priority = 0;// used with FIFO and RR (1..99)
+    std::vector<int> cpuAffinity;// CPUs thread is allowed to run on (empty - don't change)
+    bool lockMemory = false;// mlockall(MCL_CURRENT | MCL_FUTURE). NOTE: affects whole process
+    size_t stackPrefaultSize = 0;// amount of stack (in bytes) to touch when thread starts to avoid page faults later
+};
+
+// Result of applying a policy. Every flag is true if corresponding setting was requested and applied successfully.
+// Error fields contain errno values (0 - no error or setting was not requested)
+struct ThreadPolicyStatus
+{
+    bool schedulingApplied = false;
+    bool affinityApplied = false;
+    bool memoryLocked = false;
+    bool stackPrefaulted = false;
+    bool stackPrefaultClamped = false;// requested stackPrefaultSize didn't fit into thread stack and was reduced
+    size_t stackPrefaultedSize = 0;// amount of stack (in bytes) which was actually prefaulted
+
+    int schedulingError = 0;
+    int affinityError = 0;
+    int memoryLockError = 0;
+
+    inline bool isOk() const;
+};
+
+// Library-wide configuration of threads created by hwiocpp.
+//
+// Policy can be set for all threads (setDefaultPolicy) or for a specific thread type (setPolicy).
+// Scheduling and affinity changes are applied immediately to already running threads and to all threads
+// started later. Memory locking and stack prefaulting are applied when a thread starts.
+//
+// NOTE: SCHED_FIFO/SCHED_RR and mlockall usually require root or CAP_SYS_NICE/CAP_IPC_LOCK
+class ThreadPolicyManager
+{
+public:
+    static void setDefaultPolicy(const ThreadPolicy& policy);
+    static void setPolicy(const HwioThread type, const ThreadPolicy& policy);
+    static void resetPolicy(const HwioThread type);
+    static ThreadPolicy getPolicy(const HwioThread type);
+
+    // Returns result of the last attempt to apply policy to a thread of the given type
+    static ThreadPolicyStatus getLastStatus(const HwioThread type);
+
+    // Must be called by hwiocpp threads when they start and before they exit
+    static ThreadPolicyStatus onThreadStarted(const HwioThread type);
+    static void onThreadFinished(const HwioThread type);
+
+private:
+    static const ThreadPolicy& getPolicyLocked(const HwioThread type);
+    static ThreadPolicyStatus applyPolicy(const HwioThread type, const pthread_t thread, const bool isStarting);
+    static void applyToRunningThreads();
+};
+
+inline bool ThreadPolicyStatus::isOk() const
+{
+    return (0 == schedulingError) && (0 == affinityError) && (0 == memoryLockError);
+}
+
+#endif // HWIOCPP_UTILS_THREADPOLICY_HPP
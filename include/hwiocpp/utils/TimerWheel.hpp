@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#ifndef HWIOCPP_UTILS_TIMERWHEEL_HPP
+#define HWIOCPP_UTILS_TIMERWHEEL_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using TimerID_t = uint64_t;
+#define INVALID_TIMER_ID                (0)
+
+using TimerCallback_t = std::function<void()>;
+
+#define TIMERWHEEL_DEFAULT_TICK_US      (1000)
+
+// Hierarchical timer wheel driven by a single timerfd and a single worker thread.
+// Starting and canceling a timer are O(1) operations.
+//
+// Wheel has 4 levels with 64 slots each, which covers 2^24 ticks (~4.6 hours with 1 ms tick).
+// Longer timers are supported, but will be cascaded through the top level multiple times.
+//
+// NOTE: callbacks are executed in the timer thread, so they should be short
+class TimerWheel
+{
+    struct TimerNode
+    {
+        TimerCallback_t callback;
+        uint64_t expireTick = 0;
+        uint32_t periodTicks = 0;
+        uint32_t generation = 1;
+        int prev = -1;
+        int next = -1;
+        int slot = -1;// index in mSlots (-1 if timer is not active)
+    };
+
+public:
+    explicit TimerWheel(const unsigned int tickUs = TIMERWHEEL_DEFAULT_TICK_US);
+    ~TimerWheel();
+
+    // Library-wide instance used by GPIO devices. Started on first use
+    static TimerWheel& getInstance();
+
+    bool start();
+    void stop();
+    inline bool isRunning() const;
+
+    // Starts a timer. Callback is called after delayMs and then every periodMs (if it's not 0)
+    TimerID_t startTimer(const unsigned int delayMs, const TimerCallback_t& callback, const unsigned int periodMs = 0);
+
+    // Cancels a timer. If timer callback is being executed in the timer thread at the moment,
+    // waits for it to finish (unless called from the callback itself)
+    bool cancelTimer(const TimerID_t id);
+
+    bool isTimerActive(const TimerID_t id);
+    size_t getActiveTimersCount();
+
+private:
+    void threadTimer();
+    void processTick(std::unique_lock<std::mutex>& lock);
+    void cascade(const int level);
+
+    void insertNode(const int index);
+    void unlinkNode(const int index);
+    int allocateNode();
+    void releaseNode(const int index);
+    int findNode(const TimerID_t id) const;
+
+    uint64_t msToTicks(const unsigned int milliseconds) const;
+    void armTimer(const bool enable);
+
+private:
+    unsigned int mTickUs;
+    int mTimerFD = -1;
+    std::thread mThread;
+    bool mIsRunning = false;
+
+    std::mutex mSync;
+    std::condition_variable mCallbackDone;
+
+    uint64_t mCurrentTick = 0;
+    std::deque<TimerNode> mNodes;// deque keeps references valid when new nodes are added
+    std::vector<int> mSlots;// heads of the timers lists (levels * slots)
+    int mFreeNodes = -1;// head of free nodes list
+    size_t mActiveTimers = 0;
+    bool mIsArmed = false;
+
+    std::vector<TimerID_t> mExpiredNodes;
+    TimerID_t mRunningTimer = INVALID_TIMER_ID;
+    std::thread::id mThreadID;
+};
+
+inline bool TimerWheel::isRunning() const
+{
+    return mIsRunning;
+}
+
+#endif // HWIOCPP_UTILS_TIMERWHEEL_HPP
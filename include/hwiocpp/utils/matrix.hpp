@@ -7,6 +7,8 @@
 
 #include <list>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
 template <typename T>
 class matrix
@@ -97,4 +99,325 @@ private:
     std::vector<T> mData;
 };
 
+// Bit-packed specialization. Every row is stored as a sequence of 64-bit words, so
+// row operations, popcount and comparison are done a word at a time.
+// NOTE: unused bits in the last word of every row are always kept at 0
+template <>
+class matrix<bool>
+{
+public:
+    using value_type = bool;
+    using word_type = uint64_t;
+    using Coordinate_t = std::pair<size_t, size_t>;// <x, y>
+
+    // Forward iterator over coordinates of the elements which are different in two matrices.
+    // Differences are calculated on the fly from XOR of the matrices words, so no memory is allocated.
+    class DiffIterator
+    {
+    public:
+        DiffIterator() = default;
+
+        // startIndex - index of the word to start search from (use wordsCount to create end() iterator)
+        DiffIterator(const word_type* left,
+                     const word_type* right,
+                     const size_t wordsCount,
+                     const size_t wordsPerRow,
+                     const size_t startIndex)
+            : mLeft(left)
+            , mRight(right)
+            , mWordsCount(wordsCount)
+            , mWordsPerRow(wordsPerRow)
+        {
+            findNextWord(startIndex);
+        }
+
+        inline Coordinate_t operator*() const
+        {
+            return std::make_pair((mWordIndex % mWordsPerRow) * BITS_PER_WORD + __builtin_ctzll(mBits),
+                                  mWordIndex / mWordsPerRow);
+        }
+
+        inline DiffIterator& operator++()
+        {
+            // clear lowest set bit
+            mBits &= (mBits - 1);
+
+            if (0 == mBits)
+            {
+                findNextWord(mWordIndex + 1);
+            }
+
+            return *this;
+        }
+
+        inline bool operator==(const DiffIterator& other) const
+        {
+            return (mWordIndex == other.mWordIndex) && (mBits == other.mBits);
+        }
+
+        inline bool operator!=(const DiffIterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        void findNextWord(size_t index)
+        {
+            mBits = 0;
+
+            for ( ; index < mWordsCount; ++index)
+            {
+                mBits = mLeft[index] ^ mRight[index];
+
+                if (0 != mBits)
+                {
+                    break;
+                }
+            }
+
+            mWordIndex = index;
+        }
+
+    private:
+        const word_type* mLeft = nullptr;
+        const word_type* mRight = nullptr;
+        size_t mWordsCount = 0;
+        size_t mWordsPerRow = 1;
+        size_t mWordIndex = 0;
+        word_type mBits = 0;
+    };
+
+    // Range of differences returned by compare().
+    // NOTE: references data of both compared matrices. They must not be modified while range is used
+    class MatrixDiff
+    {
+    public:
+        MatrixDiff() = default;
+        MatrixDiff(const DiffIterator& itBegin, const DiffIterator& itEnd)
+            : mBegin(itBegin)
+            , mEnd(itEnd)
+        {}
+
+        inline DiffIterator begin() const
+        {
+            return mBegin;
+        }
+
+        inline DiffIterator end() const
+        {
+            return mEnd;
+        }
+
+        inline bool empty() const
+        {
+            return mBegin == mEnd;
+        }
+
+    private:
+        DiffIterator mBegin;
+        DiffIterator mEnd;
+    };
+
+    using MatrixDiff_t = MatrixDiff;
+
+public:
+    matrix() : matrix(0) {}
+
+    explicit matrix(const std::size_t n) : matrix(n, n, false) {}
+
+    matrix(const std::size_t w, const std::size_t h, const bool defaultValue)
+        : mWidth(w)
+        , mHeight(h)
+        , mWordsPerRow((w + BITS_PER_WORD - 1) / BITS_PER_WORD)
+        , mData(mWordsPerRow * h, 0)
+    {
+        if (true == defaultValue)
+        {
+            for (size_t r = 0 ; r < mHeight; ++r)
+            {
+                setRowValue(r, true);
+            }
+        }
+    }
+
+    inline std::size_t width() const
+    {
+        return mWidth;
+    }
+
+    inline std::size_t height() const
+    {
+        return mHeight;
+    }
+
+    inline bool operator()(const size_t x, const size_t y) const
+    {
+        return (mData[wordIndex(x, y)] & bitMask(x)) != 0;
+    }
+
+    inline void set(const size_t x, const size_t y, const bool value)
+    {
+        if (true == value)
+        {
+            mData[wordIndex(x, y)] |= bitMask(x);
+        }
+        else
+        {
+            mData[wordIndex(x, y)] &= ~bitMask(x);
+        }
+    }
+
+    void setRowValue(const size_t y, const bool value)
+    {
+        if (y < mHeight)
+        {
+            word_type* row = &mData[y * mWordsPerRow];
+
+            for (size_t i = 0 ; i < mWordsPerRow; ++i)
+            {
+                row[i] = (true == value ? ~word_type(0) : 0);
+            }
+
+            if ((true == value) && (mWordsPerRow > 0))
+            {
+                row[mWordsPerRow - 1] &= lastWordMask();
+            }
+        }
+    }
+
+    void setColumnValue(const size_t x, const bool value)
+    {
+        if (x < mWidth)
+        {
+            for (size_t r = 0 ; r < mHeight; ++r)
+            {
+                set(x, r, value);
+            }
+        }
+    }
+
+    // returns amount of elements set to true
+    size_t count() const
+    {
+        size_t result = 0;
+
+        for (const word_type curWord: mData)
+        {
+            result += __builtin_popcountll(curWord);
+        }
+
+        return result;
+    }
+
+    // returns amount of elements set to true in a row
+    size_t countRow(const size_t y) const
+    {
+        size_t result = 0;
+
+        if (y < mHeight)
+        {
+            const word_type* row = &mData[y * mWordsPerRow];
+
+            for (size_t i = 0 ; i < mWordsPerRow; ++i)
+            {
+                result += __builtin_popcountll(row[i]);
+            }
+        }
+
+        return result;
+    }
+
+    // returns true if at least one element is set to true
+    bool isAnySet() const
+    {
+        bool result = false;
+
+        for (size_t i = 0 ; (i < mData.size()) && (false == result); ++i)
+        {
+            result = (0 != mData[i]);
+        }
+
+        return result;
+    }
+
+    // returns true if at least one element in a row is set to true
+    bool isRowAnySet(const size_t y) const
+    {
+        bool result = false;
+
+        if (y < mHeight)
+        {
+            const word_type* row = &mData[y * mWordsPerRow];
+
+            for (size_t i = 0 ; (i < mWordsPerRow) && (false == result); ++i)
+            {
+                result = (0 != row[i]);
+            }
+        }
+
+        return result;
+    }
+
+    // Returns range of coordinates which have different values in both matrices.
+    // Result is empty if matrices have different size.
+    MatrixDiff_t compare(const matrix<bool>& right) const
+    {
+        MatrixDiff_t diff;
+
+        if ((mWidth == right.mWidth) && (mHeight == right.mHeight))
+        {
+            diff = MatrixDiff_t(DiffIterator(mData.data(), right.mData.data(), mData.size(), mWordsPerRow, 0),
+                                DiffIterator(mData.data(), right.mData.data(), mData.size(), mWordsPerRow, mData.size()));
+        }
+
+        return diff;
+    }
+
+    // Writes coordinates of different elements to a caller provided buffer.
+    // Returns amount of coordinates written (never more than bufferSize).
+    size_t compare(const matrix<bool>& right, Coordinate_t* outBuffer, const size_t bufferSize) const
+    {
+        size_t count = 0;
+
+        if (nullptr != outBuffer)
+        {
+            const MatrixDiff_t diff = compare(right);
+
+            for (auto it = diff.begin(); (it != diff.end()) && (count < bufferSize); ++it)
+            {
+                outBuffer[count] = *it;
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+private:
+    static constexpr size_t BITS_PER_WORD = sizeof(word_type) * 8;
+
+    inline size_t wordIndex(const size_t x, const size_t y) const
+    {
+        return y * mWordsPerRow + x / BITS_PER_WORD;
+    }
+
+    static inline word_type bitMask(const size_t x)
+    {
+        return word_type(1) << (x % BITS_PER_WORD);
+    }
+
+    inline word_type lastWordMask() const
+    {
+        const size_t usedBits = mWidth % BITS_PER_WORD;
+
+        return (0 == usedBits ? ~word_type(0) : (word_type(1) << usedBits) - 1);
+    }
+
+private:
+    std::size_t mWidth = 0;
+    std::size_t mHeight = 0;
+    std::size_t mWordsPerRow = 0;
+    std::vector<word_type> mData;
+};
+
 #endif // HWIOCPP_UTILS_MATRIX_HPP
\ No newline at end of file
@@ -5,28 +5,194 @@
 #include "GenericDevice.hpp"
 #include <unistd.h>
 #include <cstdio>
+#include <cerrno>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+#define NS_IN_SECOND                    (1000000000LL)
+
+#define CALIBRATION_SLEEP_NS            (100000)
+#define CALIBRATION_SLEEP_ATTEMPTS      (8)
+#define CALIBRATION_SPIN_LOOPS          (100000)
+#define CALIBRATION_SPIN_MARGIN_NS      (10000)
+#define MIN_SPIN_THRESHOLD_NS           (20000)
+#define MAX_SPIN_THRESHOLD_NS           (500000)
+
+// waits shorter than this are done with a calibrated loop (clock_gettime() is too expensive for them)
+#define LOOP_WAIT_THRESHOLD_NS          (2000)
+
+#if defined(__aarch64__) || defined(__arm__)
+  #define CPU_RELAX()                   asm volatile("yield" ::: "memory")
+#elif defined(__x86_64__) || defined(__i386__)
+  #define CPU_RELAX()                   __builtin_ia32_pause()
+#else
+  #define CPU_RELAX()                   asm volatile("" ::: "memory")
+#endif
+
+static std::once_flag sCalibrationFlag;
+static std::atomic<uint64_t> sSpinThreshold(DEFAULT_SPIN_THRESHOLD_NS);
+static std::atomic<uint64_t> sSpinLoopsPerUs(0);
+
+static std::atomic<uint64_t> sWaitsCount(0);
+static std::atomic<uint64_t> sTotalOvershoot(0);
+static std::atomic<uint64_t> sMaxOvershoot(0);
+static std::atomic<uint64_t> sLastOvershoot(0);
+
+static void spinLoop(const uint64_t loops)
+{
+    for (uint64_t i = 0 ; i < loops; ++i)
+    {
+        CPU_RELAX();
+    }
+}
 
-GenericDevice::GenericDevice()
+static void ensureCalibrated()
 {
-    int i = 1;
+    std::call_once(sCalibrationFlag, [](){ GenericDevice::calibrateTiming(); });
+}
 
-    if (reinterpret_cast<char*>(&i)[0] == 1)
+void GenericDevice::wait(const unsigned int milliseconds)
+{
+    waitNs(static_cast<uint64_t>(milliseconds) * 1000000);
+}
+
+void GenericDevice::waitUs(const unsigned int microseconds)
+{
+    waitNs(static_cast<uint64_t>(microseconds) * 1000);
+}
+
+void GenericDevice::waitNs(const uint64_t nanoseconds)
+{
+    if (nanoseconds < LOOP_WAIT_THRESHOLD_NS)
     {
-        printf("Endianness::LITTLE\n");
-        mNativeBytesOrder = Endianness::LITTLE;
+        ensureCalibrated();
+        spinLoop((nanoseconds * sSpinLoopsPerUs.load(std::memory_order_relaxed) + 999) / 1000);
     }
     else
     {
-        printf("Endianness::BIG\n");
-        mNativeBytesOrder = Endianness::BIG;
+        waitUntil(addNanoseconds(getMonotonicTime(), nanoseconds));
     }
+}
+
+uint64_t GenericDevice::waitUntil(const struct timespec& deadline)
+{
+    ensureCalibrated();
 
-    mBuffer.resize(4, 0);
+    const uint64_t spinThreshold = sSpinThreshold.load(std::memory_order_relaxed);
+    struct timespec now = getMonotonicTime();
+    int64_t remaining = diffNanoseconds(deadline, now);
+
+    if (remaining > static_cast<int64_t>(spinThreshold))
+    {
+        const struct timespec wakeup = addNanoseconds(now, remaining - spinThreshold);
+
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, nullptr))
+        {}
+
+        now = getMonotonicTime();
+        remaining = diffNanoseconds(deadline, now);
+    }
+
+    while (remaining > 0)
+    {
+        CPU_RELAX();
+        now = getMonotonicTime();
+        remaining = diffNanoseconds(deadline, now);
+    }
+
+    const uint64_t overshoot = static_cast<uint64_t>(-remaining);
+    uint64_t maxOvershoot = sMaxOvershoot.load(std::memory_order_relaxed);
+
+    sWaitsCount.fetch_add(1, std::memory_order_relaxed);
+    sTotalOvershoot.fetch_add(overshoot, std::memory_order_relaxed);
+    sLastOvershoot.store(overshoot, std::memory_order_relaxed);
+
+    while ((overshoot > maxOvershoot) &&
+           (false == sMaxOvershoot.compare_exchange_weak(maxOvershoot, overshoot, std::memory_order_relaxed)))
+    {}
+
+    return overshoot;
 }
 
-void GenericDevice::wait(const unsigned int milliseconds)
+struct timespec GenericDevice::getMonotonicTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now;
+}
+
+struct timespec GenericDevice::addNanoseconds(const struct timespec& base, const uint64_t nanoseconds)
+{
+    struct timespec result = base;
+    const uint64_t nsec = static_cast<uint64_t>(base.tv_nsec) + nanoseconds;
+
+    result.tv_sec += static_cast<time_t>(nsec / NS_IN_SECOND);
+    result.tv_nsec = static_cast<long>(nsec % NS_IN_SECOND);
+
+    return result;
+}
+
+int64_t GenericDevice::diffNanoseconds(const struct timespec& end, const struct timespec& start)
+{
+    return (static_cast<int64_t>(end.tv_sec) - static_cast<int64_t>(start.tv_sec)) * NS_IN_SECOND +
+           (static_cast<int64_t>(end.tv_nsec) - static_cast<int64_t>(start.tv_nsec));
+}
+
+void GenericDevice::calibrateTiming()
 {
-    usleep(milliseconds * 1000);
+    // speed of busy loop (used for sub-microsecond waits)
+    struct timespec start = getMonotonicTime();
+
+    spinLoop(CALIBRATION_SPIN_LOOPS);
+
+    const int64_t loopsDuration = std::max<int64_t>(diffNanoseconds(getMonotonicTime(), start), 1);
+
+    sSpinLoopsPerUs.store(std::max<uint64_t>((CALIBRATION_SPIN_LOOPS * 1000ULL) / loopsDuration, 1), std::memory_order_relaxed);
+
+    // how late clock_nanosleep() wakes up. Part of the wait which is shorter than this will be spinned
+    int64_t maxLatency = 0;
+
+    for (int i = 0 ; i < CALIBRATION_SLEEP_ATTEMPTS; ++i)
+    {
+        const struct timespec deadline = addNanoseconds(getMonotonicTime(), CALIBRATION_SLEEP_NS);
+
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr))
+        {}
+
+        maxLatency = std::max(maxLatency, diffNanoseconds(getMonotonicTime(), deadline));
+    }
+
+    sSpinThreshold.store(std::min<uint64_t>(std::max<uint64_t>(maxLatency + CALIBRATION_SPIN_MARGIN_NS, MIN_SPIN_THRESHOLD_NS),
+                                            MAX_SPIN_THRESHOLD_NS),
+                         std::memory_order_relaxed);
+}
+
+uint64_t GenericDevice::getSpinThreshold()
+{
+    ensureCalibrated();
+    return sSpinThreshold.load(std::memory_order_relaxed);
+}
+
+TimingStats GenericDevice::getTimingStats()
+{
+    TimingStats stats;
+
+    stats.waitsCount = sWaitsCount.load(std::memory_order_relaxed);
+    stats.totalOvershoot = sTotalOvershoot.load(std::memory_order_relaxed);
+    stats.maxOvershoot = sMaxOvershoot.load(std::memory_order_relaxed);
+    stats.lastOvershoot = sLastOvershoot.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+void GenericDevice::resetTimingStats()
+{
+    sWaitsCount.store(0, std::memory_order_relaxed);
+    sTotalOvershoot.store(0, std::memory_order_relaxed);
+    sMaxOvershoot.store(0, std::memory_order_relaxed);
+    sLastOvershoot.store(0, std::memory_order_relaxed);
 }
 
 double GenericDevice::remap(double value, double oldMin, double oldMax, double newMin, double newMax)
@@ -59,48 +225,3 @@ double GenericDevice::remap(double value, double oldMin, double oldMax, double n
 
     return newValue;
 }
-
-uint16_t GenericDevice::normalizeBytes(const uint16_t value, const Endianness expectedOrder)
-{
-    if ((expectedOrder != Endianness::NATIVE) && (expectedOrder != mNativeBytesOrder))
-    {
-        return (GET_BYTE0(value) << 8) | GET_BYTE1(value);
-    }
-
-    return value;
-}
-
-uint32_t GenericDevice::normalizeBytes(const uint32_t value, const Endianness expectedOrder)
-{
-    if ((expectedOrder != Endianness::NATIVE) && (expectedOrder != mNativeBytesOrder))
-    {
-        return (GET_BYTE0(value) << 24) |
-               (GET_BYTE1(value) << 16) |
-               (GET_BYTE2(value) << 8) |
-               GET_BYTE3(value);
-    }
-
-    return value;
-}
-
-const byte* GenericDevice::normalizeBytes(const byte* buffer, const size_t bytesCount, const Endianness expectedOrder)
-{
-    const byte* result = buffer;
-
-    if ((expectedOrder != Endianness::NATIVE) && (expectedOrder != mNativeBytesOrder))
-    {
-        if (mBuffer.size() < bytesCount)
-        {
-            mBuffer.resize(bytesCount);
-        }
-
-        for (int i = 0 ; i < bytesCount; ++i)
-        {
-            mBuffer[bytesCount - 1 - i] = buffer[i];
-        }
-        
-        result = mBuffer.data();
-    }
-
-    return result;
-}
\ No newline at end of file
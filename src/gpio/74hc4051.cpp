@@ -22,6 +22,8 @@ bool Dev74HC4051::initialize(const RP_GPIO pinA,
     {
         mPinInhibitor = pinInhibitor;
         mPinsGroup = registerPinsGroup({pinC, pinB, pinA});
+        // force channel selection
+        mCurrentChannel = -1;
         selectChannel(initialChannel);
         result = true;
     }
@@ -36,17 +38,24 @@ bool Dev74HC4051::selectChannel(const unsigned int channel)
 
     if ((true == isDeviceOpen()) && (channel <= DEV_74HC4051_MAX_CHANNELS))
     {
-        //                                 C  B  A
-        const std::vector<int> vals[8] = {{0, 0, 0},    // X0
-                                          {0, 0, 1},    // X1
-                                          {0, 1, 0},    // X2
-                                          {0, 1, 1},    // X3
-                                          {1, 0, 0},    // X4
-                                          {1, 0, 1},    // X5
-                                          {1, 1, 0},    // X6
-                                          {1, 1, 1}};   // X7
+        //                                        C  B  A
+        static const std::vector<int> vals[8] = {{0, 0, 0},    // X0
+                                                 {0, 0, 1},    // X1
+                                                 {0, 1, 0},    // X2
+                                                 {0, 1, 1},    // X3
+                                                 {1, 0, 0},    // X4
+                                                 {1, 0, 1},    // X5
+                                                 {1, 1, 0},    // X6
+                                                 {1, 1, 1}};   // X7
 
-        result = DeviceGPIO::setGroupValues(mPinsGroup, vals[channel]);
+        if (static_cast<int>(channel) != mCurrentChannel)
+        {
+            result = DeviceGPIO::setGroupValues(mPinsGroup, vals[channel]);
+        }
+        else
+        {
+            result = true;
+        }
 
         if (true == result)
         {
@@ -3,11 +3,18 @@
  * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
  */
 #include "gpio/DeviceGPIO.hpp"
+#include "utils/ThreadPolicy.hpp"
 #include <utils/logging.hpp>
 #include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 
 #undef TRACE_CLASS
 #define TRACE_CLASS                         "DeviceGPIO"
@@ -35,6 +42,19 @@
 #define PULLUPDN_OFFSET_2711_2      59
 #define PULLUPDN_OFFSET_2711_3      60
 
+// GPIO registers (offsets in 32bit words)
+#define GPFSEL0                     0
+#define GPSET0                      7
+#define GPCLR0                      10
+#define GPLEV0                      13
+#define GPIO_BANK0_PINS             54
+
+#define GPIO_BCM_CHIP_LABEL         "pinctrl-bcm2"
+
+// max amount of edge events read from a line at once (matches kernel queue size)
+#define EDGE_EVENTS_BATCH_SIZE      16
+#define EDGE_EVENTS_WAIT_TIMEOUT_MS 5000
+
 
 std::map<std::string, DeviceGPIO::GpioChipInfo> DeviceGPIO::sOpenChips;
 
@@ -113,6 +133,7 @@ void DeviceGPIO::closeDevice()
 
         if (sOpenChips.end() != itChip)
         {
+            cancelAllTimedActions();
             closeAllPins();
 
             if (mMonitoringThread.joinable())
@@ -121,6 +142,12 @@ void DeviceGPIO::closeDevice()
                 mMonitoringThread.join();
             }
 
+            if (mMonitoringWakeFD >= 0)
+            {
+                close(mMonitoringWakeFD);
+                mMonitoringWakeFD = -1;
+            }
+
             mChip = nullptr;
             mChipName.clear();
 
@@ -463,32 +490,154 @@ bool DeviceGPIO::getGroupValues(const GpioPinsGroupID_t id, std::vector<int>& ou
 void DeviceGPIO::shiftWrite(const byte val, const RP_GPIO dataPin, const RP_GPIO clockPin, const RP_GPIO latchPin)
 {
     byte mask = 0x80;
-    
+    // each signal change is aligned to absolute deadline, so time spent in libgpiod calls is not added to delays
+    struct timespec edgeTime = getMonotonicTime();
+    auto nextEdge = [&]()
+    {
+        if (mBitBangHalfPeriod > 0)
+        {
+            edgeTime = addNanoseconds(edgeTime, mBitBangHalfPeriod);
+            waitUntil(edgeTime);
+        }
+    };
+
     // put latch down to start data sending
     setPinValue(clockPin, 0);
     setPinValue(latchPin, 0);
+    nextEdge();
     setPinValue(clockPin, 1);
 
     // load data in reverse order
     for (int i = 0; i < 8 ; ++i)
     {
+        nextEdge();
         setPinValue(clockPin, 0);
         setPinValue(dataPin, (val & mask ? 1 : 0));
+        nextEdge();
         setPinValue(clockPin, 1);
         mask >>= 1;
     }
 
     // put latch up to store data on register
+    nextEdge();
     setPinValue(clockPin, 0);
-    printf("------------------------\n");
     setPinValue(latchPin, 1);
-    printf("------------------------\n");
+    nextEdge();
     setPinValue(clockPin, 1);
 }
 
+TimerID_t DeviceGPIO::pulsePin(const RP_GPIO pin, const int value, const unsigned int durationMs)
+{
+    TRACE_CALL_DEBUG_ARGS("pin=%d, value=%d, durationMs=%u", SC2INT(pin), value, durationMs);
+    TimerID_t id = INVALID_TIMER_ID;
+
+    if (true == setPinValue(pin, value))
+    {
+        const int restoreValue = (0 == value ? 1 : 0);
+
+        id = startTimedAction(durationMs, [this, pin, restoreValue](){ setPinValue(pin, restoreValue); });
+    }
+
+    return id;
+}
+
+TimerID_t DeviceGPIO::setPinValueDelayed(const RP_GPIO pin, const int value, const unsigned int delayMs)
+{
+    TRACE_CALL_DEBUG_ARGS("pin=%d, value=%d, delayMs=%u", SC2INT(pin), value, delayMs);
+    TimerID_t id = INVALID_TIMER_ID;
+
+    if (true == isDeviceOpen())
+    {
+        id = startTimedAction(delayMs, [this, pin, value](){ setPinValue(pin, value); });
+    }
+
+    return id;
+}
+
+TimerID_t DeviceGPIO::togglePin(const RP_GPIO pin, const unsigned int periodMs, const unsigned int togglesCount)
+{
+    TRACE_CALL_DEBUG_ARGS("pin=%d, periodMs=%u, togglesCount=%u", SC2INT(pin), periodMs, togglesCount);
+    TimerID_t id = INVALID_TIMER_ID;
+
+    if ((periodMs > 0) && (true == setPinValue(pin, 1)))
+    {
+        // timer needs to know its own ID to stop after the last toggle
+        std::shared_ptr<TimerID_t> selfID = std::make_shared<TimerID_t>(INVALID_TIMER_ID);
+        int value = 1;
+        unsigned int toggles = 0;
+
+        id = startTimedAction(periodMs,
+                              [this, pin, togglesCount, selfID, value, toggles]() mutable
+                              {
+                                  value = (0 == value ? 1 : 0);
+                                  setPinValue(pin, value);
+                                  ++toggles;
+
+                                  if ((togglesCount > 0) && (toggles >= togglesCount))
+                                  {
+                                      TimerWheel::getInstance().cancelTimer(*selfID);
+                                  }
+                              },
+                              periodMs);
+        *selfID = id;
+    }
+
+    return id;
+}
+
+bool DeviceGPIO::cancelTimedAction(const TimerID_t id)
+{
+    bool result = false;
+    auto itAction = std::find(mTimedActions.begin(), mTimedActions.end(), id);
+
+    if (mTimedActions.end() != itAction)
+    {
+        result = TimerWheel::getInstance().cancelTimer(id);
+        mTimedActions.erase(itAction);
+    }
+
+    return result;
+}
+
+void DeviceGPIO::cancelAllTimedActions()
+{
+    if (false == mTimedActions.empty())
+    {
+        TimerWheel& timers = TimerWheel::getInstance();
+
+        for (const TimerID_t id: mTimedActions)
+        {
+            timers.cancelTimer(id);
+        }
+
+        mTimedActions.clear();
+    }
+}
+
+TimerID_t DeviceGPIO::startTimedAction(const unsigned int delayMs, const TimerCallback_t& callback, const unsigned int periodMs)
+{
+    TimerWheel& timers = TimerWheel::getInstance();
+
+    // forget about actions which are already finished
+    mTimedActions.erase(std::remove_if(mTimedActions.begin(),
+                                       mTimedActions.end(),
+                                       [&](const TimerID_t id){ return (false == timers.isTimerActive(id)); }),
+                        mTimedActions.end());
+
+    const TimerID_t id = timers.startTimer(delayMs, callback, periodMs);
+
+    if (INVALID_TIMER_ID != id)
+    {
+        mTimedActions.push_back(id);
+    }
+
+    return id;
+}
+
 bool DeviceGPIO::openPin(const RP_GPIO pin, const GPIO_PIN_MODE mode, const GPIO_PIN_PULL pullMode)
 {
     TRACE_CALL_DEBUG_ARGS("pin=%d, mode=%d, pullMode=%d", SC2INT(pin), SC2INT(mode), SC2INT(pullMode));
+    std::lock_guard<std::recursive_mutex> lock(mLinesSync);
     bool result = false;
     auto itPin = mActiveLines.find(pin);
 
@@ -525,6 +674,10 @@ bool DeviceGPIO::openPin(const RP_GPIO pin, const GPIO_PIN_MODE mode, const GPIO
                         case GPIO_PIN_MODE::OUTPUT:
                             gpioConfig.request_type = GPIOD_LINE_REQUEST_DIRECTION_OUTPUT;
                             break;
+                        case GPIO_PIN_MODE::OPEN_DRAIN:
+                            gpioConfig.request_type = GPIOD_LINE_REQUEST_DIRECTION_OUTPUT;
+                            gpioConfig.flags = GPIOD_LINE_REQUEST_FLAG_OPEN_DRAIN;
+                            break;
                         case GPIO_PIN_MODE::AS_IS:
                             gpioConfig.request_type = GPIOD_LINE_REQUEST_DIRECTION_AS_IS;
                             break;
@@ -534,7 +687,8 @@ bool DeviceGPIO::openPin(const RP_GPIO pin, const GPIO_PIN_MODE mode, const GPIO
                             break;
                     }
 
-                    if ((true == result) && (0 == gpiod_line_request(newPinInfo.line, &gpioConfig, 0)))
+                    // open drain line is released by default
+                    if ((true == result) && (0 == gpiod_line_request(newPinInfo.line, &gpioConfig, (GPIO_PIN_MODE::OPEN_DRAIN == mode ? 1 : 0))))
                     {
                         mActiveLines.insert({pin, newPinInfo});
                         printf("------ mActiveLines=%lu, newPinInfo.line=%p\n", mActiveLines.size(), newPinInfo.line);
@@ -586,6 +740,7 @@ bool DeviceGPIO::openPin(const RP_GPIO pin, const GPIO_PIN_MODE mode, const GPIO
 bool DeviceGPIO::openPin(const RP_GPIO pin, const GPIO_PIN_PULL pullMode)
 {
     TRACE_CALL_DEBUG_ARGS("pin=%d, pullMode=%d", SC2INT(pin), SC2INT(pullMode));
+    std::lock_guard<std::recursive_mutex> lock(mLinesSync);
     bool result = false;
     auto itPin = mActiveLines.find(pin);
 
@@ -624,23 +779,34 @@ bool DeviceGPIO::openPin(const RP_GPIO pin, const GPIO_PIN_PULL pullMode)
 
 void DeviceGPIO::closePin(const RP_GPIO pin)
 {
+    std::lock_guard<std::recursive_mutex> lock(mLinesSync);
     auto itPin = mActiveLines.find(pin);
 
     if (itPin != mActiveLines.end())
     {
+        const bool wasMonitored = itPin->second.monitored;
+
         gpiod_line_release(itPin->second.line);
         mActiveLines.erase(itPin);
+
+        if (true == wasMonitored)
+        {
+            wakeEdgeMonitoring();
+        }
     }
 }
 
 void DeviceGPIO::closeAllPins()
 {
+    std::lock_guard<std::recursive_mutex> lock(mLinesSync);
+
     for (auto it = mActiveLines.begin() ; it != mActiveLines.end(); ++it)
     {
         gpiod_line_release(it->second.line);
     }
 
     mActiveLines.clear();
+    wakeEdgeMonitoring();
 }
 
 void DeviceGPIO::registerEdgeEventsCallback(const EdgeEventCallback_t& callback)
@@ -648,9 +814,15 @@ void DeviceGPIO::registerEdgeEventsCallback(const EdgeEventCallback_t& callback)
     mEdgeCallback = callback;
 }
 
+void DeviceGPIO::registerTimestampedEdgeEventsCallback(const TimestampedEdgeEventCallback_t& callback)
+{
+    mTimestampedEdgeCallback = callback;
+}
+
 void DeviceGPIO::unregisterEdgeEventsCallback()
 {
     mEdgeCallback = nullptr;
+    mTimestampedEdgeCallback = nullptr;
 
     // if (true == mMonitoringThread.joinable())
     // {
@@ -662,15 +834,19 @@ bool DeviceGPIO::startEdgeEventsMonitorining(const RP_GPIO pin)
 {
     bool result = false;
 
-    if (mEdgeCallback)
+    if (true == hasEdgeEventsCallback())
     {
         TRACE_CALL_ARGS("pin=%d (v2)", SC2INT(pin));
+        std::lock_guard<std::recursive_mutex> lock(mLinesSync);
         auto itPin = mActiveLines.find(pin);
 
         if (itPin != mActiveLines.end())
         {
             if (0 == gpiod_line_request_both_edges_events(itPin->second.line, GPIO_CONSUMER_NAME))
             {
+                itPin->second.monitored = true;
+
+                // monitoring thread clears mIsMonitoring under mLinesSync right before exiting
                 if ((false == mIsMonitoring) && (true == mMonitoringThread.joinable()))
                 {
                     mMonitoringThread.join();
@@ -678,8 +854,23 @@ bool DeviceGPIO::startEdgeEventsMonitorining(const RP_GPIO pin)
 
                 if (false == mMonitoringThread.joinable())
                 {
+                    if (mMonitoringWakeFD < 0)
+                    {
+                        mMonitoringWakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+                        if (mMonitoringWakeFD < 0)
+                        {
+                            TRACE_ERROR("eventfd failed. new edge lines will be picked up after wait timeout");
+                        }
+                    }
+
+                    mIsMonitoring = true;
                     mMonitoringThread = std::thread(std::bind(&DeviceGPIO::threadEdgeMonitoring, this));
                 }
+                else
+                {
+                    wakeEdgeMonitoring();
+                }
 
                 result = true;
             }
@@ -697,7 +888,7 @@ void DeviceGPIO::startEdgeEventsMonitorining(const GpioPinsGroupID_t groupID)
 {
     TRACE_CALL_ARGS("groupID=%d", SC2INT(groupID));
     
-    if (mEdgeCallback)
+    if (true == hasEdgeEventsCallback())
     {
         auto itGroup = mGroupPins.find(groupID);
 
@@ -726,6 +917,7 @@ void DeviceGPIO::startEdgeEventsMonitorining(const GpioPinsGroupID_t groupID)
 bool DeviceGPIO::changePinDirection(const RP_GPIO pin, const GPIO_PIN_MODE direction)
 {
     TRACE_CALL_DEBUG_ARGS("pin=%d, direction=%d", SC2INT(pin), SC2INT(direction));
+    std::lock_guard<std::recursive_mutex> lock(mLinesSync);
     bool result = false;
     auto itPin = mActiveLines.find(pin);
 
@@ -739,12 +931,18 @@ bool DeviceGPIO::changePinDirection(const RP_GPIO pin, const GPIO_PIN_MODE direc
 
             switch(direction)
             {
+                case GPIO_PIN_MODE::EDGE_DETECTION:
+                    res = (true == startEdgeEventsMonitorining(pin) ? 0 : -1);
+                    break;
                 case GPIO_PIN_MODE::INPUT:
                     res = gpiod_line_request_input(itPin->second.line, GPIO_CONSUMER_NAME);
                     break;
                 case GPIO_PIN_MODE::OUTPUT:
                     res = gpiod_line_request_output(itPin->second.line, GPIO_CONSUMER_NAME, 0);
                     break;
+                case GPIO_PIN_MODE::OPEN_DRAIN:
+                    res = gpiod_line_request_output_flags(itPin->second.line, GPIO_CONSUMER_NAME, GPIOD_LINE_REQUEST_FLAG_OPEN_DRAIN, 1);
+                    break;
                 default:
                     break;
             }
@@ -753,6 +951,12 @@ bool DeviceGPIO::changePinDirection(const RP_GPIO pin, const GPIO_PIN_MODE direc
             {
                 itPin->second.mode = direction;
                 result = true;
+
+                // previous line request is released. monitoring thread must stop waiting on it
+                if ((true == itPin->second.monitored) && (GPIO_PIN_MODE::EDGE_DETECTION != direction))
+                {
+                    wakeEdgeMonitoring();
+                }
             }
             else
             {
@@ -896,6 +1100,81 @@ bool DeviceGPIO::changeGroupDirection(const GpioPinsGroupID_t id, const GPIO_PIN
     return result;
 }
 
+struct gpiod_line* DeviceGPIO::getPinLine(const RP_GPIO pin) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mLinesSync);
+    struct gpiod_line* line = nullptr;
+    auto itPin = mActiveLines.find(pin);
+
+    if (mActiveLines.end() != itPin)
+    {
+        line = itPin->second.line;
+    }
+
+    return line;
+}
+
+bool DeviceGPIO::getPinRegisters(const RP_GPIO pin, GpioPinRegisters& outRegisters)
+{
+    bool result = false;
+    const int pinIndex = SC2INT(pin);
+
+    // registers layout is only known for gpiochip0 of BCM2835/6/7 and BCM2711
+    if ((true == isDeviceOpen()) && (pinIndex >= 0) && (pinIndex < GPIO_BANK0_PINS) &&
+        (0 == strncmp(gpiod_chip_label(mChip), GPIO_BCM_CHIP_LABEL, sizeof(GPIO_BCM_CHIP_LABEL) - 1)))
+    {
+        volatile uint32_t* base = getGpioRegistersBase();
+
+        if (nullptr != base)
+        {
+            outRegisters.set = base + GPSET0 + pinIndex / 32;
+            outRegisters.clear = base + GPCLR0 + pinIndex / 32;
+            outRegisters.level = base + GPLEV0 + pinIndex / 32;
+            outRegisters.function = base + GPFSEL0 + pinIndex / 10;
+            outRegisters.mask = (1u << (pinIndex % 32));
+            outRegisters.functionShift = (pinIndex % 10) * 3;
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+volatile uint32_t* DeviceGPIO::getGpioRegistersBase()
+{
+    static volatile uint32_t* sRegisters = nullptr;
+    static std::once_flag sMapFlag;
+
+    // registers stay mapped until process exits
+    std::call_once(sMapFlag,
+                   []()
+                   {
+                       int fd = open("/dev/gpiomem", O_RDWR | O_SYNC | O_CLOEXEC);
+
+                       if (fd >= 0)
+                       {
+                           void* mem = mmap(0, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+                           if (MAP_FAILED != mem)
+                           {
+                               sRegisters = reinterpret_cast<volatile uint32_t*>(mem);
+                           }
+                           else
+                           {
+                               TRACE_ERROR("failed to map GPIO registers");
+                           }
+
+                           close(fd);
+                       }
+                       else
+                       {
+                           TRACE_ERROR("failed to open /dev/gpiomem");
+                       }
+                   });
+
+    return sRegisters;
+}
+
 int DeviceGPIO::gpio_get_pull(unsigned int nr)
 {
     unsigned int offset = (nr % 16) * 2;
@@ -1084,45 +1363,80 @@ void DeviceGPIO::threadEdgeMonitoring()
 {
     TRACE_CALL();
 
-    mIsMonitoring = true;
+    gpiod_line_event eventsInfo[EDGE_EVENTS_BATCH_SIZE];
+    std::vector<struct pollfd> pollFds;
+    std::vector<RP_GPIO> pollPins;
+
+    ThreadPolicyManager::onThreadStarted(HwioThread::EDGE_MONITORING);
 
     while(true)
     {
-        struct gpiod_line_bulk monitoringBulk = GPIOD_LINE_BULK_INITIALIZER;
+        pollFds.clear();
+        pollPins.clear();
 
-        for (auto it = mActiveLines.begin(); it != mActiveLines.end(); ++it)
         {
-            if (GPIO_PIN_MODE::EDGE_DETECTION == it->second.mode)
+            std::lock_guard<std::recursive_mutex> lock(mLinesSync);
+            bool hasMonitoredLines = false;
+
+            for (auto it = mActiveLines.begin(); it != mActiveLines.end(); ++it)
+            {
+                if (true == it->second.monitored)
+                {
+                    hasMonitoredLines = true;
+
+                    // line could be temporarily switched to output (see DHT). it's skipped until switched back
+                    if (GPIO_PIN_MODE::EDGE_DETECTION == it->second.mode)
+                    {
+                        pollFds.push_back({gpiod_line_event_get_fd(it->second.line), POLLIN, 0});
+                        pollPins.push_back(it->first);
+                    }
+                }
+            }
+
+            if ((false == hasMonitoredLines) || (false == hasEdgeEventsCallback()))
             {
-                gpiod_line_bulk_add(&monitoringBulk, it->second.line);
+                TRACE_DEBUG("no pins to monitor - exit thread");
+                mIsMonitoring = false;
+                break;
             }
         }
 
-        if ((gpiod_line_bulk_num_lines(&monitoringBulk) > 0) && (nullptr != mEdgeCallback))
-        {
-            struct timespec timeout;
-            struct gpiod_line_bulk eventBulk;
-
-            timeout.tv_sec = 5;
-            timeout.tv_nsec = 0;
+        // last entry is used to interrupt waiting when lines are reconfigured
+        pollFds.push_back({mMonitoringWakeFD, POLLIN, 0});
 
-            int rc = gpiod_line_event_wait_bulk(&monitoringBulk, &timeout, &eventBulk);
+        const int rc = poll(pollFds.data(), pollFds.size(), EDGE_EVENTS_WAIT_TIMEOUT_MS);
 
-            if (rc > 0)
+        if (rc > 0)
+        {
+            for (size_t i = 0 ; i < pollPins.size(); ++i)
             {
-                const unsigned int linesCount = gpiod_line_bulk_num_lines(&eventBulk);
-
-                for (unsigned int i = 0 ; i < linesCount; ++i)
+                if (0 != (pollFds[i].revents & POLLIN))
                 {
-                    gpiod_line* curLine = gpiod_line_bulk_get_line(&eventBulk, i);
-                    RP_GPIO pin = static_cast<RP_GPIO>(gpiod_line_offset(curLine));
-                    gpiod_line_event eventInfo;
+                    const RP_GPIO pin = pollPins[i];
+                    int eventsCount = 0;
 
-                    if (0 == gpiod_line_event_read(curLine, &eventInfo))
                     {
-                        TRACE_DEBUG("pin=%d, event=%d", SC2INT(pin), eventInfo.event_type);
+                        std::lock_guard<std::recursive_mutex> lock(mLinesSync);
+                        auto itPin = mActiveLines.find(pin);
+
+                        // line could have been reconfigured or closed while waiting
+                        if ((mActiveLines.end() != itPin) &&
+                            (GPIO_PIN_MODE::EDGE_DETECTION == itPin->second.mode) &&
+                            (pollFds[i].fd == gpiod_line_event_get_fd(itPin->second.line)))
+                        {
+                            // drain all pending events at once. kernel queue is small and fast signals (DHT, IR, etc) can overflow it
+                            eventsCount = gpiod_line_event_read_multiple(itPin->second.line, eventsInfo, EDGE_EVENTS_BATCH_SIZE);
+                        }
+                    }
+
+                    // callbacks are called without holding mLinesSync so that they can use pins API
+                    for (int e = 0 ; e < eventsCount; ++e)
+                    {
+                        const gpiod_line_event& eventInfo = eventsInfo[e];
                         GPIO_PIN_EDGE_EVENT event = GPIO_PIN_EDGE_EVENT::UNKNOWN;
 
+                        TRACE_DEBUG("pin=%d, event=%d", SC2INT(pin), eventInfo.event_type);
+
                         switch(eventInfo.event_type)
                         {
                             case GPIOD_LINE_EVENT_RISING_EDGE:
@@ -1132,22 +1446,48 @@ void DeviceGPIO::threadEdgeMonitoring()
                                 event = GPIO_PIN_EDGE_EVENT::FALLING_EDGE;
                                 break;
                         }
-                        
-                        mEdgeCallback(pin, event);
+
+                        if (mTimestampedEdgeCallback)
+                        {
+                            mTimestampedEdgeCallback(pin, event, eventInfo.ts);
+                        }
+
+                        if (mEdgeCallback)
+                        {
+                            mEdgeCallback(pin, event);
+                        }
                     }
                 }
             }
-            else if (0 < rc)
+
+            if (0 != (pollFds.back().revents & POLLIN))
             {
-                TRACE_ERROR("gpiod_line_event_wait_bulk -> error");
+                uint64_t wakeCounter = 0;
+
+                if (read(mMonitoringWakeFD, &wakeCounter, sizeof(wakeCounter)) < 0)
+                {
+                    TRACE_ERROR("failed to reset wake up counter");
+                }
             }
         }
-        else
+        else if ((rc < 0) && (EINTR != errno))
         {
-            TRACE_DEBUG("no pins to monitor - exit thread");
-            break;
+            TRACE_ERROR("poll -> error (%d)", errno);
         }
     }
 
-    mIsMonitoring = false;
+    ThreadPolicyManager::onThreadFinished(HwioThread::EDGE_MONITORING);
+}
+
+void DeviceGPIO::wakeEdgeMonitoring()
+{
+    if (mMonitoringWakeFD >= 0)
+    {
+        const uint64_t wakeCounter = 1;
+
+        if (write(mMonitoringWakeFD, &wakeCounter, sizeof(wakeCounter)) < 0)
+        {
+            TRACE_ERROR("failed to wake up edge monitoring thread");
+        }
+    }
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #undef TRACE_CLASS
 #define TRACE_CLASS                         "KeypadMatrix"
 
+static const std::string sEmptyKey;
+
 KeypadMatrix::~KeypadMatrix()
 {
 }
@@ -25,11 +27,14 @@ bool KeypadMatrix::initialize(const std::vector<RP_GPIO>& rowPins, const std::ve
         mColPins = colPins;
         mOnKeyEventCallback = keyEventFunc;
         mKeysState = matrix<bool>(mColPins.size(), mRowPins.size(), false);
+        mPrevKeysState = mKeysState;
+        compileKeymapping();
+        mEventsBuffer.resize(mColPins.size() * mRowPins.size());
+        mColValues.reserve(mColPins.size());
+        mColValuesLow.assign(mColPins.size(), 0);
 
         mColsGroupID = registerPinsGroup(mColPins);
-        std::vector<int> colValuesLow(mColPins.size(), 0);
-
-        setGroupValues(mColsGroupID, colValuesLow);
+        setGroupValues(mColsGroupID, mColValuesLow);
 
         for (RP_GPIO curColPin: mColPins)
         {
@@ -49,7 +54,42 @@ bool KeypadMatrix::initialize(const std::vector<RP_GPIO>& rowPins, const std::ve
 
 void KeypadMatrix::setKeymapping(const KeypadKeyMap_t& mapping)
 {
-    mKeys = mapping;
+    mKeyMapping = mapping;
+    compileKeymapping();
+}
+
+void KeypadMatrix::compileKeymapping()
+{
+    mKeys.assign(mColPins.size() * mRowPins.size(), std::string());
+
+    for (const auto& it: mKeyMapping)
+    {
+        const KeypadKeyCode_t keyCode = getKeyCode(it.first.first, it.first.second);
+
+        if (INVALID_KEYPAD_KEY_CODE != keyCode)
+        {
+            mKeys[keyCode] = it.second;
+        }
+        else if (false == mKeys.empty())
+        {
+            TRACE_ERROR("key <%s> is out of keypad range (x=%d, y=%d)", it.second.c_str(), it.first.first, it.first.second);
+        }
+    }
+}
+
+void KeypadMatrix::setBatchEventsCallback(const KeypadBatchCallback_t& callback)
+{
+    mOnBatchEventsCallback = callback;
+}
+
+const std::string& KeypadMatrix::getKey(const KeypadKeyCode_t keyCode) const
+{
+    if ((keyCode >= 0) && (static_cast<size_t>(keyCode) < mKeys.size()))
+    {
+        return mKeys[keyCode];
+    }
+
+    return sEmptyKey;
 }
 
 void dumpMatrix(const matrix<bool>& m)
@@ -68,17 +108,7 @@ void dumpMatrix(const matrix<bool>& m)
 
 bool KeypadMatrix::hasKeyPressed() const
 {
-    bool isPressed = false;
-
-    for (size_t r = 0 ; (r < mKeysState.height()) && (false == isPressed) ; ++r)
-    {
-        for (size_t c = 0 ; (c < mKeysState.width()) && (false == isPressed); ++c)
-        {
-            isPressed = mKeysState(c, r);
-        }
-    }
-
-    return isPressed;
+    return mKeysState.isAnySet();
 }
 
 // TODO: does pressing multiple keys on the same row causes short?
@@ -88,23 +118,22 @@ void KeypadMatrix::onPinEdgeEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT e
 
     int x = -1;
     int y = -1;
-    KeypadEvent keyEvent = KeypadEvent::UNKNOWN;
-    std::vector<int> colValues;
     auto itRow = std::find(mRowPins.begin(), mRowPins.end(), pin);
 
     if (itRow != mRowPins.end())
     {
-        matrix<bool> oldKeysState = mKeysState;
+        // NOTE: copy assignment reuses already allocated storage
+        mPrevKeysState = mKeysState;
 
         y = itRow - mRowPins.begin();
 
-        if (true == getGroupValues(mColsGroupID, colValues))
+        if (true == getGroupValues(mColsGroupID, mColValues))
         {
-            auto itActiveCol = std::find(colValues.begin(), colValues.end(), 1);
+            auto itActiveCol = std::find(mColValues.begin(), mColValues.end(), 1);
 
-            if (itActiveCol != colValues.end())
+            if (itActiveCol != mColValues.end())
             {
-                x = itActiveCol - colValues.begin();
+                x = itActiveCol - mColValues.begin();
             }
         }
 
@@ -127,45 +156,52 @@ void KeypadMatrix::onPinEdgeEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT e
             mKeysState.setRowValue(y, false);
         }
 
-        dumpMatrix(oldKeysState);
+        dumpMatrix(mPrevKeysState);
         dumpMatrix(mKeysState);
 
-        matrix<bool>::MatrixDiff_t diff = mKeysState.compare(oldKeysState);
+        const matrix<bool>::MatrixDiff_t diff = mKeysState.compare(mPrevKeysState);
+        size_t eventsCount = 0;
+        // index of the event which belongs to current row
+        int rowEventIndex = -1;
 
-        for (const auto& it : diff)
+        for (const auto it : diff)
         {
-            TRACE_DEBUG("DIFF: x=%d, y=%d", it.first, it.second);
-            if (it.second == y)
-            {
-                x = it.first;
+            TRACE_DEBUG("DIFF: x=%d, y=%d", SC2INT(it.first), SC2INT(it.second));
+            KeypadKeyEvent& curEvent = mEventsBuffer[eventsCount];
 
-                if (true == mKeysState(it.first, it.second))
-                {
-                    keyEvent = KeypadEvent::KEY_PRESSED;
-                }
-                else
-                {
-                    keyEvent = KeypadEvent::KEY_RELEASED;
-                }
-                break;
+            curEvent.x = it.first;
+            curEvent.y = it.second;
+            curEvent.keyCode = getKeyCode(curEvent.x, curEvent.y);
+            curEvent.key = &getKey(curEvent.keyCode);
+            curEvent.event = (true == mKeysState(it.first, it.second) ? KeypadEvent::KEY_PRESSED : KeypadEvent::KEY_RELEASED);
+
+            if ((rowEventIndex < 0) && (curEvent.y == y))
+            {
+                rowEventIndex = eventsCount;
             }
+
+            ++eventsCount;
         }
 
-        if (diff.size() > 0)
+        if (eventsCount > 0)
         {
-            TRACE_DEBUG("x=%d, y=%d, keyEvent=%d", x, y, SC2INT(keyEvent));
+            if (mOnBatchEventsCallback)
+            {
+                mOnBatchEventsCallback(mEventsBuffer.data(), eventsCount);
+            }
 
             if (mOnKeyEventCallback)
             {
-                std::string key;
-                auto itKey = mKeys.find(std::make_pair(x, y));
+                KeypadEvent keyEvent = KeypadEvent::UNKNOWN;
 
-                if (mKeys.end() != itKey)
+                if (rowEventIndex >= 0)
                 {
-                    key = itKey->second;
+                    x = mEventsBuffer[rowEventIndex].x;
+                    keyEvent = mEventsBuffer[rowEventIndex].event;
                 }
 
-                mOnKeyEventCallback(keyEvent, x, y, key);
+                TRACE_DEBUG("x=%d, y=%d, keyEvent=%d", x, y, SC2INT(keyEvent));
+                mOnKeyEventCallback(keyEvent, x, y, getKey(getKeyCode(x, y)));
             }
         }
 
@@ -175,8 +211,7 @@ void KeypadMatrix::onPinEdgeEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT e
             closePin(curRowPin);
         }
 
-        std::vector<int> colValuesLow(mColPins.size(), 0);
-        setGroupValues(mColsGroupID, colValuesLow);
+        setGroupValues(mColsGroupID, mColValuesLow);
 
         for (RP_GPIO curRowPin: mRowPins)
         {
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "gpio/OneWire.hpp"
+#include <utils/logging.hpp>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "OneWire"
+
+// standard speed timings (in microseconds)
+#define ONEWIRE_RESET_LOW_US                (480)
+#define ONEWIRE_PRESENCE_SAMPLE_US          (70)
+#define ONEWIRE_RESET_SLOT_US               (960)
+#define ONEWIRE_WRITE1_LOW_US               (6)
+#define ONEWIRE_WRITE0_LOW_US               (60)
+#define ONEWIRE_READ_LOW_US                 (6)
+#define ONEWIRE_READ_SAMPLE_US              (13)
+#define ONEWIRE_SLOT_US                     (70)
+
+#define US2NS(_us)                          (static_cast<uint64_t>(_us) * 1000)
+
+#define GPFSEL_MASK                         (0x7u)
+#define GPFSEL_OUTPUT                       (0x1u)
+
+bool OneWire::initialize(const RP_GPIO pin, const GPIO_PIN_PULL pullMode)
+{
+    TRACE_CALL_DEBUG_ARGS("pin=%d, pullMode=%d", SC2INT(pin), SC2INT(pullMode));
+    bool result = false;
+
+    if ((true == openDevice()) && (true == openPin(pin, GPIO_PIN_MODE::OPEN_DRAIN, pullMode)))
+    {
+        mLine = getPinLine(pin);
+        mUseRegisters = getPinRegisters(pin, mRegisters);
+
+        if (true == mUseRegisters)
+        {
+            // open drain is emulated by switching pin between input and output with 0 in output latch
+            *mRegisters.clear = mRegisters.mask;
+        }
+
+        busRelease();
+        TRACE_DEBUG("using %s", (true == mUseRegisters ? "GPIO registers" : "libgpiod line"));
+        result = (nullptr != mLine);
+    }
+
+    if (false == result)
+    {
+        TRACE_ERROR("failed to open 1-Wire pin");
+        closeDevice();
+    }
+
+    return result;
+}
+
+void OneWire::close()
+{
+    closeDevice();
+}
+
+bool OneWire::reset()
+{
+    bool present = false;
+
+    if (true == isDeviceOpen())
+    {
+        const struct timespec slotStart = getMonotonicTime();
+
+        busLow();
+        waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_RESET_LOW_US)));
+        busRelease();
+        waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_RESET_LOW_US + ONEWIRE_PRESENCE_SAMPLE_US)));
+        present = (0 == busRead());
+        waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_RESET_SLOT_US)));
+    }
+
+    return present;
+}
+
+void OneWire::writeBit(const int value)
+{
+    const struct timespec slotStart = getMonotonicTime();
+
+    busLow();
+    waitUntil(addNanoseconds(slotStart, US2NS(0 != value ? ONEWIRE_WRITE1_LOW_US : ONEWIRE_WRITE0_LOW_US)));
+    busRelease();
+    waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_SLOT_US)));
+}
+
+int OneWire::readBit()
+{
+    const struct timespec slotStart = getMonotonicTime();
+    int value = 0;
+
+    busLow();
+    waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_READ_LOW_US)));
+    busRelease();
+    waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_READ_SAMPLE_US)));
+    value = busRead();
+    waitUntil(addNanoseconds(slotStart, US2NS(ONEWIRE_SLOT_US)));
+
+    return value;
+}
+
+void OneWire::writeByte(const byte value)
+{
+    // LSB first
+    for (int i = 0 ; i < 8; ++i)
+    {
+        writeBit((value >> i) & 0x01);
+    }
+}
+
+byte OneWire::readByte()
+{
+    byte value = 0;
+
+    for (int i = 0 ; i < 8; ++i)
+    {
+        if (0 != readBit())
+        {
+            value |= (1 << i);
+        }
+    }
+
+    return value;
+}
+
+void OneWire::write(const byte* buffer, const size_t size)
+{
+    for (size_t i = 0 ; i < size; ++i)
+    {
+        writeByte(buffer[i]);
+    }
+}
+
+void OneWire::read(byte* buffer, const size_t size)
+{
+    for (size_t i = 0 ; i < size; ++i)
+    {
+        buffer[i] = readByte();
+    }
+}
+
+bool OneWire::select(const OneWireRom_t rom)
+{
+    bool result = reset();
+
+    if (true == result)
+    {
+        writeByte(ONEWIRE_CMD_MATCH_ROM);
+
+        for (int i = 0 ; i < 8; ++i)
+        {
+            writeByte(static_cast<byte>((rom >> (i * 8)) & 0xFF));
+        }
+    }
+
+    return result;
+}
+
+bool OneWire::selectAll()
+{
+    bool result = reset();
+
+    if (true == result)
+    {
+        writeByte(ONEWIRE_CMD_SKIP_ROM);
+    }
+
+    return result;
+}
+
+bool OneWire::search(std::vector<OneWireRom_t>& outRoms, const byte familyCode, const bool alarmOnly)
+{
+    TRACE_CALL_DEBUG_ARGS("familyCode=0x%X, alarmOnly=%d", SC2INT(familyCode), BOOL2INT(alarmOnly));
+    bool result = true;
+    int lastDiscrepancy = 0;
+    bool isLastDevice = false;
+    OneWireRom_t rom = 0;
+
+    outRoms.clear();
+
+    while ((false == isLastDevice) && (true == result))
+    {
+        int lastZero = 0;
+
+        if (false == reset())
+        {
+            // no devices on the bus
+            break;
+        }
+
+        writeByte(true == alarmOnly ? ONEWIRE_CMD_ALARM_SEARCH : ONEWIRE_CMD_SEARCH_ROM);
+
+        for (int bitIndex = 1 ; bitIndex <= 64; ++bitIndex)
+        {
+            const int idBit = readBit();
+            const int complementBit = readBit();
+            const OneWireRom_t bitMask = (static_cast<OneWireRom_t>(1) << (bitIndex - 1));
+            int direction = 0;
+
+            if ((1 == idBit) && (1 == complementBit))
+            {
+                if (1 == bitIndex)
+                {
+                    // no devices answered search command (e.g. alarm search when none of devices is in alarm state)
+                    isLastDevice = true;
+                }
+                else
+                {
+                    // no devices participate in search (could be a device which disconnected during search)
+                    TRACE_ERROR("search failed at bit %d", bitIndex);
+                    result = false;
+                }
+
+                break;
+            }
+            else if (idBit != complementBit)
+            {
+                // all remaining devices have the same bit value
+                direction = idBit;
+            }
+            else
+            {
+                // discrepancy: repeat previous choice before lastDiscrepancy, take 1 at it and 0 after it
+                if (bitIndex < lastDiscrepancy)
+                {
+                    direction = ((rom & bitMask) != 0 ? 1 : 0);
+                }
+                else
+                {
+                    direction = (bitIndex == lastDiscrepancy ? 1 : 0);
+                }
+
+                if (0 == direction)
+                {
+                    lastZero = bitIndex;
+                }
+            }
+
+            if (0 != direction)
+            {
+                rom |= bitMask;
+            }
+            else
+            {
+                rom &= ~bitMask;
+            }
+
+            writeBit(direction);
+        }
+
+        if ((true == result) && (false == isLastDevice))
+        {
+            byte romBytes[8];
+
+            for (int i = 0 ; i < 8; ++i)
+            {
+                romBytes[i] = static_cast<byte>((rom >> (i * 8)) & 0xFF);
+            }
+
+            if (crc8(romBytes, 7) == romBytes[7])
+            {
+                if ((0 == familyCode) || (familyCode == ONEWIRE_ROM_FAMILY(rom)))
+                {
+                    outRoms.push_back(rom);
+                }
+            }
+            else
+            {
+                TRACE_ERROR("invalid ROM CRC");
+                result = false;
+            }
+
+            lastDiscrepancy = lastZero;
+            isLastDevice = (0 == lastDiscrepancy);
+        }
+    }
+
+    TRACE_CALL_RESULT("%d (devices=%lu)", BOOL2INT(result), outRoms.size());
+    return result;
+}
+
+byte OneWire::crc8(const byte* data, const size_t size)
+{
+    byte crc = 0;
+
+    // Dallas/Maxim CRC8 (x^8 + x^5 + x^4 + 1)
+    for (size_t i = 0 ; i < size; ++i)
+    {
+        byte value = data[i];
+
+        for (int bit = 0 ; bit < 8; ++bit)
+        {
+            const byte mix = (crc ^ value) & 0x01;
+
+            crc >>= 1;
+
+            if (0 != mix)
+            {
+                crc ^= 0x8C;
+            }
+
+            value >>= 1;
+        }
+    }
+
+    return crc;
+}
+
+void OneWire::busLow()
+{
+    if (true == mUseRegisters)
+    {
+        *mRegisters.function = (*mRegisters.function & ~(GPFSEL_MASK << mRegisters.functionShift)) | (GPFSEL_OUTPUT << mRegisters.functionShift);
+    }
+    else
+    {
+        gpiod_line_set_value(mLine, 0);
+    }
+}
+
+void OneWire::busRelease()
+{
+    if (true == mUseRegisters)
+    {
+        *mRegisters.function = (*mRegisters.function & ~(GPFSEL_MASK << mRegisters.functionShift));
+    }
+    else
+    {
+        gpiod_line_set_value(mLine, 1);
+    }
+}
+
+int OneWire::busRead()
+{
+    int value = 0;
+
+    if (true == mUseRegisters)
+    {
+        value = ((*mRegisters.level & mRegisters.mask) != 0 ? 1 : 0);
+    }
+    else
+    {
+        value = (gpiod_line_get_value(mLine) > 0 ? 1 : 0);
+    }
+
+    return value;
+}
@@ -4,12 +4,17 @@
  */
 #include "gpio/Relay.hpp"
 #include <utils/logging.hpp>
+#include <thread>
+#include <algorithm>
 
 #undef TRACE_CLASS
 #define TRACE_CLASS                         "Relay"
 
 Relay::~Relay()
-{}
+{
+    // make sure edge monitoring thread is stopped before relay data is destroyed
+    closeDevice();
+}
 
 bool Relay::initialize(const std::vector<RP_GPIO>& pins, const std::vector<RelayNormalState>& pinStates, const bool initiallyOpen)
 {
@@ -22,18 +27,33 @@ bool Relay::initialize(const std::vector<RP_GPIO>& pins, const std::vector<Relay
         {
             mControlPins = pins;
             mPinNormalStates = pinStates;
+            mRelaysGroup = registerPinsGroup(mControlPins);
 
-            for (int i = 0 ; i < mControlPins.size(); ++i)
+            if (INVALID_GPIO_GROUP_ID != mRelaysGroup)
             {
-                result = setRelayValue(i, initiallyOpen);
+                mPinValues.assign(mControlPins.size(), -1);
+                mStagedValues.resize(mControlPins.size());
+                mWriteValues.resize(mControlPins.size());
+                mZeroCrossValues.resize(mControlPins.size());
+                mZeroCrossBaseValues.resize(mControlPins.size());
 
-                if (false == result)
+                for (int i = 0 ; i < mControlPins.size(); ++i)
                 {
-                    TRACE_ERROR("failed to initialize relay #%d (open=%d, gpio=%d)", i, initiallyOpen, SC2INT(mControlPins[i]));
-                    closeDevice();
-                    mControlPins.clear();
-                    break;
+                    mStagedValues[i] = toPinValue(i, initiallyOpen);
                 }
+
+                std::vector<int> values;
+                const uint64_t sequence = snapshotStagedValues(values);
+
+                result = applyStagedValues(values, sequence);
+            }
+
+            if (false == result)
+            {
+                TRACE_ERROR("failed to initialize relays (open=%d)", initiallyOpen);
+                closeDevice();
+                mControlPins.clear();
+                mRelaysGroup = INVALID_GPIO_GROUP_ID;
             }
         }
     }
@@ -53,22 +73,494 @@ bool Relay::closeRelay(const int index)
 
 bool Relay::setRelayValue(const int index, const bool valueOpen)
 {
+    std::vector<int> values;
+    uint64_t sequence = 0;
+    bool result = false;
+
+    // values are applied without holding mSync (energizing can take a while)
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        if ((index >= 0 && index < mControlPins.size()) && (true == isDeviceOpen()))
+        {
+            mStagedValues[index] = toPinValue(index, valueOpen);
+            sequence = snapshotStagedValues(values);
+            result = true;
+        }
+    }
+
+    if (true == result)
+    {
+        result = applyStagedValues(values, sequence);
+    }
+
+    return result;
+}
+
+TimerID_t Relay::setRelayValueFor(const int index, const bool valueOpen, const unsigned int durationMs)
+{
+    TRACE_CALL_DEBUG_ARGS("index=%d, valueOpen=%d, durationMs=%u", index, BOOL2INT(valueOpen), durationMs);
+    TimerID_t id = INVALID_TIMER_ID;
+    std::vector<int> values;
+    uint64_t sequence = 0;
+    bool applied = false;
+    bool wasOpen = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        if ((index >= 0 && index < mControlPins.size()) && (true == isDeviceOpen()))
+        {
+            wasOpen = (toPinValue(index, true) == mStagedValues[index]);
+            mStagedValues[index] = toPinValue(index, valueOpen);
+            sequence = snapshotStagedValues(values);
+            applied = true;
+        }
+    }
+
+    if (true == applied)
+    {
+        applied = applyStagedValues(values, sequence);
+    }
+
+    if (true == applied)
+    {
+        id = startTimedAction(durationMs, [this, index, wasOpen](){ setRelayValue(index, wasOpen); });
+    }
+
+    return id;
+}
+
+bool Relay::cancelRelayTimeout(const TimerID_t id)
+{
+    return cancelTimedAction(id);
+}
+
+bool Relay::stageRelayValue(const int index, const bool valueOpen)
+{
+    std::lock_guard<std::mutex> lock(mSync);
     bool result = false;
 
     if ((index >= 0 && index < mControlPins.size()) && (true == isDeviceOpen()))
     {
-        int newValue = 0;
+        mStagedValues[index] = toPinValue(index, valueOpen);
+        result = true;
+    }
+
+    return result;
+}
+
+bool Relay::commitRelayValues()
+{
+    std::vector<int> values;
+    uint64_t sequence = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        sequence = snapshotStagedValues(values);
+    }
+
+    return applyStagedValues(values, sequence);
+}
+
+uint64_t Relay::snapshotStagedValues(std::vector<int>& outValues)
+{
+    outValues = mStagedValues;
+    mCommittedValues = mStagedValues;
+
+    return ++mStageSequence;
+}
+
+bool Relay::applyStagedValues(const std::vector<int>& stagedValues, const uint64_t sequence)
+{
+    bool result = false;
+
+    if ((true == isDeviceOpen()) && (INVALID_GPIO_GROUP_ID != mRelaysGroup))
+    {
+        bool isDone = false;
+        std::chrono::steady_clock::time_point nextStepTime;
+
+        result = applyNextStep(stagedValues, sequence, isDone, nextStepTime);
 
-        if (RelayNormalState::NORMALLY_OPEN == mPinNormalStates[index])
+        // mWriteSync is not held while waiting, so other writes (phase control, zero-cross commits) are not delayed
+        while ((true == result) && (false == isDone))
         {
-            newValue = (valueOpen ? 1 : 0);
+            std::this_thread::sleep_until(nextStepTime);
+            result = applyNextStep(stagedValues, sequence, isDone, nextStepTime);
+        }
+    }
+
+    return result;
+}
+
+bool Relay::applyNextStep(const std::vector<int>& stagedValues,
+                          const uint64_t sequence,
+                          bool& outIsDone,
+                          std::chrono::steady_clock::time_point& outNextStepTime)
+{
+    std::lock_guard<std::mutex> lock(mWriteSync);
+    bool result = true;
+
+    if (sequence >= mAppliedSequence)
+    {
+        const int deenergizedPinValue = (0 == mEnergizedPinValue ? 1 : 0);
+        const std::chrono::steady_clock::time_point energizeTime = mLastEnergizeTime + std::chrono::milliseconds(mEnergizeSpacing);
+        int energizeIndex = -1;
+
+        mAppliedSequence = sequence;
+
+        // changes which don't energize relay coils are written first and are never delayed
+        for (size_t i = 0 ; i < stagedValues.size(); ++i)
+        {
+            if ((0 == mEnergizeSpacing) || (stagedValues[i] != mEnergizedPinValue) || (mPinValues[i] == mEnergizedPinValue))
+            {
+                mWriteValues[i] = stagedValues[i];
+            }
+            else
+            {
+                mWriteValues[i] = deenergizedPinValue;
+
+                if (energizeIndex < 0)
+                {
+                    energizeIndex = static_cast<int>(i);
+                }
+            }
+        }
+
+        // each of the following writes energizes one relay coil
+        if ((mWriteValues == mPinValues) && (energizeIndex >= 0) && (std::chrono::steady_clock::now() >= energizeTime))
+        {
+            mWriteValues[energizeIndex] = mEnergizedPinValue;
+            result = writeRelayValues(true);
         }
         else
         {
-            newValue = (valueOpen ? 0 : 1);
+            result = writeRelayValues(false);
         }
 
-        result = setPinValue(mControlPins[index], newValue);
+        outIsDone = (false == result) || (mPinValues == stagedValues);
+        outNextStepTime = mLastEnergizeTime + std::chrono::milliseconds(mEnergizeSpacing);
+    }
+    else
+    {
+        // newer commit was already started. it includes all changes of this one
+        outIsDone = true;
+    }
+
+    return result;
+}
+
+void Relay::discardStagedValues()
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mStagedValues = mCommittedValues;
+}
+
+void Relay::setEnergizeSpacing(const unsigned int milliseconds, const int energizedPinValue)
+{
+    std::lock_guard<std::mutex> lock(mWriteSync);
+
+    mEnergizeSpacing = milliseconds;
+    mEnergizedPinValue = (0 == energizedPinValue ? 0 : 1);
+}
+
+bool Relay::bindZeroCrossDetector(const RP_GPIO pin,
+                                  const GPIO_PIN_EDGE_EVENT edge,
+                                  const unsigned int offsetUs,
+                                  const GPIO_PIN_PULL pullMode)
+{
+    TRACE_CALL_DEBUG_ARGS("pin=%d, edge=%d, offsetUs=%u", SC2INT(pin), SC2INT(edge), offsetUs);
+    bool result = false;
+
+    if ((true == isDeviceOpen()) && (RP_GPIO::UNKNOWN != pin) && (RP_GPIO::UNKNOWN == mZeroCrossPin))
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            mZeroCrossPin = pin;
+            mZeroCrossEdge = edge;
+            mZeroCrossOffset = offsetUs;
+        }
+
+        registerTimestampedEdgeEventsCallback(std::bind(&Relay::onZeroCrossEvent,
+                                                        this,
+                                                        std::placeholders::_1,
+                                                        std::placeholders::_2,
+                                                        std::placeholders::_3));
+        result = openPin(pin, GPIO_PIN_MODE::EDGE_DETECTION, pullMode);
+
+        if (false == result)
+        {
+            TRACE_ERROR("failed to start monitoring of zero-cross detector");
+            unbindZeroCrossDetector();
+        }
+    }
+
+    return result;
+}
+
+void Relay::unbindZeroCrossDetector()
+{
+    TRACE_CALL_DEBUG();
+
+    if (RP_GPIO::UNKNOWN != mZeroCrossPin)
+    {
+        closePin(mZeroCrossPin);
+        unregisterEdgeEventsCallback();
+
+        std::lock_guard<std::mutex> lock(mSync);
+
+        mZeroCrossPin = RP_GPIO::UNKNOWN;
+        mZeroCrossActiveId = 0;
+        mZeroCrossCommitPending = false;
+        mZeroCrossCommitResult = false;
+        mZeroCrossCommitDone.notify_all();
+    }
+}
+
+void Relay::setZeroCrossOffset(const unsigned int offsetUs)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mZeroCrossOffset = offsetUs;
+}
+
+bool Relay::commitRelayValuesOnZeroCross(const bool waitForCommit, const unsigned int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(mSync);
+    bool result = false;
+
+    if (RP_GPIO::UNKNOWN != mZeroCrossPin)
+    {
+        mZeroCrossCommitPending = true;
+        ++mZeroCrossCommitId;
+        result = true;
+
+        if (true == waitForCommit)
+        {
+            result = mZeroCrossCommitDone.wait_for(lock,
+                                                   std::chrono::milliseconds(timeoutMs),
+                                                   [&](){ return (false == mZeroCrossCommitPending); });
+
+            if (true == result)
+            {
+                result = mZeroCrossCommitResult;
+            }
+            else
+            {
+                TRACE_ERROR("zero crossing was not detected in %u ms", timeoutMs);
+                mZeroCrossCommitPending = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool Relay::setPhaseAngleControl(const int index, const unsigned int delayUs, const unsigned int pulseUs)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if (index >= 0 && index < mControlPins.size())
+    {
+        auto itControl = std::find_if(mPhaseControl.begin(),
+                                      mPhaseControl.end(),
+                                      [&](const PhaseControl& control){ return control.index == index; });
+
+        if (mPhaseControl.end() != itControl)
+        {
+            mPhaseControl.erase(itControl);
+        }
+
+        if (delayUs > 0)
+        {
+            PhaseControl newControl;
+
+            newControl.index = index;
+            newControl.delay = delayUs;
+            newControl.pulse = pulseUs;
+            mPhaseControl.push_back(newControl);
+        }
+
+        updatePhaseEdges();
+        result = true;
+    }
+
+    return result;
+}
+
+int Relay::toPinValue(const int index, const bool valueOpen) const
+{
+    int newValue = 0;
+
+    if (RelayNormalState::NORMALLY_OPEN == mPinNormalStates[index])
+    {
+        newValue = (valueOpen ? 1 : 0);
+    }
+    else
+    {
+        newValue = (valueOpen ? 0 : 1);
+    }
+
+    return newValue;
+}
+
+void Relay::onZeroCrossEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT event, const struct timespec& timestamp)
+{
+    bool hasPhaseControl = false;
+    uint64_t activeId = 0;
+    uint64_t sequence = 0;
+    unsigned int offset = 0;
+
+    // take a snapshot of the state. waits and writes are done without holding mSync, so setters
+    // and commits are not blocked for the duration of the offset or the phase control cycle
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        if ((pin == mZeroCrossPin) && ((GPIO_PIN_EDGE_EVENT::UNKNOWN == mZeroCrossEdge) || (event == mZeroCrossEdge)))
+        {
+            // new commit replaces the one which is still being applied
+            if ((true == mZeroCrossCommitPending) && (mZeroCrossCommitId != mZeroCrossActiveId))
+            {
+                mZeroCrossSequence = snapshotStagedValues(mZeroCrossValues);
+                mZeroCrossActiveId = mZeroCrossCommitId;
+            }
+
+            activeId = mZeroCrossActiveId;
+            sequence = mZeroCrossSequence;
+            offset = mZeroCrossOffset;
+            hasPhaseControl = (false == mPhaseEdges.empty());
+
+            if (true == hasPhaseControl)
+            {
+                mZeroCrossPhaseEdges = mPhaseEdges;
+                mZeroCrossBaseValues = mCommittedValues;
+            }
+        }
+    }
+
+    if (0 != activeId)
+    {
+        bool isDone = false;
+        std::chrono::steady_clock::time_point nextStepTime;
+
+        // with energizing spacing only one step is applied at every zero crossing, so all relays are
+        // switched in sync with mains and edge monitoring thread never sleeps for the spacing
+        waitUntil(addNanoseconds(timestamp, static_cast<uint64_t>(offset) * 1000));
+
+        const bool applied = applyNextStep(mZeroCrossValues, sequence, isDone, nextStepTime);
+
+        if (true == isDone)
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            // commit could time out or be requested again while values were written
+            if (activeId == mZeroCrossActiveId)
+            {
+                mZeroCrossActiveId = 0;
+
+                if ((true == mZeroCrossCommitPending) && (activeId == mZeroCrossCommitId))
+                {
+                    mZeroCrossCommitResult = applied;
+                    mZeroCrossCommitPending = false;
+                    mZeroCrossCommitDone.notify_all();
+                }
+            }
+        }
+    }
+
+    if (true == hasPhaseControl)
+    {
+        runPhaseAngleControl(timestamp);
+    }
+}
+
+void Relay::runPhaseAngleControl(const struct timespec& timestamp)
+{
+    size_t i = 0;
+
+    while (i < mZeroCrossPhaseEdges.size())
+    {
+        const unsigned int edgeTime = mZeroCrossPhaseEdges[i].time;
+        const size_t firstEdge = i;
+
+        // combine all edges which happen at the same time into a single write
+        while ((i < mZeroCrossPhaseEdges.size()) && (mZeroCrossPhaseEdges[i].time == edgeTime))
+        {
+            ++i;
+        }
+
+        waitUntil(addNanoseconds(timestamp, static_cast<uint64_t>(edgeTime) * 1000));
+
+        std::lock_guard<std::mutex> lock(mWriteSync);
+        const int deenergizedPinValue = (0 == mEnergizedPinValue ? 1 : 0);
+
+        // pins with unknown state (after a failed write) get their committed values
+        for (size_t pinIndex = 0 ; pinIndex < mPinValues.size(); ++pinIndex)
+        {
+            mWriteValues[pinIndex] = (mPinValues[pinIndex] >= 0 ? mPinValues[pinIndex] : mZeroCrossBaseValues[pinIndex]);
+        }
+
+        for (size_t edgeIndex = firstEdge ; edgeIndex < i; ++edgeIndex)
+        {
+            const PhaseEdge& curEdge = mZeroCrossPhaseEdges[edgeIndex];
+
+            mWriteValues[curEdge.index] = (true == curEdge.activate ? mEnergizedPinValue : deenergizedPinValue);
+        }
+
+        writeRelayValues(false);
+    }
+}
+
+void Relay::updatePhaseEdges()
+{
+    mPhaseEdges.clear();
+
+    for (const PhaseControl& curControl: mPhaseControl)
+    {
+        PhaseEdge newEdge;
+
+        newEdge.index = curControl.index;
+        newEdge.time = curControl.delay;
+        newEdge.activate = true;
+        mPhaseEdges.push_back(newEdge);
+
+        newEdge.time = curControl.delay + curControl.pulse;
+        newEdge.activate = false;
+        mPhaseEdges.push_back(newEdge);
+    }
+
+    std::stable_sort(mPhaseEdges.begin(),
+                     mPhaseEdges.end(),
+                     [](const PhaseEdge& left, const PhaseEdge& right){ return left.time < right.time; });
+}
+
+bool Relay::writeRelayValues(const bool isEnergizing)
+{
+    bool result = true;
+
+    if (mWriteValues != mPinValues)
+    {
+        result = setGroupValues(mRelaysGroup, mWriteValues);
+
+        if (true == result)
+        {
+            mPinValues = mWriteValues;
+
+            if (true == isEnergizing)
+            {
+                mLastEnergizeTime = std::chrono::steady_clock::now();
+            }
+        }
+        else
+        {
+            TRACE_ERROR("failed to write relays state");
+            // real pins state is unknown now
+            mPinValues.assign(mPinValues.size(), -1);
+        }
     }
 
     return result;
@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "gpio/SoftwareSPI.hpp"
+#include <utils/logging.hpp>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "SoftwareSPI"
+
+// Pins access through memory mapped registers
+struct RegisterPinsAccess
+{
+    const GpioPinRegisters& sclk;
+    const GpioPinRegisters& mosi;
+    const GpioPinRegisters& miso;
+
+    inline void setClock(const int value) const
+    {
+        *(0 != value ? sclk.set : sclk.clear) = sclk.mask;
+    }
+
+    inline void setData(const int value) const
+    {
+        *(0 != value ? mosi.set : mosi.clear) = mosi.mask;
+    }
+
+    inline int getData() const
+    {
+        return ((*miso.level & miso.mask) != 0 ? 1 : 0);
+    }
+};
+
+// Pins access through pre-resolved libgpiod lines
+struct LinePinsAccess
+{
+    struct gpiod_line* sclk;
+    struct gpiod_line* mosi;
+    struct gpiod_line* miso;
+
+    inline void setClock(const int value) const
+    {
+        gpiod_line_set_value(sclk, value);
+    }
+
+    inline void setData(const int value) const
+    {
+        gpiod_line_set_value(mosi, value);
+    }
+
+    inline int getData() const
+    {
+        return (gpiod_line_get_value(miso) > 0 ? 1 : 0);
+    }
+};
+
+static inline void clockDelay(const unsigned int nanoseconds)
+{
+    if (nanoseconds > 0)
+    {
+        GenericDevice::waitNs(nanoseconds);
+    }
+}
+
+bool SoftwareSPI::initialize(const RP_GPIO sclkPin,
+                             const RP_GPIO mosiPin,
+                             const RP_GPIO misoPin,
+                             const RP_GPIO csPin,
+                             const SpiMode mode,
+                             const SpiBitOrder bitOrder,
+                             const unsigned int speedHz)
+{
+    TRACE_CALL_DEBUG_ARGS("sclk=%d, mosi=%d, miso=%d, cs=%d, mode=%d, speedHz=%u",
+                          SC2INT(sclkPin), SC2INT(mosiPin), SC2INT(misoPin), SC2INT(csPin), SC2INT(mode), speedHz);
+    bool result = false;
+
+    if ((RP_GPIO::UNKNOWN != sclkPin) && (RP_GPIO::UNKNOWN != mosiPin) && (true == openDevice()))
+    {
+        setMode(mode);
+        setBitOrder(bitOrder);
+        setSpeed(speedHz);
+
+        mHasMiso = (RP_GPIO::UNKNOWN != misoPin);
+        mHasCs = (RP_GPIO::UNKNOWN != csPin);
+        mInTransaction = false;
+
+        result = (true == openPin(sclkPin, GPIO_PIN_MODE::OUTPUT)) && (true == openPin(mosiPin, GPIO_PIN_MODE::OUTPUT));
+
+        if ((true == result) && (true == mHasMiso))
+        {
+            result = openPin(misoPin, GPIO_PIN_MODE::INPUT);
+        }
+
+        if ((true == result) && (true == mHasCs))
+        {
+            result = openPin(csPin, GPIO_PIN_MODE::OUTPUT);
+        }
+
+        if (true == result)
+        {
+            mUseRegisters = true;
+            result = (true == resolvePin(sclkPin, mSclk)) && (true == resolvePin(mosiPin, mMosi));
+
+            if ((true == result) && (true == mHasMiso))
+            {
+                result = resolvePin(misoPin, mMiso);
+            }
+
+            if ((true == result) && (true == mHasCs))
+            {
+                result = resolvePin(csPin, mCs);
+            }
+        }
+
+        if (true == result)
+        {
+            TRACE_DEBUG("using %s", (true == mUseRegisters ? "GPIO registers" : "libgpiod lines"));
+            gpiod_line_set_value(mSclk.line, mIdleClock);
+            setChipSelect(false);
+        }
+        else
+        {
+            TRACE_ERROR("failed to open SPI pins");
+            closeDevice();
+        }
+    }
+
+    return result;
+}
+
+void SoftwareSPI::close()
+{
+    closeDevice();
+}
+
+void SoftwareSPI::setMode(const SpiMode mode)
+{
+    mIdleClock = (((SpiMode::MODE_2 == mode) || (SpiMode::MODE_3 == mode)) ? 1 : 0);
+    mSampleOnTrailingEdge = ((SpiMode::MODE_1 == mode) || (SpiMode::MODE_3 == mode));
+
+    if ((true == isDeviceOpen()) && (nullptr != mSclk.line))
+    {
+        gpiod_line_set_value(mSclk.line, mIdleClock);
+    }
+}
+
+void SoftwareSPI::setSpeed(const unsigned int speedHz)
+{
+    mHalfPeriodNs = (speedHz > 0 ? 500000000u / speedHz : 0);
+}
+
+bool SoftwareSPI::transfer(const byte* txBuffer, byte* rxBuffer, const size_t size)
+{
+    bool result = false;
+
+    if ((true == isDeviceOpen()) && ((nullptr != txBuffer) || (nullptr != rxBuffer)) && ((nullptr == rxBuffer) || (true == mHasMiso)))
+    {
+        const bool manageCs = (false == mInTransaction);
+
+        if (true == manageCs)
+        {
+            setChipSelect(true);
+        }
+
+        if (true == mUseRegisters)
+        {
+            transferBytes(RegisterPinsAccess{mSclk.registers, mMosi.registers, mMiso.registers}, txBuffer, rxBuffer, size);
+        }
+        else
+        {
+            transferBytes(LinePinsAccess{mSclk.line, mMosi.line, mMiso.line}, txBuffer, rxBuffer, size);
+        }
+
+        if (true == manageCs)
+        {
+            setChipSelect(false);
+        }
+
+        result = true;
+    }
+
+    return result;
+}
+
+bool SoftwareSPI::beginTransaction()
+{
+    bool result = false;
+
+    if ((true == isDeviceOpen()) && (false == mInTransaction))
+    {
+        setChipSelect(true);
+        mInTransaction = true;
+        result = true;
+    }
+
+    return result;
+}
+
+void SoftwareSPI::endTransaction()
+{
+    if (true == mInTransaction)
+    {
+        setChipSelect(false);
+        mInTransaction = false;
+    }
+}
+
+bool SoftwareSPI::resolvePin(const RP_GPIO pin, SpiPin& outPin)
+{
+    outPin.line = getPinLine(pin);
+
+    if ((true == mUseRegisters) && (false == getPinRegisters(pin, outPin.registers)))
+    {
+        mUseRegisters = false;
+    }
+
+    return (nullptr != outPin.line);
+}
+
+void SoftwareSPI::setChipSelect(const bool active)
+{
+    // chip select is active low
+    if (true == mHasCs)
+    {
+        gpiod_line_set_value(mCs.line, (true == active ? 0 : 1));
+        clockDelay(mHalfPeriodNs);
+    }
+}
+
+template <typename Pins>
+void SoftwareSPI::transferBytes(const Pins& pins, const byte* txBuffer, byte* rxBuffer, const size_t size)
+{
+    const int activeClock = (0 == mIdleClock ? 1 : 0);
+    const byte firstMask = (SpiBitOrder::MSB_FIRST == mBitOrder ? 0x80 : 0x01);
+    const bool msbFirst = (SpiBitOrder::MSB_FIRST == mBitOrder);
+    const bool readMiso = (nullptr != rxBuffer);
+    const unsigned int halfPeriod = mHalfPeriodNs;
+
+    for (size_t i = 0 ; i < size; ++i)
+    {
+        const byte txByte = (nullptr != txBuffer ? txBuffer[i] : 0);
+        byte rxByte = 0;
+        byte mask = firstMask;
+
+        for (int bit = 0 ; bit < 8; ++bit)
+        {
+            const int txBit = ((txByte & mask) != 0 ? 1 : 0);
+
+            if (false == mSampleOnTrailingEdge)
+            {
+                // CPHA=0: data is valid before leading edge and sampled on it
+                pins.setData(txBit);
+                clockDelay(halfPeriod);
+                pins.setClock(activeClock);
+
+                if ((true == readMiso) && (0 != pins.getData()))
+                {
+                    rxByte |= mask;
+                }
+
+                clockDelay(halfPeriod);
+                pins.setClock(mIdleClock);
+            }
+            else
+            {
+                // CPHA=1: data changes on leading edge and is sampled on trailing edge
+                pins.setClock(activeClock);
+                pins.setData(txBit);
+                clockDelay(halfPeriod);
+                pins.setClock(mIdleClock);
+
+                if ((true == readMiso) && (0 != pins.getData()))
+                {
+                    rxByte |= mask;
+                }
+
+                clockDelay(halfPeriod);
+            }
+
+            mask = (true == msbFirst ? (mask >> 1) : (mask << 1));
+        }
+
+        if (true == readMiso)
+        {
+            rxBuffer[i] = rxByte;
+        }
+    }
+}
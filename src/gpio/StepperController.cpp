@@ -0,0 +1,684 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "gpio/StepperController.hpp"
+#include "utils/ThreadPolicy.hpp"
+#include <utils/logging.hpp>
+#include <algorithm>
+#include <cmath>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "StepperController"
+
+// motion thread wakes up at least this often to pick up new commands
+#define MAX_IDLE_WAIT_NS                    (10000000)
+#define SCURVE_SOLVER_ITERATIONS            (40)
+
+static inline bool isBefore(const struct timespec& left, const struct timespec& right)
+{
+    return (left.tv_sec < right.tv_sec) || ((left.tv_sec == right.tv_sec) && (left.tv_nsec < right.tv_nsec));
+}
+
+static inline uint32_t secondsToInterval(const double seconds)
+{
+    const double nanoseconds = seconds * 1000000000.0;
+
+    return static_cast<uint32_t>(std::max(1.0, std::min(nanoseconds, static_cast<double>(UINT32_MAX))));
+}
+
+StepperController::~StepperController()
+{
+    stop();
+}
+
+bool StepperController::initialize(const RP_GPIOCHIP chip)
+{
+    TRACE_CALL_DEBUG_ARGS("chip=%d", SC2INT(chip));
+
+    return openDevice(chip);
+}
+
+StepperID_t StepperController::addMotor(const StepperConfig& config)
+{
+    TRACE_CALL_DEBUG_ARGS("step=%d, dir=%d, enable=%d", SC2INT(config.stepPin), SC2INT(config.dirPin), SC2INT(config.enablePin));
+    StepperID_t id = INVALID_STEPPER_ID;
+
+    if ((false == mIsRunning) && (true == isDeviceOpen()) &&
+        (RP_GPIO::UNKNOWN != config.stepPin) && (RP_GPIO::UNKNOWN != config.dirPin) &&
+        (config.maxSpeed > 0.0) && (config.acceleration > 0.0))
+    {
+        bool result = (true == openPin(config.stepPin, GPIO_PIN_MODE::OUTPUT)) && (true == openPin(config.dirPin, GPIO_PIN_MODE::OUTPUT));
+
+        if ((true == result) && (RP_GPIO::UNKNOWN != config.enablePin))
+        {
+            result = openPin(config.enablePin, GPIO_PIN_MODE::OUTPUT);
+        }
+
+        if (true == result)
+        {
+            std::unique_ptr<Motor> newMotor(new Motor());
+
+            newMotor->config = config;
+            newMotor->stepLine = getPinLine(config.stepPin);
+            newMotor->dirLine = getPinLine(config.dirPin);
+
+            if (false == getPinRegisters(config.stepPin, newMotor->stepRegisters))
+            {
+                newMotor->stepRegisters = GpioPinRegisters();
+            }
+
+            gpiod_line_set_value(newMotor->stepLine, 0);
+            id = mMotors.size();
+            mMotors.push_back(std::move(newMotor));
+            setEnabled(id, true);
+        }
+        else
+        {
+            TRACE_ERROR("failed to open motor pins");
+        }
+    }
+
+    return id;
+}
+
+bool StepperController::start()
+{
+    TRACE_CALL_DEBUG_ARGS("motors=%lu", mMotors.size());
+    bool result = false;
+
+    if ((false == mIsRunning) && (false == mMotors.empty()))
+    {
+        // single register write is only possible if all STEP pins are in the same GPIO bank
+        mUseRegisters = true;
+
+        for (const std::unique_ptr<Motor>& curMotor: mMotors)
+        {
+            if ((nullptr == curMotor->stepRegisters.set) || (curMotor->stepRegisters.set != mMotors.front()->stepRegisters.set))
+            {
+                mUseRegisters = false;
+                break;
+            }
+        }
+
+        TRACE_DEBUG("using %s", (true == mUseRegisters ? "GPIO registers" : "libgpiod lines"));
+        mDueMotors.reserve(mMotors.size());
+        mIsRunning = true;
+        mThread = std::thread(&StepperController::threadMotion, this);
+        result = true;
+    }
+
+    return result;
+}
+
+void StepperController::stop()
+{
+    TRACE_CALL_DEBUG();
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        mIsRunning = false;
+        mCommandsCondition.notify_all();
+    }
+
+    if (true == mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+bool StepperController::setMaxSpeed(const StepperID_t id, const double stepsPerSecond)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if ((true == isValidMotor(id)) && (stepsPerSecond > 0.0))
+    {
+        mMotors[id]->config.maxSpeed = stepsPerSecond;
+        result = true;
+    }
+
+    return result;
+}
+
+bool StepperController::setAcceleration(const StepperID_t id, const double stepsPerSecond2)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if ((true == isValidMotor(id)) && (stepsPerSecond2 > 0.0))
+    {
+        mMotors[id]->config.acceleration = stepsPerSecond2;
+        result = true;
+    }
+
+    return result;
+}
+
+bool StepperController::setProfile(const StepperID_t id, const MotionProfile profile)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if (true == isValidMotor(id))
+    {
+        mMotors[id]->config.profile = profile;
+        result = true;
+    }
+
+    return result;
+}
+
+bool StepperController::setEnabled(const StepperID_t id, const bool enabled)
+{
+    bool result = false;
+
+    if (true == isValidMotor(id))
+    {
+        const StepperConfig& config = mMotors[id]->config;
+
+        if (RP_GPIO::UNKNOWN != config.enablePin)
+        {
+            result = setPinValue(config.enablePin, (enabled != config.enableActiveLow ? 1 : 0));
+        }
+        else
+        {
+            // driver is always enabled
+            result = enabled;
+        }
+    }
+
+    return result;
+}
+
+bool StepperController::moveTo(const StepperID_t id, const int64_t position)
+{
+    TRACE_CALL_DEBUG_ARGS("id=%d, position=%lld", id, static_cast<long long>(position));
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if ((true == mIsRunning) && (true == isValidMotor(id)) && (false == mMotors[id]->isMoving))
+    {
+        Motor& curMotor = *mMotors[id];
+        const int64_t steps = position - curMotor.position;
+
+        if (0 != steps)
+        {
+            curMotor.pendingPlan = createPlan(curMotor.config, steps);
+            curMotor.stopRequested = false;
+            curMotor.isMoving = true;
+            mHasCommands = true;
+            mCommandsCondition.notify_one();
+        }
+
+        result = true;
+    }
+
+    return result;
+}
+
+bool StepperController::move(const StepperID_t id, const int64_t steps)
+{
+    return (true == isValidMotor(id)) && (true == moveTo(id, mMotors[id]->position + steps));
+}
+
+bool StepperController::stopMotor(const StepperID_t id, const bool decelerate)
+{
+    TRACE_CALL_DEBUG_ARGS("id=%d, decelerate=%d", id, BOOL2INT(decelerate));
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if ((true == isValidMotor(id)) && (true == mMotors[id]->isMoving))
+    {
+        mMotors[id]->stopRequested = true;
+        mMotors[id]->decelerateOnStop = decelerate;
+        mHasCommands = true;
+        mCommandsCondition.notify_one();
+        result = true;
+    }
+
+    return result;
+}
+
+int64_t StepperController::getPosition(const StepperID_t id) const
+{
+    return (true == isValidMotor(id) ? mMotors[id]->position.load() : 0);
+}
+
+bool StepperController::setPosition(const StepperID_t id, const int64_t position)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+    bool result = false;
+
+    if ((true == isValidMotor(id)) && (false == mMotors[id]->isMoving))
+    {
+        mMotors[id]->position = position;
+        result = true;
+    }
+
+    return result;
+}
+
+bool StepperController::isMoving(const StepperID_t id) const
+{
+    return (true == isValidMotor(id)) && (true == mMotors[id]->isMoving);
+}
+
+bool StepperController::waitMoveComplete(const StepperID_t id, const unsigned int timeoutMs)
+{
+    bool result = false;
+
+    if (true == isValidMotor(id))
+    {
+        std::unique_lock<std::mutex> lock(mSync);
+        const Motor& curMotor = *mMotors[id];
+        auto isFinished = [&](){ return (false == curMotor.isMoving); };
+
+        if (timeoutMs > 0)
+        {
+            result = mMoveFinishedCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), isFinished);
+        }
+        else
+        {
+            mMoveFinishedCondition.wait(lock, isFinished);
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+void StepperController::registerMoveCallback(const StepperMoveCallback_t& callback)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mMoveCallback = callback;
+}
+
+StepperStats StepperController::getStats() const
+{
+    StepperStats stats;
+
+    stats.stepsGenerated = mStepsGenerated;
+    stats.groupWrites = mGroupWrites;
+    stats.lateSteps = mLateSteps;
+    stats.maxLatency = mMaxLatency;
+
+    return stats;
+}
+
+void StepperController::resetStats()
+{
+    mStepsGenerated = 0;
+    mGroupWrites = 0;
+    mLateSteps = 0;
+    mMaxLatency = 0;
+}
+
+bool StepperController::isValidMotor(const StepperID_t id) const
+{
+    return (id >= 0) && (static_cast<size_t>(id) < mMotors.size());
+}
+
+std::unique_ptr<StepperController::MotionPlan> StepperController::createPlan(const StepperConfig& config, const int64_t steps) const
+{
+    std::unique_ptr<MotionPlan> plan(new MotionPlan());
+    const double accel = config.acceleration;
+    double speed = config.maxSpeed;
+    uint64_t rampSteps = 0;
+
+    plan->forward = (steps > 0);
+    plan->totalSteps = static_cast<uint64_t>(steps > 0 ? steps : -steps);
+
+    if (MotionProfile::TRAPEZOID == config.profile)
+    {
+        // distance needed to reach speed: v^2 / 2a. if move is too short, peak speed is reduced (triangle profile)
+        if (speed * speed / accel > plan->totalSteps)
+        {
+            speed = sqrt(plan->totalSteps * accel);
+        }
+
+        rampSteps = std::min<uint64_t>(plan->totalSteps / 2, static_cast<uint64_t>(ceil(speed * speed / (2.0 * accel))));
+        plan->ramp.resize(rampSteps);
+
+        // step k is reached at t = sqrt(2k / a)
+        double prevTime = 0.0;
+
+        for (uint64_t k = 0 ; k < rampSteps; ++k)
+        {
+            const double stepTime = sqrt(2.0 * (k + 1) / accel);
+
+            plan->ramp[k] = secondsToInterval(stepTime - prevTime);
+            prevTime = stepTime;
+        }
+    }
+    else
+    {
+        // velocity follows smoothstep: v(t) = V * (3u^2 - 2u^3), u = t / T.
+        // peak acceleration is 1.5 * V / T, so ramp takes T = 1.5 * V / a and covers V * T / 2 steps
+        if (1.5 * speed * speed / accel > plan->totalSteps)
+        {
+            speed = sqrt(plan->totalSteps * accel / 1.5);
+        }
+
+        const double rampTime = 1.5 * speed / accel;
+        const double rampDistance = speed * rampTime / 2.0;
+        double prevTime = 0.0;
+        double prevU = 0.0;
+
+        rampSteps = std::min<uint64_t>(plan->totalSteps / 2, static_cast<uint64_t>(ceil(rampDistance)));
+        plan->ramp.resize(rampSteps);
+
+        for (uint64_t k = 0 ; k < rampSteps; ++k)
+        {
+            const double distance = static_cast<double>(k + 1);
+            double stepTime = 0.0;
+
+            if (distance < rampDistance)
+            {
+                // position p(u) = V * T * (u^3 - u^4 / 2) is monotonic, so it's solved with bisection
+                double low = prevU;
+                double high = 1.0;
+
+                for (int i = 0 ; i < SCURVE_SOLVER_ITERATIONS; ++i)
+                {
+                    const double u = (low + high) / 2.0;
+
+                    if (speed * rampTime * (u * u * u - u * u * u * u / 2.0) < distance)
+                    {
+                        low = u;
+                    }
+                    else
+                    {
+                        high = u;
+                    }
+                }
+
+                prevU = high;
+                stepTime = high * rampTime;
+            }
+            else
+            {
+                stepTime = rampTime + (distance - rampDistance) / speed;
+            }
+
+            plan->ramp[k] = secondsToInterval(stepTime - prevTime);
+            prevTime = stepTime;
+        }
+    }
+
+    plan->cruiseInterval = secondsToInterval(1.0 / speed);
+
+    return plan;
+}
+
+uint32_t StepperController::getStepInterval(const MotionPlan& plan, const uint64_t stepIndex)
+{
+    uint32_t interval = plan.cruiseInterval;
+    const uint64_t stepsLeft = plan.totalSteps - stepIndex - 1;
+
+    if (stepsLeft < plan.ramp.size())
+    {
+        interval = plan.ramp[stepsLeft];
+    }
+    else if (stepIndex < plan.ramp.size())
+    {
+        interval = plan.ramp[stepIndex];
+    }
+
+    return interval;
+}
+
+void StepperController::threadMotion()
+{
+    TRACE_CALL();
+    ThreadPolicyManager::onThreadStarted(HwioThread::STEPPER_MOTION);
+
+    while (true == waitForWork())
+    {
+        struct timespec now = getMonotonicTime();
+        struct timespec earliest = addNanoseconds(now, MAX_IDLE_WAIT_NS);
+        bool hasActiveMoves = false;
+        bool hasSteps = false;
+
+        for (size_t i = 0 ; i < mMotors.size(); ++i)
+        {
+            Motor& curMotor = *mMotors[i];
+
+            if (curMotor.plan)
+            {
+                if (curMotor.stepIndex >= curMotor.plan->totalSteps)
+                {
+                    finishMove(i, (false == curMotor.isAborted));
+                }
+                else
+                {
+                    hasActiveMoves = true;
+
+                    if (true == isBefore(curMotor.nextStep, earliest))
+                    {
+                        earliest = curMotor.nextStep;
+                        hasSteps = true;
+                    }
+                }
+            }
+        }
+
+        if (true == hasActiveMoves)
+        {
+            waitUntil(earliest);
+        }
+
+        if (true == hasSteps)
+        {
+            const struct timespec windowEnd = addNanoseconds(earliest, mCoalesceWindow);
+
+            mDueMotors.clear();
+
+            for (size_t i = 0 ; i < mMotors.size(); ++i)
+            {
+                const Motor& curMotor = *mMotors[i];
+
+                if ((curMotor.plan) && (curMotor.stepIndex < curMotor.plan->totalSteps) && (false == isBefore(windowEnd, curMotor.nextStep)))
+                {
+                    mDueMotors.push_back(i);
+                }
+            }
+
+            now = getMonotonicTime();
+            writeSteps(mDueMotors);
+
+            for (const size_t index: mDueMotors)
+            {
+                Motor& curMotor = *mMotors[index];
+                const int64_t latency = diffNanoseconds(now, curMotor.nextStep);
+
+                if (latency > 0)
+                {
+                    if (static_cast<uint64_t>(latency) > mMaxLatency)
+                    {
+                        mMaxLatency = latency;
+                    }
+
+                    if (latency > STEPPER_LATE_STEP_NS)
+                    {
+                        ++mLateSteps;
+                    }
+                }
+
+                curMotor.position += (true == curMotor.plan->forward ? 1 : -1);
+                ++curMotor.stepIndex;
+
+                if (curMotor.stepIndex < curMotor.plan->totalSteps)
+                {
+                    const uint32_t interval = getStepInterval(*curMotor.plan, curMotor.stepIndex);
+
+                    // if thread was delayed, shift remaining timeline instead of sending a burst of steps
+                    // (motor would stall if speed jumps above the planned profile)
+                    if (latency > static_cast<int64_t>(interval / 2))
+                    {
+                        curMotor.nextStep = addNanoseconds(now, interval);
+                    }
+                    else
+                    {
+                        curMotor.nextStep = addNanoseconds(curMotor.nextStep, interval);
+                    }
+                }
+            }
+        }
+    }
+
+    // abort all active moves
+    for (size_t i = 0 ; i < mMotors.size(); ++i)
+    {
+        if ((mMotors[i]->plan) || (true == mMotors[i]->isMoving))
+        {
+            finishMove(i, false);
+        }
+    }
+
+    ThreadPolicyManager::onThreadFinished(HwioThread::STEPPER_MOTION);
+}
+
+bool StepperController::waitForWork()
+{
+    bool hasActiveMoves = false;
+
+    for (const std::unique_ptr<Motor>& curMotor: mMotors)
+    {
+        if (curMotor->plan)
+        {
+            hasActiveMoves = true;
+            break;
+        }
+    }
+
+    if (true == hasActiveMoves)
+    {
+        // don't block step generation if another thread is holding the mutex. commands will be picked up later
+        if ((true == mHasCommands) && (true == mSync.try_lock()))
+        {
+            applyCommands();
+            mSync.unlock();
+        }
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(mSync);
+
+        mCommandsCondition.wait(lock, [&](){ return (true == mHasCommands) || (false == mIsRunning); });
+        applyCommands();
+    }
+
+    return mIsRunning;
+}
+
+void StepperController::applyCommands()
+{
+    const struct timespec now = getMonotonicTime();
+
+    for (std::unique_ptr<Motor>& curMotor: mMotors)
+    {
+        if (curMotor->pendingPlan)
+        {
+            const int dirValue = (curMotor->pendingPlan->forward != curMotor->config.invertDirection ? 1 : 0);
+            struct timespec moveStart = now;
+
+            curMotor->plan = std::move(curMotor->pendingPlan);
+            curMotor->stepIndex = 0;
+            curMotor->isAborted = false;
+
+            if (dirValue != curMotor->dirValue)
+            {
+                gpiod_line_set_value(curMotor->dirLine, dirValue);
+                curMotor->dirValue = dirValue;
+                moveStart = addNanoseconds(now, STEPPER_DEFAULT_DIR_SETUP_NS);
+            }
+
+            curMotor->nextStep = addNanoseconds(moveStart, getStepInterval(*curMotor->plan, 0));
+        }
+
+        if ((true == curMotor->stopRequested) && (curMotor->plan))
+        {
+            MotionPlan& plan = *curMotor->plan;
+            uint64_t stepsLeft = 0;
+
+            if (true == curMotor->decelerateOnStop)
+            {
+                // current speed corresponds to this position in the acceleration ramp
+                const uint64_t speedLevel = std::min<uint64_t>(curMotor->stepIndex, plan.ramp.size());
+
+                stepsLeft = std::min<uint64_t>(plan.totalSteps - curMotor->stepIndex, speedLevel);
+            }
+
+            plan.totalSteps = curMotor->stepIndex + stepsLeft;
+            curMotor->isAborted = true;
+        }
+
+        curMotor->stopRequested = false;
+    }
+
+    mHasCommands = false;
+}
+
+void StepperController::writeSteps(const std::vector<size_t>& motors)
+{
+    if (false == motors.empty())
+    {
+        if (true == mUseRegisters)
+        {
+            uint32_t mask = 0;
+
+            for (const size_t index: motors)
+            {
+                mask |= mMotors[index]->stepRegisters.mask;
+            }
+
+            *mMotors.front()->stepRegisters.set = mask;
+            waitNs(mStepPulseWidth);
+            *mMotors.front()->stepRegisters.clear = mask;
+        }
+        else
+        {
+            for (const size_t index: motors)
+            {
+                gpiod_line_set_value(mMotors[index]->stepLine, 1);
+            }
+
+            waitNs(mStepPulseWidth);
+
+            for (const size_t index: motors)
+            {
+                gpiod_line_set_value(mMotors[index]->stepLine, 0);
+            }
+        }
+
+        ++mGroupWrites;
+        mStepsGenerated += motors.size();
+    }
+}
+
+void StepperController::finishMove(const size_t index, const bool completed)
+{
+    Motor& motor = *mMotors[index];
+    StepperMoveCallback_t callback;
+
+    motor.plan.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        motor.pendingPlan.reset();
+        motor.stopRequested = false;
+        motor.isMoving = false;
+        callback = mMoveCallback;
+    }
+
+    mMoveFinishedCondition.notify_all();
+
+    if (callback)
+    {
+        callback(static_cast<StepperID_t>(index), motor.position, completed);
+    }
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "gpio/sensors/dht.hpp"
+#include <utils/logging.hpp>
+#include <algorithm>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "DHT"
+
+#define DHT_DATA_BITS                       (40)
+// response: 80us low + 80us high, every bit: 50us low + 26-28us (0) or 70us (1) high
+#define DHT_MAX_EDGES                       (128)
+#define DHT_BIT_THRESHOLD_NS                (48000)
+#define DHT_MAX_HIGH_PULSE_NS               (100000)
+#define DHT_START_PULSE_DHT11_US            (20000)
+#define DHT_START_PULSE_DHT22_US            (1100)
+// time from releasing the line to the last edge of transmission (with a margin for event delivery)
+#define DHT_TRANSMISSION_TIME_US            (6500)
+
+#define GPFSEL_MASK                         (0x7u)
+#define GPFSEL_OUTPUT                       (0x1u)
+
+DHT::~DHT()
+{
+    // make sure edge monitoring thread is stopped before sensors data is destroyed
+    closeDevice();
+}
+
+DHTSensorID_t DHT::addSensor(const RP_GPIO pin, const DHTType type)
+{
+    TRACE_CALL_DEBUG_ARGS("pin=%d, type=%d", SC2INT(pin), SC2INT(type));
+    DHTSensorID_t id = INVALID_DHT_SENSOR_ID;
+
+    if ((false == isDeviceOpen()) && (true == openDevice()))
+    {
+        registerTimestampedEdgeEventsCallback(std::bind(&DHT::onEdgeEvent, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    }
+
+    if (true == isDeviceOpen())
+    {
+        SensorInfo newSensor;
+
+        newSensor.pin = pin;
+        newSensor.type = type;
+        newSensor.edges.resize(DHT_MAX_EDGES);
+
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            id = mSensors.size();
+            mSensors.push_back(newSensor);
+        }
+
+        if (true == openPin(pin, GPIO_PIN_MODE::EDGE_DETECTION, GPIO_PIN_PULL::PULL_UP))
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            mSensors[id].useRegisters = getPinRegisters(pin, mSensors[id].registers);
+
+            if (true == mSensors[id].useRegisters)
+            {
+                // start pulse is generated by switching pin to output with 0 in output latch
+                *mSensors[id].registers.clear = mSensors[id].registers.mask;
+            }
+        }
+        else
+        {
+            TRACE_ERROR("failed to open pin %d", SC2INT(pin));
+            std::lock_guard<std::mutex> lock(mSync);
+
+            mSensors.pop_back();
+            id = INVALID_DHT_SENSOR_ID;
+        }
+    }
+
+    return id;
+}
+
+bool DHT::readAll(std::vector<SensorDataDHT>& outData)
+{
+    return read(INVALID_DHT_SENSOR_ID, outData);
+}
+
+bool DHT::readSensor(const DHTSensorID_t id, SensorDataDHT& outData)
+{
+    bool result = false;
+    std::vector<SensorDataDHT> data;
+
+    if ((id >= 0) && (id < static_cast<int>(mSensors.size())))
+    {
+        result = read(id, data);
+        outData = data[id];
+    }
+
+    return result;
+}
+
+bool DHT::read(const DHTSensorID_t onlySensor, std::vector<SensorDataDHT>& outData)
+{
+    TRACE_CALL_DEBUG_ARGS("onlySensor=%d", onlySensor);
+    bool result = false;
+    std::vector<size_t> activeSensors;
+
+    outData.assign(mSensors.size(), SensorDataDHT());
+
+    for (size_t i = 0 ; i < mSensors.size(); ++i)
+    {
+        if ((INVALID_DHT_SENSOR_ID == onlySensor) || (static_cast<int>(i) == onlySensor))
+        {
+            activeSensors.push_back(i);
+        }
+    }
+
+    if ((true == isDeviceOpen()) && (false == activeSensors.empty()))
+    {
+        // shorter start pulses are released first
+        std::sort(activeSensors.begin(), activeSensors.end(), [&](const size_t left, const size_t right)
+        {
+            return (DHTType::DHT22 == mSensors[left].type) && (DHTType::DHT11 == mSensors[right].type);
+        });
+
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            for (const size_t i: activeSensors)
+            {
+                mSensors[i].edgesCount = 0;
+            }
+
+            mIsCapturing = true;
+        }
+
+        const struct timespec pulseStart = getMonotonicTime();
+        struct timespec releaseTime = pulseStart;
+
+        for (const size_t i: activeSensors)
+        {
+            pullLow(mSensors[i]);
+        }
+
+        for (const size_t i: activeSensors)
+        {
+            releaseTime = addNanoseconds(pulseStart,
+                                         static_cast<uint64_t>(DHTType::DHT11 == mSensors[i].type ? DHT_START_PULSE_DHT11_US : DHT_START_PULSE_DHT22_US) * 1000);
+            waitUntil(releaseTime);
+            release(mSensors[i]);
+        }
+
+        // response is captured by edge monitoring thread. just sleep until all sensors are done
+        waitUntil(addNanoseconds(getMonotonicTime(), static_cast<uint64_t>(DHT_TRANSMISSION_TIME_US) * 1000));
+
+        std::lock_guard<std::mutex> lock(mSync);
+
+        mIsCapturing = false;
+        result = true;
+
+        for (const size_t i: activeSensors)
+        {
+            if (false == decode(mSensors[i], outData[i]))
+            {
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+void DHT::onEdgeEvent(const RP_GPIO pin, const GPIO_PIN_EDGE_EVENT event, const struct timespec& timestamp)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    if (true == mIsCapturing)
+    {
+        for (SensorInfo& curSensor: mSensors)
+        {
+            if ((curSensor.pin == pin) && (curSensor.edgesCount < curSensor.edges.size()))
+            {
+                EdgeInfo& curEdge = curSensor.edges[curSensor.edgesCount];
+
+                curEdge.timestamp = timestamp;
+                curEdge.rising = (GPIO_PIN_EDGE_EVENT::RISING_EDGE == event);
+                ++curSensor.edgesCount;
+                break;
+            }
+        }
+    }
+}
+
+void DHT::pullLow(SensorInfo& sensor)
+{
+    if (true == sensor.useRegisters)
+    {
+        volatile uint32_t* function = sensor.registers.function;
+
+        *function = (*function & ~(GPFSEL_MASK << sensor.registers.functionShift)) | (GPFSEL_OUTPUT << sensor.registers.functionShift);
+    }
+    else
+    {
+        // line stays requested so edge monitoring thread keeps running during the read
+        if (true == changePinDirection(sensor.pin, GPIO_PIN_MODE::OPEN_DRAIN))
+        {
+            gpiod_line_set_value(getPinLine(sensor.pin), 0);
+        }
+    }
+}
+
+void DHT::release(SensorInfo& sensor)
+{
+    if (true == sensor.useRegisters)
+    {
+        volatile uint32_t* function = sensor.registers.function;
+
+        *function = (*function & ~(GPFSEL_MASK << sensor.registers.functionShift));
+    }
+    else
+    {
+        changePinDirection(sensor.pin, GPIO_PIN_MODE::EDGE_DETECTION);
+    }
+}
+
+bool DHT::decode(const SensorInfo& sensor, SensorDataDHT& outData) const
+{
+    bool result = false;
+    uint64_t highPulses[DHT_DATA_BITS];
+    int pulsesCount = 0;
+    size_t pos = sensor.edgesCount;
+
+    // data bits are the last 40 high pulses (rising -> falling). Start of the transmission could be missed,
+    // so decoding goes from the end. Trailing rising edge (line released after last bit) is skipped
+    while ((pos >= 2) && (pulsesCount < DHT_DATA_BITS))
+    {
+        const EdgeInfo& fallingEdge = sensor.edges[pos - 1];
+        const EdgeInfo& risingEdge = sensor.edges[pos - 2];
+
+        if ((false == fallingEdge.rising) && (true == risingEdge.rising))
+        {
+            highPulses[DHT_DATA_BITS - 1 - pulsesCount] = diffNanoseconds(fallingEdge.timestamp, risingEdge.timestamp);
+            ++pulsesCount;
+            pos -= 2;
+        }
+        else
+        {
+            --pos;
+        }
+    }
+
+    if (DHT_DATA_BITS == pulsesCount)
+    {
+        byte data[DHT_DATA_BITS / 8] = {0};
+        bool validPulses = true;
+
+        for (int i = 0 ; i < DHT_DATA_BITS; ++i)
+        {
+            if (highPulses[i] > DHT_MAX_HIGH_PULSE_NS)
+            {
+                validPulses = false;
+                break;
+            }
+
+            data[i / 8] <<= 1;
+
+            if (highPulses[i] > DHT_BIT_THRESHOLD_NS)
+            {
+                data[i / 8] |= 1;
+            }
+        }
+
+        if ((true == validPulses) && (static_cast<byte>(data[0] + data[1] + data[2] + data[3]) == data[4]))
+        {
+            if (DHTType::DHT11 == sensor.type)
+            {
+                outData.humidity = data[0] + data[1] * 0.1;
+                outData.temperature = (data[2] & 0x7F) + data[3] * 0.1;
+            }
+            else
+            {
+                outData.humidity = ((data[0] << 8) | data[1]) * 0.1;
+                outData.temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1;
+            }
+
+            if (0 != (data[2] & 0x80))
+            {
+                outData.temperature = -outData.temperature;
+            }
+
+            outData.valid = true;
+            result = true;
+        }
+        else
+        {
+            TRACE_ERROR("invalid data from pin %d", SC2INT(sensor.pin));
+        }
+    }
+    else
+    {
+        TRACE_ERROR("not enough edges from pin %d (edges=%lu, bits=%d)", SC2INT(sensor.pin), sensor.edgesCount, pulsesCount);
+    }
+
+    return result;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "gpio/sensors/ds18b20.hpp"
+#include <utils/logging.hpp>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "DS18B20"
+
+#define DS18B20_CMD_CONVERT_T               (0x44)
+#define DS18B20_CMD_WRITE_SCRATCHPAD        (0x4E)
+#define DS18B20_CMD_READ_SCRATCHPAD         (0xBE)
+#define DS18B20_CMD_READ_POWER_SUPPLY       (0xB4)
+
+#define DS18B20_SCRATCHPAD_SIZE             (9)
+#define DS18B20_CONVERSION_TIME_12BIT_MS    (750)
+#define DS18B20_POLL_INTERVAL_MS            (10)
+// default alarm thresholds written together with configuration register
+#define DS18B20_DEFAULT_TH                  (0x4B)
+#define DS18B20_DEFAULT_TL                  (0x46)
+
+bool DS18B20::initialize(OneWire* bus)
+{
+    TRACE_CALL_DEBUG_ARGS("bus=%p", bus);
+    bool result = false;
+
+    mBus = bus;
+    mSensors.clear();
+
+    if ((nullptr != mBus) && (true == mBus->search(mSensors, DS18B20_FAMILY_CODE)))
+    {
+        // if any sensor uses parasite power it will pull the bus low during read slot
+        if (true == mBus->selectAll())
+        {
+            mBus->writeByte(DS18B20_CMD_READ_POWER_SUPPLY);
+            mHasParasitePower = (0 == mBus->readBit());
+        }
+
+        result = (false == mSensors.empty());
+    }
+
+    TRACE_CALL_RESULT("%d (sensors=%lu, parasite=%d)", BOOL2INT(result), mSensors.size(), BOOL2INT(mHasParasitePower));
+    return result;
+}
+
+bool DS18B20::setResolution(const int bits)
+{
+    bool result = false;
+
+    if ((nullptr != mBus) && (bits >= 9) && (bits <= 12) && (true == mBus->selectAll()))
+    {
+        const byte data[] = {DS18B20_CMD_WRITE_SCRATCHPAD,
+                             DS18B20_DEFAULT_TH,
+                             DS18B20_DEFAULT_TL,
+                             static_cast<byte>(((bits - 9) << 5) | 0x1F)};
+
+        mBus->write(data, sizeof(data));
+        mResolution = bits;
+        result = true;
+    }
+
+    return result;
+}
+
+bool DS18B20::startConversion()
+{
+    bool result = false;
+
+    if ((nullptr != mBus) && (true == mBus->selectAll()))
+    {
+        mBus->writeByte(DS18B20_CMD_CONVERT_T);
+        result = true;
+    }
+
+    return result;
+}
+
+bool DS18B20::waitConversion()
+{
+    bool result = false;
+
+    if (nullptr != mBus)
+    {
+        const struct timespec deadline = GenericDevice::addNanoseconds(GenericDevice::getMonotonicTime(),
+                                                                       static_cast<uint64_t>(getConversionTime()) * 1000000);
+
+        if (false == mHasParasitePower)
+        {
+            // sensors keep bus low while conversion is in progress
+            while ((false == result) && (GenericDevice::diffNanoseconds(deadline, GenericDevice::getMonotonicTime()) > 0))
+            {
+                GenericDevice::wait(DS18B20_POLL_INTERVAL_MS);
+                result = (0 != mBus->readBit());
+            }
+        }
+        else
+        {
+            // NOTE: parasite powered sensors need the bus to stay high during whole conversion
+            GenericDevice::waitUntil(deadline);
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+bool DS18B20::readTemperature(const OneWireRom_t rom, double& outTemperature)
+{
+    bool result = false;
+    byte data[DS18B20_SCRATCHPAD_SIZE];
+
+    if (true == readScratchpad(rom, data))
+    {
+        const int16_t raw = static_cast<int16_t>((data[1] << 8) | data[0]);
+        // undefined low bits for lower resolutions
+        const int16_t mask = ~((1 << (12 - mResolution)) - 1);
+
+        outTemperature = static_cast<double>(raw & mask) / 16.0;
+        result = true;
+    }
+
+    return result;
+}
+
+bool DS18B20::readAll(std::vector<SensorDataDS18B20>& outData)
+{
+    TRACE_CALL_DEBUG_ARGS("sensors=%lu", mSensors.size());
+    bool result = false;
+
+    outData.resize(mSensors.size());
+
+    if ((true == startConversion()) && (true == waitConversion()))
+    {
+        result = true;
+
+        for (size_t i = 0 ; i < mSensors.size(); ++i)
+        {
+            outData[i].rom = mSensors[i];
+            outData[i].valid = readTemperature(mSensors[i], outData[i].temperature);
+
+            if (false == outData[i].valid)
+            {
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool DS18B20::readScratchpad(const OneWireRom_t rom, byte* outData)
+{
+    bool result = false;
+
+    if ((nullptr != mBus) && (true == mBus->select(rom)))
+    {
+        mBus->writeByte(DS18B20_CMD_READ_SCRATCHPAD);
+        mBus->read(outData, DS18B20_SCRATCHPAD_SIZE);
+
+        // NOTE: low bits of configuration register are always 1. This also filters out bus stuck at 0 (which has valid CRC)
+        result = (OneWire::crc8(outData, DS18B20_SCRATCHPAD_SIZE - 1) == outData[DS18B20_SCRATCHPAD_SIZE - 1]) &&
+                 (0x1F == (outData[4] & 0x1F));
+
+        if (false == result)
+        {
+            TRACE_ERROR("scratchpad CRC mismatch (rom=%016llX)", static_cast<unsigned long long>(rom));
+        }
+    }
+
+    return result;
+}
+
+unsigned int DS18B20::getConversionTime() const
+{
+    // conversion time is halved for every bit of resolution below 12
+    return DS18B20_CONVERSION_TIME_12BIT_MS >> (12 - mResolution);
+}
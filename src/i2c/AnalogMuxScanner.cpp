@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "i2c/AnalogMuxScanner.hpp"
+#include "i2c/ads1x15.hpp"
+#include "gpio/74hc4051.hpp"
+#include "GenericDevice.hpp"
+#include <utils/logging.hpp>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "AnalogMuxScanner"
+
+// extra time to wait for conversion to complete before reporting an error
+#define CONVERSION_TIMEOUT_MARGIN_US        (5000)
+
+// mux channels in Gray code order (only one select line changes between neighbours)
+static const int sMuxScanOrder[ANALOG_MUX_CHANNELS] = {0, 1, 3, 2, 6, 7, 5, 4};
+
+AnalogInputID_t AnalogMuxScanner::addInput(ADS1X15* adc, const uint8_t adcChannel, Dev74HC4051* mux)
+{
+    TRACE_CALL_DEBUG_ARGS("adc=%p, adcChannel=%d, mux=%p", adc, SC2INT(adcChannel), mux);
+    AnalogInputID_t id = INVALID_ANALOG_INPUT_ID;
+
+    if ((nullptr != adc) && (adcChannel < 4))
+    {
+        ScanInput newInput;
+
+        newInput.adc = adc;
+        newInput.adcChannel = adcChannel;
+        newInput.mux = mux;
+
+        id = mInputs.size();
+        mInputs.push_back(newInput);
+    }
+
+    return id;
+}
+
+void AnalogMuxScanner::setSettlingTime(const unsigned int microseconds)
+{
+    mSettlingTime = microseconds;
+}
+
+bool AnalogMuxScanner::prepare()
+{
+    TRACE_CALL_DEBUG_ARGS("inputs=%lu", mInputs.size());
+    size_t frameSize = 0;
+
+    mQueues.clear();
+    mMuxes.clear();
+
+    for (size_t i = 0 ; i < mInputs.size(); ++i)
+    {
+        mInputs[i].frameOffset = frameSize;
+        mInputs[i].muxIndex = -1;
+        frameSize += (nullptr != mInputs[i].mux ? ANALOG_MUX_CHANNELS : 1);
+
+        // inputs can share a mux. its state is tracked in one place
+        if (nullptr != mInputs[i].mux)
+        {
+            size_t muxIndex = 0;
+
+            while ((muxIndex < mMuxes.size()) && (mMuxes[muxIndex].mux != mInputs[i].mux))
+            {
+                ++muxIndex;
+            }
+
+            if (muxIndex == mMuxes.size())
+            {
+                MuxState newMux;
+
+                newMux.mux = mInputs[i].mux;
+                mMuxes.push_back(newMux);
+            }
+
+            mInputs[i].muxIndex = static_cast<int>(muxIndex);
+        }
+    }
+
+    // group inputs by ADC
+    std::vector<std::vector<int>> adcInputs;
+
+    for (size_t i = 0 ; i < mInputs.size(); ++i)
+    {
+        size_t queueIndex = 0;
+
+        while ((queueIndex < mQueues.size()) && (mQueues[queueIndex].adc != mInputs[i].adc))
+        {
+            ++queueIndex;
+        }
+
+        if (queueIndex == mQueues.size())
+        {
+            AdcQueue newQueue;
+
+            newQueue.adc = mInputs[i].adc;
+            mQueues.push_back(newQueue);
+            adcInputs.emplace_back();
+        }
+
+        adcInputs[queueIndex].push_back(i);
+    }
+
+    // conversions on the same ADC alternate between its inputs, so next mux can be switched during conversion
+    for (size_t q = 0 ; q < mQueues.size(); ++q)
+    {
+        for (int i = 0 ; i < ANALOG_MUX_CHANNELS; ++i)
+        {
+            for (const int inputIndex: adcInputs[q])
+            {
+                const ScanInput& curInput = mInputs[inputIndex];
+                ScanStep newStep;
+
+                newStep.input = inputIndex;
+
+                if (nullptr != curInput.mux)
+                {
+                    newStep.muxChannel = sMuxScanOrder[i];
+                    newStep.frameIndex = curInput.frameOffset + sMuxScanOrder[i];
+                    mQueues[q].steps.push_back(newStep);
+                }
+                else if (0 == i)
+                {
+                    newStep.frameIndex = curInput.frameOffset;
+                    mQueues[q].steps.push_back(newStep);
+                }
+            }
+        }
+    }
+
+    mActiveSteps.assign(mQueues.size(), nullptr);
+    mFrame.assign(frameSize, 0);
+
+    return (frameSize > 0);
+}
+
+int AnalogMuxScanner::getFrameIndex(const AnalogInputID_t input, const int muxChannel) const
+{
+    int index = -1;
+
+    if ((input >= 0) && (static_cast<size_t>(input) < mInputs.size()))
+    {
+        if (nullptr != mInputs[input].mux)
+        {
+            if ((muxChannel >= 0) && (muxChannel < ANALOG_MUX_CHANNELS))
+            {
+                index = mInputs[input].frameOffset + muxChannel;
+            }
+        }
+        else if (0 == muxChannel)
+        {
+            index = mInputs[input].frameOffset;
+        }
+    }
+
+    return index;
+}
+
+bool AnalogMuxScanner::scanFrame()
+{
+    return scanFrame(mFrame.data(), mFrame.size());
+}
+
+bool AnalogMuxScanner::scanFrame(int16_t* outFrame, const size_t frameSize)
+{
+    bool result = false;
+
+    if ((nullptr != outFrame) && (frameSize >= mFrame.size()) && (false == mFrame.empty()))
+    {
+        const std::chrono::steady_clock::time_point scanStart = std::chrono::steady_clock::now();
+
+        result = true;
+
+        for (AdcQueue& curQueue: mQueues)
+        {
+            curQueue.position = 0;
+        }
+
+        while (true)
+        {
+            bool hasActiveSteps = false;
+            std::chrono::steady_clock::time_point readyTime = std::chrono::steady_clock::now();
+
+            for (MuxState& curMux: mMuxes)
+            {
+                curMux.claimedChannel = -1;
+            }
+
+            // make sure muxes are switched to channels we are going to convert
+            for (size_t q = 0 ; q < mQueues.size(); ++q)
+            {
+                mActiveSteps[q] = nullptr;
+
+                if (mQueues[q].position < mQueues[q].steps.size())
+                {
+                    ScanStep* curStep = &mQueues[q].steps[mQueues[q].position];
+                    const ScanInput& curInput = mInputs[curStep->input];
+
+                    hasActiveSteps = true;
+
+                    if (curInput.muxIndex < 0)
+                    {
+                        mActiveSteps[q] = curStep;
+                    }
+                    // if shared mux is already used by another conversion of this round, step is postponed
+                    else if ((mMuxes[curInput.muxIndex].claimedChannel < 0) ||
+                             (mMuxes[curInput.muxIndex].claimedChannel == curStep->muxChannel))
+                    {
+                        MuxState& curMux = mMuxes[curInput.muxIndex];
+
+                        curMux.claimedChannel = curStep->muxChannel;
+                        mActiveSteps[q] = curStep;
+
+                        if (true == selectMuxChannel(curMux, curStep->muxChannel))
+                        {
+                            if (curMux.readyTime > readyTime)
+                            {
+                                readyTime = curMux.readyTime;
+                            }
+                        }
+                        else
+                        {
+                            result = false;
+                        }
+                    }
+                }
+            }
+
+            if (false == hasActiveSteps)
+            {
+                break;
+            }
+
+            waitUntil(readyTime);
+
+            // start conversion on all ADCs
+            std::chrono::steady_clock::time_point conversionEnd = std::chrono::steady_clock::now();
+            unsigned int conversionTime = 0;
+
+            for (size_t q = 0 ; q < mQueues.size(); ++q)
+            {
+                if (nullptr != mActiveSteps[q])
+                {
+                    const ScanInput& curInput = mInputs[mActiveSteps[q]->input];
+
+                    mQueues[q].adc->startSingleChannelConversion(curInput.adcChannel);
+
+                    if (mQueues[q].adc->getConversionTime() > conversionTime)
+                    {
+                        conversionTime = mQueues[q].adc->getConversionTime();
+                    }
+                }
+            }
+
+            conversionEnd += std::chrono::microseconds(conversionTime);
+
+            // while ADCs are busy switch muxes for the next conversion
+            for (size_t q = 0 ; q < mQueues.size(); ++q)
+            {
+                const size_t nextPosition = mQueues[q].position + 1;
+
+                if ((nullptr != mActiveSteps[q]) && (nextPosition < mQueues[q].steps.size()))
+                {
+                    const ScanStep& nextStep = mQueues[q].steps[nextPosition];
+                    const int muxIndex = mInputs[nextStep.input].muxIndex;
+
+                    // mux can't be switched while any of its inputs is converting
+                    if ((muxIndex >= 0) && (mMuxes[muxIndex].claimedChannel < 0))
+                    {
+                        selectMuxChannel(mMuxes[muxIndex], nextStep.muxChannel);
+                    }
+                }
+            }
+
+            waitUntil(conversionEnd);
+
+            // collect results
+            const std::chrono::steady_clock::time_point timeout = conversionEnd + std::chrono::microseconds(CONVERSION_TIMEOUT_MARGIN_US);
+
+            for (size_t q = 0 ; q < mQueues.size(); ++q)
+            {
+                if (nullptr != mActiveSteps[q])
+                {
+                    ADS1X15* adc = mQueues[q].adc;
+                    bool isComplete = adc->conversionComplete();
+
+                    while ((false == isComplete) && (std::chrono::steady_clock::now() < timeout))
+                    {
+                        isComplete = adc->conversionComplete();
+                    }
+
+                    if (true == isComplete)
+                    {
+                        outFrame[mActiveSteps[q]->frameIndex] = adc->getLastConversionResults();
+                    }
+                    else
+                    {
+                        TRACE_ERROR("conversion timeout (input=%d, muxChannel=%d)", mActiveSteps[q]->input, mActiveSteps[q]->muxChannel);
+                        outFrame[mActiveSteps[q]->frameIndex] = 0;
+                        result = false;
+                    }
+
+                    mQueues[q].position++;
+                }
+            }
+        }
+
+        mLastScanDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - scanStart).count();
+    }
+
+    return result;
+}
+
+bool AnalogMuxScanner::selectMuxChannel(MuxState& mux, const int muxChannel)
+{
+    bool result = true;
+
+    if (muxChannel != mux.selectedChannel)
+    {
+        result = mux.mux->selectChannel(muxChannel);
+
+        if (true == result)
+        {
+            mux.selectedChannel = muxChannel;
+            mux.readyTime = std::chrono::steady_clock::now() + std::chrono::microseconds(mSettlingTime);
+        }
+        else
+        {
+            TRACE_ERROR("failed to select mux channel %d", muxChannel);
+            mux.selectedChannel = -1;
+        }
+    }
+
+    return result;
+}
+
+void AnalogMuxScanner::waitUntil(const std::chrono::steady_clock::time_point& deadline)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (now < deadline)
+    {
+        GenericDevice::waitNs(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+    }
+}
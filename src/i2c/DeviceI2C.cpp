@@ -3,8 +3,11 @@
  * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
  */
 #include "i2c/DeviceI2C.hpp"
+#include <utils/logging.hpp>
 #include <string>
+#include <algorithm>
 #include <cstring>
+#include <cerrno>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -14,6 +17,41 @@ extern "C"
   #include <i2c/smbus.h>
 }
 
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "DeviceI2C"
+
+// temporary buffers up to this size are allocated on stack
+#define I2C_LOCAL_BUFFER_SIZE               (64)
+// i2c-dev doesn't accept longer I2C_RDWR messages
+#define I2C_RDWR_MAX_MESSAGE_SIZE           (8192)
+
+// State of an asynchronous operation. Lives until completion callback is called
+struct I2CAsyncOperation
+{
+    I2CTransaction transaction;
+    I2CMessage messages[2];
+    std::vector<byte> txData;
+    I2CAsyncResult result;
+    I2CAsyncCallback_t callback;
+};
+
+static void finishAsyncOperation(I2CAsyncOperation* operation, const bool success)
+{
+    operation->result.success = success;
+
+    if (false == success)
+    {
+        operation->result.data.clear();
+    }
+
+    if (operation->callback)
+    {
+        operation->callback(operation->result);
+    }
+
+    delete operation;
+}
+
 DeviceI2C::~DeviceI2C()
 {
     closeDevice();
@@ -24,6 +62,7 @@ bool DeviceI2C::openDevice(const int adapterNumber, const int address, const int
     bool result = false;
     char devPath[20] = {0};
 
+    closeDevice();
     snprintf(devPath, sizeof(devPath) - 1, "/dev/i2c-%d", adapterNumber);
     mFD = open(devPath, O_RDWR);
 
@@ -31,8 +70,12 @@ bool DeviceI2C::openDevice(const int adapterNumber, const int address, const int
     {
         if (ioctl(mFD, I2C_SLAVE, address) >= 0)
         {
+            mAddress = address;
+
             if (ioctl(mFD, I2C_FUNCS, &mCapabilites) >= 0)
             {
+                mTransferStrategy = selectTransferStrategy(mCapabilites);
+
                 if (0 != capabilities)
                 {
                     result = (mCapabilites & capabilities);
@@ -54,6 +97,35 @@ bool DeviceI2C::openDevice(const int adapterNumber, const int address, const int
         close(mFD);
         mFD = INVALID_FD;
         mCapabilites = 0;
+        mTransferStrategy = I2CTransferStrategy::NONE;
+    }
+
+    return result;
+}
+
+bool DeviceI2C::openDevice(const std::shared_ptr<I2CBus>& bus, const int address, const int capabilities)
+{
+    return openDevice(bus, I2CMuxRoute(), address, capabilities);
+}
+
+bool DeviceI2C::openDevice(const std::shared_ptr<I2CBus>& bus, const I2CMuxRoute& route, const int address, const int capabilities)
+{
+    TRACE_CALL_DEBUG_ARGS("address=0x%X, mux=0x%X, channel=%d", address, route.muxAddress, route.channel);
+    bool result = false;
+
+    closeDevice();
+
+    if ((nullptr != bus) && ((I2C_NO_MUX == route.muxAddress) || ((route.channel >= 0) && (route.channel < I2C_MUX_MAX_CHANNELS))))
+    {
+        if ((0 == capabilities) || (0 != (bus->getCapabilities() & capabilities)))
+        {
+            mBus = bus;
+            mRoute = route;
+            mAddress = address;
+            mCapabilites = bus->getCapabilities();
+            mTransferStrategy = I2CTransferStrategy::NATIVE_I2C;// bus requires I2C_FUNC_I2C
+            result = true;
+        }
     }
 
     return result;
@@ -61,19 +133,28 @@ bool DeviceI2C::openDevice(const int adapterNumber, const int address, const int
 
 void DeviceI2C::closeDevice()
 {
-    if (true == isDeviceOpen())
+    if (INVALID_FD != mFD)
     {
         close(mFD);
         mFD = INVALID_FD;
-        mCapabilites = 0;
     }
+
+    mBus.reset();
+    mRoute = I2CMuxRoute();
+    mCapabilites = 0;
+    mTransferStrategy = I2CTransferStrategy::NONE;
+    invalidateRegisters();
 }
 
 byte DeviceI2C::readByte()
 {
     byte result = 0;
 
-    if (true == isDeviceOpen())
+    if (nullptr != mBus)
+    {
+        readBuffer(&result, sizeof(result));
+    }
+    else if (true == isDeviceOpen())
     {
         result = i2c_smbus_read_byte(mFD);
     }
@@ -85,7 +166,11 @@ byte DeviceI2C::readByte(const byte cmd)
 {
     byte result = 0;
 
-    if (true == isDeviceOpen())
+    if (nullptr != mBus)
+    {
+        readBuffer(cmd, &result, sizeof(result));
+    }
+    else if (true == isDeviceOpen())
     {
         result = i2c_smbus_read_byte_data(mFD, cmd);
     }
@@ -97,7 +182,17 @@ uint16_t DeviceI2C::readWord(const byte cmd, const Endianness bytesOrder)
 {
     uint16_t result = 0;
 
-    if (true == isDeviceOpen())
+    if (nullptr != mBus)
+    {
+        byte data[2] = {0};
+
+        // SMBus word is transferred low byte first
+        if (sizeof(data) == readBuffer(cmd, data, sizeof(data)))
+        {
+            result = normalizeBytes(loadLE<uint16_t>(data), bytesOrder);
+        }
+    }
+    else if (true == isDeviceOpen())
     {
         result = i2c_smbus_read_word_data(mFD, cmd);
         result = normalizeBytes(result, bytesOrder);
@@ -108,22 +203,99 @@ uint16_t DeviceI2C::readWord(const byte cmd, const Endianness bytesOrder)
 
 int DeviceI2C::readBuffer(byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder)
 {
-    // printf("READ: %lu bytes\n", bytesCount);
-    int actualBytes = 0;
+    int actualBytes = -1;
 
-    if (true == isDeviceOpen())
+    if (I2CError::OK == readBytes(ByteView(outBuffer, bytesCount)))
     {
-        actualBytes = read(mFD, outBuffer, bytesCount);
+        normalizeBytes(outBuffer, bytesCount, bytesOrder);
+        actualBytes = bytesCount;
+    }
+
+    return actualBytes;
+}
 
-        const byte* normalizedBuffer = normalizeBytes(outBuffer, actualBytes, bytesOrder);
+int DeviceI2C::readBuffer(const byte cmd, byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder)
+{
+    int actualBytes = -1;
 
-        if (outBuffer != normalizedBuffer)
+    if (I2CError::OK == readBytes(cmd, ByteView(outBuffer, bytesCount)))
+    {
+        normalizeBytes(outBuffer, bytesCount, bytesOrder);
+        actualBytes = bytesCount;
+    }
+
+    return actualBytes;
+}
+
+int DeviceI2C::writeThenRead(const byte* cmd, const size_t cmdSize, byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder)
+{
+    int actualBytes = -1;
+    I2CMessage messages[2];
+
+    // NOTE: S Addr Wr [A] Comm [A] Sr Addr Rd [A] [Data] A [Data] NA P
+    messages[0].buffer = const_cast<byte*>(cmd);
+    messages[0].size = cmdSize;
+    messages[1].buffer = outBuffer;
+    messages[1].size = bytesCount;
+    messages[1].isRead = true;
+
+    if (true == transfer(messages, 2))
+    {
+        normalizeBytes(outBuffer, bytesCount, bytesOrder);
+        actualBytes = bytesCount;
+    }
+
+    return actualBytes;
+}
+
+bool DeviceI2C::transfer(const I2CMessage* messages, const size_t messagesCount)
+{
+    bool result = false;
+
+    if ((nullptr != mBus) && (nullptr != messages))
+    {
+        result = mBus->execute(messages, messagesCount, mAddress, mRoute);
+    }
+    else if ((true == isDeviceOpen()) && (nullptr != messages) && (messagesCount > 0))
+    {
+        if ((0 != (mCapabilites & I2C_FUNC_I2C)) && (messagesCount <= I2C_RDWR_IOCTL_MAX_MSGS))
         {
-            memcpy(outBuffer, normalizedBuffer, bytesCount);
+            struct i2c_rdwr_ioctl_data transaction;
+            struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+
+            for (size_t i = 0 ; i < messagesCount; ++i)
+            {
+                struct i2c_msg& curMsg = msgs[i];
+
+                curMsg.addr = static_cast<__u16>(I2C_DEVICE_ADDRESS == messages[i].address ? mAddress : messages[i].address);
+                curMsg.flags = (true == messages[i].isRead ? I2C_M_RD : 0);
+                curMsg.len = static_cast<__u16>(messages[i].size);
+                curMsg.buf = messages[i].buffer;
+            }
+
+            transaction.msgs = msgs;
+            transaction.nmsgs = messagesCount;
+
+            // returns number of messages which were transferred
+            result = (static_cast<int>(messagesCount) == ioctl(mFD, I2C_RDWR, &transaction));
+
+            if (false == result)
+            {
+                TRACE_ERROR("I2C_RDWR failed (messages=%lu, errno=%d)", messagesCount, errno);
+            }
+        }
+        else
+        {
+            TRACE_ERROR("combined transactions are not supported (capabilities=0x%X, messages=%lu)", mCapabilites, messagesCount);
         }
     }
 
-    return actualBytes;
+    return result;
+}
+
+bool DeviceI2C::transfer(const std::vector<I2CMessage>& messages)
+{
+    return transfer(messages.data(), messages.size());
 }
 
 bool DeviceI2C::writeData(const uint8_t data)
@@ -159,41 +331,676 @@ bool DeviceI2C::writeData(const byte cmd, const uint32_t data, const Endianness
 
 bool DeviceI2C::writeBuffer(const byte* buffer, const size_t bytesCount, const Endianness bytesOrder)
 {
-    // printf("DeviceI2C::writeBuffer: %lu bytes\n", bytesCount);
+    ScratchBuffer<I2C_LOCAL_BUFFER_SIZE> scratch;
+
+    return (I2CError::OK == writeBytes(ConstByteView(normalizeBytes(buffer, bytesCount, bytesOrder, scratch), bytesCount)));
+}
+
+bool DeviceI2C::writeBuffer(const std::vector<byte>& buffer, const Endianness bytesOrder)
+{
+    return writeBuffer(buffer.data(), buffer.size(), bytesOrder);
+}
+
+bool DeviceI2C::writeBuffer(const byte cmd, const byte* buffer, const size_t bytesCount, const Endianness bytesOrder)
+{
+    ScratchBuffer<I2C_LOCAL_BUFFER_SIZE> scratch;
+
+    return (I2CError::OK == writeBytes(cmd, ConstByteView(normalizeBytes(buffer, bytesCount, bytesOrder, scratch), bytesCount)));
+}
+
+bool DeviceI2C::writeBuffer(const byte cmd, const std::vector<byte>& buffer, const Endianness bytesOrder)
+{
+    return writeBuffer(cmd, buffer.data(), buffer.size());
+}
+
+I2CError DeviceI2C::readBytes(ByteView outBuffer)
+{
+    I2CError result = checkTransferArguments(outBuffer.size());
+
+    if (I2CError::OK == result)
+    {
+        // NOTE: transfers without register address are never split. Device could treat every part as a new read
+        switch (mTransferStrategy)
+        {
+            case I2CTransferStrategy::NATIVE_I2C:
+                if (outBuffer.size() > I2C_RDWR_MAX_MESSAGE_SIZE)
+                {
+                    result = I2CError::NOT_SUPPORTED;
+                }
+                else if (nullptr != mBus)
+                {
+                    I2CMessage message;
+
+                    message.buffer = outBuffer.data();
+                    message.size = outBuffer.size();
+                    message.isRead = true;
+                    result = (true == transfer(&message, 1) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+                }
+                else
+                {
+                    result = (static_cast<ssize_t>(outBuffer.size()) == read(mFD, outBuffer.data(), outBuffer.size()) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+                }
+                break;
+            case I2CTransferStrategy::SMBUS_BLOCK:
+            case I2CTransferStrategy::SMBUS_BYTE:
+                if ((1 == outBuffer.size()) && (0 != (mCapabilites & I2C_FUNC_SMBUS_READ_BYTE)))
+                {
+                    const int value = i2c_smbus_read_byte(mFD);
+
+                    if (value >= 0)
+                    {
+                        outBuffer[0] = static_cast<byte>(value);
+                    }
+                    else
+                    {
+                        result = I2CError::TRANSFER_FAILED;
+                    }
+                }
+                else
+                {
+                    result = I2CError::NOT_SUPPORTED;
+                }
+                break;
+            default:
+                result = I2CError::NOT_SUPPORTED;
+                break;
+        }
+    }
+
+    return result;
+}
+
+I2CError DeviceI2C::readBytes(const byte cmd, ByteView outBuffer)
+{
+    I2CError result = checkTransferArguments(outBuffer.size());
+    const size_t chunkSize = getMaxChunkSize();
+
+    // register address is incremented for every chunk (device must support auto increment)
+    for (size_t offset = 0 ; (I2CError::OK == result) && (offset < outBuffer.size()); offset += chunkSize)
+    {
+        const byte reg = static_cast<byte>(cmd + offset);
+        ByteView chunk = outBuffer.subview(offset, chunkSize);
+
+        switch (mTransferStrategy)
+        {
+            case I2CTransferStrategy::NATIVE_I2C:
+            {
+                I2CMessage messages[2];
+
+                // NOTE: S Addr Wr [A] Comm [A] Sr Addr Rd [A] [Data] A [Data] NA P
+                messages[0].buffer = const_cast<byte*>(&reg);
+                messages[0].size = sizeof(reg);
+                messages[1].buffer = chunk.data();
+                messages[1].size = chunk.size();
+                messages[1].isRead = true;
+
+                if (false == transfer(messages, 2))
+                {
+                    result = I2CError::TRANSFER_FAILED;
+                }
+                break;
+            }
+            case I2CTransferStrategy::SMBUS_BLOCK:
+                if (static_cast<int>(chunk.size()) != i2c_smbus_read_i2c_block_data(mFD, reg, chunk.size(), chunk.data()))
+                {
+                    result = I2CError::TRANSFER_FAILED;
+                }
+                break;
+            case I2CTransferStrategy::SMBUS_BYTE:
+            {
+                const int value = i2c_smbus_read_byte_data(mFD, reg);
+
+                if (value >= 0)
+                {
+                    chunk[0] = static_cast<byte>(value);
+                }
+                else
+                {
+                    result = I2CError::TRANSFER_FAILED;
+                }
+                break;
+            }
+            default:
+                result = I2CError::NOT_SUPPORTED;
+                break;
+        }
+    }
+
+    return result;
+}
+
+I2CError DeviceI2C::writeBytes(ConstByteView buffer)
+{
+    I2CError result = checkTransferArguments(buffer.size());
+
+    if (I2CError::OK == result)
+    {
+        // NOTE: transfers without register address are never split. Device could treat every part as a new command
+        if (I2CTransferStrategy::NATIVE_I2C == mTransferStrategy)
+        {
+            if (buffer.size() > I2C_RDWR_MAX_MESSAGE_SIZE)
+            {
+                result = I2CError::NOT_SUPPORTED;
+            }
+            else if (nullptr != mBus)
+            {
+                I2CMessage message;
+
+                message.buffer = const_cast<byte*>(buffer.data());
+                message.size = buffer.size();
+                result = (true == transfer(&message, 1) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+            }
+            else
+            {
+                result = (static_cast<ssize_t>(buffer.size()) == write(mFD, buffer.data(), buffer.size()) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+            }
+        }
+        // SMBus transfers look the same on the wire as plain writes if first byte is used as a command
+        else if ((1 == buffer.size()) && (0 != (mCapabilites & I2C_FUNC_SMBUS_WRITE_BYTE)))
+        {
+            result = (0 == i2c_smbus_write_byte(mFD, buffer[0]) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+        }
+        else if ((2 == buffer.size()) && (0 != (mCapabilites & I2C_FUNC_SMBUS_WRITE_BYTE_DATA)))
+        {
+            result = (0 == i2c_smbus_write_byte_data(mFD, buffer[0], buffer[1]) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+        }
+        else if ((I2CTransferStrategy::SMBUS_BLOCK == mTransferStrategy) && (buffer.size() <= I2C_SMBUS_BLOCK_MAX + 1))
+        {
+            result = (0 == i2c_smbus_write_i2c_block_data(mFD, buffer[0], buffer.size() - 1, buffer.data() + 1) ? I2CError::OK : I2CError::TRANSFER_FAILED);
+        }
+        else
+        {
+            result = I2CError::NOT_SUPPORTED;
+        }
+    }
+
+    return result;
+}
+
+I2CError DeviceI2C::writeBytes(const byte cmd, ConstByteView buffer)
+{
+    I2CError result = checkTransferArguments(buffer.size());
+    const size_t chunkSize = getMaxChunkSize();
+
+    // register address is incremented for every chunk (device must support auto increment)
+    for (size_t offset = 0 ; (I2CError::OK == result) && (offset < buffer.size()); offset += chunkSize)
+    {
+        const byte reg = static_cast<byte>(cmd + offset);
+        ConstByteView chunk = buffer.subview(offset, chunkSize);
+
+        switch (mTransferStrategy)
+        {
+            case I2CTransferStrategy::NATIVE_I2C:
+            {
+                // register address and data must be sent in a single message (without repeated START)
+                ScratchBuffer<I2C_LOCAL_BUFFER_SIZE> scratch;
+                byte* txBuffer = scratch.get(chunk.size() + 1);
+                I2CMessage message;
+
+                txBuffer[0] = reg;
+                memcpy(txBuffer + 1, chunk.data(), chunk.size());
+                message.buffer = txBuffer;
+                message.size = chunk.size() + 1;
+
+                if (false == transfer(&message, 1))
+                {
+                    result = I2CError::TRANSFER_FAILED;
+                }
+                break;
+            }
+            case I2CTransferStrategy::SMBUS_BLOCK:
+                // NOTE: writes: S Addr Wr [A] Comm [A] Data [A] Data [A] ... [A] Data [A] P
+                //  see: https://www.kernel.org/doc/html/v5.4/i2c/smbus-protocol.html#i2c-block-write-i2c-smbus-write-i2c-block-data
+                if (0 != i2c_smbus_write_i2c_block_data(mFD, reg, chunk.size(), chunk.data()))
+                {
+                    result = I2CError::TRANSFER_FAILED;
+                }
+                break;
+            case I2CTransferStrategy::SMBUS_BYTE:
+                if (0 != i2c_smbus_write_byte_data(mFD, reg, chunk[0]))
+                {
+                    result = I2CError::TRANSFER_FAILED;
+                }
+                break;
+            default:
+                result = I2CError::NOT_SUPPORTED;
+                break;
+        }
+    }
+
+    return result;
+}
+
+I2CError DeviceI2C::readRegisters(const byte startReg, byte* outBuffer, const size_t count)
+{
+    return readBytes((count > 1 ? startReg | mAutoIncrementFlag : startReg), ByteView(outBuffer, count));
+}
+
+I2CError DeviceI2C::readRegisters(ConstByteView registers, ByteView outBuffer)
+{
+    I2CError result = checkTransferArguments(registers.size());
+
+    if ((I2CError::OK == result) && (outBuffer.size() < registers.size()))
+    {
+        result = I2CError::INVALID_ARGUMENT;
+    }
+    else if ((I2CError::OK == result) && (I2CTransferStrategy::NATIVE_I2C == mTransferStrategy))
+    {
+        // every register is a pair of messages: register address + repeated START + 1 byte read
+        const size_t maxRegisters = I2C_RDWR_IOCTL_MAX_MSGS / 2;
+        I2CMessage messages[maxRegisters * 2];
+
+        for (size_t first = 0 ; (I2CError::OK == result) && (first < registers.size()); first += maxRegisters)
+        {
+            const size_t count = std::min(maxRegisters, registers.size() - first);
+
+            for (size_t i = 0 ; i < count; ++i)
+            {
+                messages[i * 2].buffer = const_cast<byte*>(&registers[first + i]);
+                messages[i * 2].size = 1;
+                messages[i * 2 + 1].buffer = &outBuffer[first + i];
+                messages[i * 2 + 1].size = 1;
+                messages[i * 2 + 1].isRead = true;
+            }
+
+            if (false == transfer(messages, count * 2))
+            {
+                result = I2CError::TRANSFER_FAILED;
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0 ; (I2CError::OK == result) && (i < registers.size()); ++i)
+        {
+            result = readBytes(registers[i], outBuffer.subview(i, 1));
+        }
+    }
+
+    return result;
+}
+
+I2CError DeviceI2C::readByte(const byte cmd, byte& outValue)
+{
+    return readBytes(cmd, ByteView(&outValue, sizeof(outValue)));
+}
+
+bool DeviceI2C::startAsync(const std::vector<byte>& txData, const size_t rxSize, const I2CAsyncCallback_t& callback)
+{
     bool result = false;
+    I2CAsyncOperation* operation = new I2CAsyncOperation();
+    size_t messagesCount = 0;
 
-    if (true == isDeviceOpen())
+    operation->txData = txData;
+    operation->result.data.resize(rxSize);
+    operation->callback = callback;
+
+    if (false == operation->txData.empty())
+    {
+        operation->messages[messagesCount].buffer = operation->txData.data();
+        operation->messages[messagesCount].size = operation->txData.size();
+        ++messagesCount;
+    }
+
+    if (rxSize > 0)
+    {
+        operation->messages[messagesCount].buffer = operation->result.data.data();
+        operation->messages[messagesCount].size = rxSize;
+        operation->messages[messagesCount].isRead = true;
+        ++messagesCount;
+    }
+
+    if ((messagesCount > 0) && (nullptr != mBus))
+    {
+        operation->transaction.messages = operation->messages;
+        operation->transaction.messagesCount = messagesCount;
+        operation->transaction.defaultAddress = mAddress;
+        operation->transaction.route = mRoute;
+        operation->transaction.onComplete = [operation](const bool success)
+        {
+            finishAsyncOperation(operation, success);
+        };
+
+        result = mBus->submit(operation->transaction);
+
+        if (false == result)
+        {
+            finishAsyncOperation(operation, false);
+        }
+    }
+    else if ((messagesCount > 0) && (true == isDeviceOpen()))
     {
-        write(mFD, normalizeBytes(buffer, bytesCount, bytesOrder), bytesCount);
+        finishAsyncOperation(operation, transfer(operation->messages, messagesCount));
         result = true;
     }
+    else
+    {
+        finishAsyncOperation(operation, false);
+    }
 
     return result;
 }
 
-bool DeviceI2C::writeBuffer(const std::vector<byte>& buffer, const Endianness bytesOrder)
+std::future<I2CAsyncResult> DeviceI2C::readBufferAsync(const size_t bytesCount)
 {
-    return writeBuffer(buffer.data(), buffer.size(), bytesOrder);
+    std::shared_ptr<std::promise<I2CAsyncResult>> promise = std::make_shared<std::promise<I2CAsyncResult>>();
+    std::future<I2CAsyncResult> result = promise->get_future();
+
+    startAsync({}, bytesCount, [promise](I2CAsyncResult& operationResult){ promise->set_value(std::move(operationResult)); });
+
+    return result;
 }
 
-bool DeviceI2C::writeBuffer(const byte cmd, const byte* buffer, const size_t bytesCount, const Endianness bytesOrder)
+std::future<I2CAsyncResult> DeviceI2C::readBufferAsync(const byte cmd, const size_t bytesCount)
 {
-    // printf("WRITE: %lu bytes\n", bytesCount);
+    std::shared_ptr<std::promise<I2CAsyncResult>> promise = std::make_shared<std::promise<I2CAsyncResult>>();
+    std::future<I2CAsyncResult> result = promise->get_future();
+
+    startAsync({cmd}, bytesCount, [promise](I2CAsyncResult& operationResult){ promise->set_value(std::move(operationResult)); });
+
+    return result;
+}
+
+std::future<bool> DeviceI2C::writeBufferAsync(const std::vector<byte>& buffer)
+{
+    std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = promise->get_future();
+
+    startAsync(buffer, 0, [promise](I2CAsyncResult& operationResult){ promise->set_value(operationResult.success); });
+
+    return result;
+}
+
+std::future<bool> DeviceI2C::writeBufferAsync(const byte cmd, const std::vector<byte>& buffer)
+{
+    std::vector<byte> data;
+
+    data.reserve(buffer.size() + 1);
+    data.push_back(cmd);
+    data.insert(data.end(), buffer.begin(), buffer.end());
+
+    return writeBufferAsync(data);
+}
+
+bool DeviceI2C::declareRegister(const byte reg, const uint8_t size, const uint32_t volatileMask, const Endianness bytesOrder)
+{
+    TRACE_CALL_DEBUG_ARGS("reg=0x%X, size=%d, volatileMask=0x%X", SC2INT(reg), SC2INT(size), volatileMask);
     bool result = false;
 
-    if (true == isDeviceOpen())
+    if ((size > 0) && (size <= sizeof(uint32_t)))
     {
-        // NOTE: writes: S Addr Wr [A] Comm [A] Data [A] Data [A] ... [A] Data [A] P
-        //  see: https://www.kernel.org/doc/html/v5.4/i2c/smbus-protocol.html#i2c-block-write-i2c-smbus-write-i2c-block-data
-        result = (0 == i2c_smbus_write_i2c_block_data(mFD, cmd, bytesCount, normalizeBytes(buffer, bytesCount, bytesOrder)));
+        if (true == mRegisters.empty())
+        {
+            mRegisters.resize(256);
+        }
+
+        I2CRegisterShadow& shadow = mRegisters[reg];
+
+        shadow.size = size;
+        shadow.bytesOrder = (Endianness::NATIVE == bytesOrder ? HWIOCPP_NATIVE_BYTES_ORDER : bytesOrder);
+        shadow.volatileMask = volatileMask & (0xFFFFFFFFu >> (8 * (sizeof(uint32_t) - size)));
+        shadow.value = 0;
+        shadow.isValid = false;
+        result = true;
     }
 
     return result;
 }
 
-bool DeviceI2C::writeBuffer(const byte cmd, const std::vector<byte>& buffer, const Endianness bytesOrder)
+bool DeviceI2C::readRegister(const byte reg, uint32_t& outValue)
 {
-    return writeBuffer(cmd, buffer.data(), buffer.size());
+    bool result = false;
+    I2CRegisterShadow* shadow = getRegisterShadow(reg);
+
+    if (nullptr != shadow)
+    {
+        if ((true == shadow->isValid) && (I2C_REGISTER_NON_VOLATILE == shadow->volatileMask))
+        {
+            outValue = shadow->value;
+            ++mRegisterCacheStats.cachedReads;
+            result = true;
+        }
+        else
+        {
+            byte data[sizeof(uint32_t)] = {0};
+
+            ++mRegisterCacheStats.busReads;
+
+            if (true == readRegisterData(reg, data, shadow->size))
+            {
+                uint32_t value = 0;
+
+                for (uint8_t i = 0 ; i < shadow->size; ++i)
+                {
+                    const uint8_t pos = (Endianness::LITTLE == shadow->bytesOrder ? shadow->size - 1 - i : i);
+
+                    value = (value << 8) | data[pos];
+                }
+
+                shadow->value = value & ~shadow->volatileMask;
+                shadow->isValid = true;
+                outValue = value;
+                result = true;
+            }
+            else
+            {
+                shadow->isValid = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool DeviceI2C::writeRegister(const byte reg, const uint32_t value)
+{
+    bool result = false;
+    I2CRegisterShadow* shadow = getRegisterShadow(reg);
+
+    if (nullptr != shadow)
+    {
+        const uint32_t sizeMask = 0xFFFFFFFFu >> (8 * (sizeof(uint32_t) - shadow->size));
+        const uint32_t newValue = value & sizeMask;
+
+        if ((true == shadow->isValid) &&
+            (sizeMask != shadow->volatileMask) &&
+            (0 == (newValue & shadow->volatileMask)) &&
+            (shadow->value == newValue))
+        {
+            ++mRegisterCacheStats.skippedWrites;
+            result = true;
+        }
+        else
+        {
+            byte data[sizeof(uint32_t)] = {0};
+
+            for (uint8_t i = 0 ; i < shadow->size; ++i)
+            {
+                const uint8_t shift = 8 * (Endianness::LITTLE == shadow->bytesOrder ? i : shadow->size - 1 - i);
+
+                data[i] = static_cast<byte>((newValue >> shift) & 0xFF);
+            }
+
+            ++mRegisterCacheStats.busWrites;
+            result = writeRegisterData(reg, data, shadow->size);
+            shadow->value = newValue & ~shadow->volatileMask;
+            shadow->isValid = result;
+        }
+    }
+
+    return result;
+}
+
+bool DeviceI2C::updateRegister(const byte reg, const uint32_t mask, const uint32_t value)
+{
+    bool result = false;
+    I2CRegisterShadow* shadow = getRegisterShadow(reg);
+
+    if (nullptr != shadow)
+    {
+        uint32_t currentValue = shadow->value;
+
+        if ((true == shadow->isValid) || (true == readRegister(reg, currentValue)))
+        {
+            // volatile bits are not written back unless they are explicitly requested
+            currentValue &= ~shadow->volatileMask;
+            result = writeRegister(reg, (currentValue & ~mask) | (value & mask));
+        }
+    }
+
+    return result;
+}
+
+void DeviceI2C::invalidateRegister(const byte reg)
+{
+    if (false == mRegisters.empty())
+    {
+        mRegisters[reg].isValid = false;
+    }
+}
+
+void DeviceI2C::invalidateRegisters()
+{
+    for (I2CRegisterShadow& curRegister: mRegisters)
+    {
+        curRegister.isValid = false;
+    }
+}
+
+I2CRegisterShadow* DeviceI2C::getRegisterShadow(const byte reg)
+{
+    I2CRegisterShadow* shadow = nullptr;
+
+    if ((false == mRegisters.empty()) && (mRegisters[reg].size > 0))
+    {
+        shadow = &mRegisters[reg];
+    }
+    else
+    {
+        TRACE_ERROR("register 0x%X was not declared", SC2INT(reg));
+    }
+
+    return shadow;
+}
+
+bool DeviceI2C::readRegisterData(const byte reg, byte* outBuffer, const size_t bytesCount)
+{
+    bool result = false;
+
+    // byte transfers would split 16-bit register into two reads. SMBus word is transferred low byte first
+    if ((2 == bytesCount) &&
+        (I2CTransferStrategy::SMBUS_BYTE == mTransferStrategy) &&
+        (0 != (mCapabilites & I2C_FUNC_SMBUS_READ_WORD_DATA)))
+    {
+        const int value = i2c_smbus_read_word_data(mFD, reg);
+
+        if (value >= 0)
+        {
+            storeLE<uint16_t>(outBuffer, static_cast<uint16_t>(value));
+            result = true;
+        }
+    }
+    else
+    {
+        result = (I2CError::OK == readBytes(reg, ByteView(outBuffer, bytesCount)));
+    }
+
+    return result;
+}
+
+bool DeviceI2C::writeRegisterData(const byte reg, const byte* buffer, const size_t bytesCount)
+{
+    bool result = false;
+
+    if ((2 == bytesCount) &&
+        (I2CTransferStrategy::SMBUS_BYTE == mTransferStrategy) &&
+        (0 != (mCapabilites & I2C_FUNC_SMBUS_WRITE_WORD_DATA)))
+    {
+        result = (0 == i2c_smbus_write_word_data(mFD, reg, loadLE<uint16_t>(buffer)));
+    }
+    else
+    {
+        result = (I2CError::OK == writeBytes(reg, ConstByteView(buffer, bytesCount)));
+    }
+
+    return result;
+}
+
+bool DeviceI2C::setTransferStrategy(const I2CTransferStrategy strategy)
+{
+    bool result = false;
+
+    // only downgrade is allowed
+    if ((true == isDeviceOpen()) && (strategy <= selectTransferStrategy(mCapabilites)) &&
+        ((nullptr == mBus) || (I2CTransferStrategy::NATIVE_I2C == strategy)))
+    {
+        mTransferStrategy = strategy;
+        result = true;
+    }
+
+    return result;
+}
+
+size_t DeviceI2C::getMaxChunkSize() const
+{
+    size_t result = 0;
+
+    switch (mTransferStrategy)
+    {
+        case I2CTransferStrategy::NATIVE_I2C:
+            result = I2C_RDWR_MAX_MESSAGE_SIZE - 1;// one byte is used by register address
+            break;
+        case I2CTransferStrategy::SMBUS_BLOCK:
+            result = I2C_SMBUS_BLOCK_MAX;
+            break;
+        case I2CTransferStrategy::SMBUS_BYTE:
+            result = 1;
+            break;
+        default:
+            break;
+    }
+
+    return result;
+}
+
+I2CTransferStrategy DeviceI2C::selectTransferStrategy(const int capabilities)
+{
+    I2CTransferStrategy result = I2CTransferStrategy::NONE;
+
+    if (0 != (capabilities & I2C_FUNC_I2C))
+    {
+        result = I2CTransferStrategy::NATIVE_I2C;
+    }
+    else if (I2C_FUNC_SMBUS_I2C_BLOCK == (capabilities & I2C_FUNC_SMBUS_I2C_BLOCK))
+    {
+        result = I2CTransferStrategy::SMBUS_BLOCK;
+    }
+    else if (I2C_FUNC_SMBUS_BYTE_DATA == (capabilities & I2C_FUNC_SMBUS_BYTE_DATA))
+    {
+        result = I2CTransferStrategy::SMBUS_BYTE;
+    }
+
+    return result;
+}
+
+I2CError DeviceI2C::checkTransferArguments(const size_t bytesCount) const
+{
+    I2CError result = I2CError::OK;
+
+    if ((INVALID_FD == mFD) && (nullptr == mBus))
+    {
+        result = I2CError::NOT_OPEN;
+    }
+    else if (0 == bytesCount)
+    {
+        result = I2CError::INVALID_ARGUMENT;
+    }
+    else if (I2CTransferStrategy::NONE == mTransferStrategy)
+    {
+        result = I2CError::NOT_SUPPORTED;
+    }
+
+    return result;
 }
 
 void DeviceI2C::printCapabilities()
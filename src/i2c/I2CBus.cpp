@@ -0,0 +1,505 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "i2c/I2CBus.hpp"
+#include "utils/ThreadPolicy.hpp"
+#include <utils/logging.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "I2CBus"
+
+std::mutex I2CBus::sBusesSync;
+std::map<int, std::weak_ptr<I2CBus>> I2CBus::sBuses;
+
+std::shared_ptr<I2CBus> I2CBus::getBus(const int adapterNumber)
+{
+    TRACE_CALL_DEBUG_ARGS("adapterNumber=%d", adapterNumber);
+    std::lock_guard<std::mutex> lock(sBusesSync);
+    std::shared_ptr<I2CBus> bus = sBuses[adapterNumber].lock();
+
+    if (!bus)
+    {
+        bus.reset(new I2CBus(adapterNumber));
+
+        if (true == bus->open())
+        {
+            sBuses[adapterNumber] = bus;
+        }
+        else
+        {
+            bus.reset();
+            sBuses.erase(adapterNumber);
+        }
+    }
+
+    return bus;
+}
+
+I2CBus::I2CBus(const int adapterNumber)
+    : mAdapterNumber(adapterNumber)
+{
+}
+
+I2CBus::~I2CBus()
+{
+    TRACE_CALL_DEBUG_ARGS("adapterNumber=%d", mAdapterNumber);
+
+    if (true == mIsRunning)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            mIsRunning = false;
+            mSubmitCondition.notify_one();
+        }
+
+        mWorker.join();
+    }
+
+    if (INVALID_FD != mFD)
+    {
+        close(mFD);
+        mFD = INVALID_FD;
+    }
+}
+
+bool I2CBus::open()
+{
+    bool result = false;
+    char devPath[20] = {0};
+
+    snprintf(devPath, sizeof(devPath) - 1, "/dev/i2c-%d", mAdapterNumber);
+    mFD = ::open(devPath, O_RDWR | O_CLOEXEC);
+
+    if (mFD >= 0)
+    {
+        if ((ioctl(mFD, I2C_FUNCS, &mCapabilities) >= 0) && (0 != (mCapabilities & I2C_FUNC_I2C)))
+        {
+            mMessages.resize(I2C_RDWR_IOCTL_MAX_MSGS);
+            resetStats();
+            mIsRunning = true;
+            mWorker = std::thread(&I2CBus::threadWorker, this);
+            result = true;
+        }
+        else
+        {
+            TRACE_ERROR("%s doesn't support I2C_RDWR (capabilities=0x%X)", devPath, mCapabilities);
+            close(mFD);
+            mFD = INVALID_FD;
+        }
+    }
+    else
+    {
+        TRACE_ERROR("failed to open %s", devPath);
+        mFD = INVALID_FD;
+    }
+
+    return result;
+}
+
+bool I2CBus::submit(I2CTransaction& transaction)
+{
+    bool result = false;
+    I2CTransactionState expectedState = transaction.state.load();
+
+    if ((true == mIsRunning) &&
+        (nullptr != transaction.messages) && (transaction.messagesCount > 0) && (transaction.messagesCount <= I2C_RDWR_IOCTL_MAX_MSGS) &&
+        (I2CTransactionState::PENDING != expectedState) &&
+        (true == transaction.state.compare_exchange_strong(expectedState, I2CTransactionState::PENDING)))
+    {
+        // push to lock-free stack. worker restores submission order when it takes the whole stack
+        I2CTransaction* head = mQueueHead.load(std::memory_order_relaxed);
+
+        do
+        {
+            transaction.next = head;
+        } while (false == mQueueHead.compare_exchange_weak(head, &transaction));
+
+        // NOTE: both operations are sequentially consistent, so either worker sees new transaction before going to
+        //       sleep or we see that it's sleeping
+        if (true == mWorkerSleeping)
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            mSubmitCondition.notify_one();
+        }
+
+        result = true;
+    }
+
+    return result;
+}
+
+bool I2CBus::wait(I2CTransaction& transaction)
+{
+    if (I2CTransactionState::PENDING == transaction.state)
+    {
+        std::unique_lock<std::mutex> lock(mSync);
+
+        mCompleteCondition.wait(lock, [&](){ return I2CTransactionState::PENDING != transaction.state; });
+    }
+
+    return (I2CTransactionState::COMPLETED == transaction.state);
+}
+
+bool I2CBus::execute(const I2CMessage* messages, const size_t messagesCount, const int defaultAddress, const I2CMuxRoute& route)
+{
+    I2CTransaction transaction;
+
+    transaction.messages = messages;
+    transaction.messagesCount = messagesCount;
+    transaction.defaultAddress = defaultAddress;
+    transaction.route = route;
+
+    return (true == submit(transaction)) && (true == wait(transaction));
+}
+
+I2CBusStats I2CBus::getStats() const
+{
+    I2CBusStats stats;
+
+    stats.transactions = mTransactionsCount;
+    stats.failedTransactions = mFailedTransactions;
+    stats.ioctls = mIoctlsCount;
+    stats.messages = mMessagesCount;
+    stats.bytes = mBytesCount;
+    stats.muxSwitches = mMuxSwitches;
+    stats.muxSwitchesAvoided = mMuxSwitchesAvoided;
+    stats.busyTime = mBusyTime;
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        stats.elapsedTime = GenericDevice::diffNanoseconds(GenericDevice::getMonotonicTime(), mStatsStart);
+    }
+
+    if (stats.elapsedTime > 0)
+    {
+        stats.utilization = static_cast<double>(stats.busyTime) / stats.elapsedTime;
+    }
+
+    return stats;
+}
+
+void I2CBus::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mTransactionsCount = 0;
+    mFailedTransactions = 0;
+    mIoctlsCount = 0;
+    mMessagesCount = 0;
+    mBytesCount = 0;
+    mMuxSwitches = 0;
+    mMuxSwitchesAvoided = 0;
+    mBusyTime = 0;
+    mStatsStart = GenericDevice::getMonotonicTime();
+}
+
+void I2CBus::threadWorker()
+{
+    TRACE_CALL();
+    ThreadPolicyManager::onThreadStarted(HwioThread::I2C_BUS);
+
+    while (true == collectTransactions())
+    {
+        size_t first = 0;
+
+        if (true == mMuxStateInvalid.exchange(false))
+        {
+            mMuxes.clear();
+        }
+
+        if (true == mMuxGrouping)
+        {
+            groupByRoute();
+        }
+
+        while (first < mBatch.size())
+        {
+            const I2CMuxRoute& route = mBatch[first]->route;
+            size_t count = 1;
+            size_t messagesCount = mBatch[first]->messagesCount;
+
+            // merge following transactions while they fit into a single ioctl and use the same mux channel
+            while ((true == mCoalescing) &&
+                   (first + count < mBatch.size()) &&
+                   (messagesCount + mBatch[first + count]->messagesCount <= I2C_RDWR_IOCTL_MAX_MSGS) &&
+                   (route.muxAddress == mBatch[first + count]->route.muxAddress) &&
+                   ((I2C_NO_MUX == route.muxAddress) || (route.channel == mBatch[first + count]->route.channel)))
+            {
+                messagesCount += mBatch[first + count]->messagesCount;
+                ++count;
+            }
+
+            if (true == selectRoute(route))
+            {
+                executeGroup(first, count, messagesCount);
+            }
+            else
+            {
+                for (size_t i = first ; i < first + count; ++i)
+                {
+                    completeTransaction(mBatch[i], false);
+                }
+            }
+
+            first += count;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mSync);
+
+            mCompleteCondition.notify_all();
+        }
+    }
+
+    // fail transactions which were not executed
+    for (I2CTransaction* curTransaction: mBatch)
+    {
+        completeTransaction(curTransaction, false);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        mCompleteCondition.notify_all();
+    }
+
+    ThreadPolicyManager::onThreadFinished(HwioThread::I2C_BUS);
+}
+
+bool I2CBus::collectTransactions()
+{
+    I2CTransaction* head = mQueueHead.exchange(nullptr, std::memory_order_acquire);
+
+    if ((nullptr == head) && (true == mIsRunning))
+    {
+        std::unique_lock<std::mutex> lock(mSync);
+
+        mWorkerSleeping = true;
+        mSubmitCondition.wait(lock, [&](){ return (nullptr != mQueueHead.load()) || (false == mIsRunning); });
+        mWorkerSleeping = false;
+        head = mQueueHead.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    mBatch.clear();
+
+    while (nullptr != head)
+    {
+        mBatch.push_back(head);
+        head = head->next;
+    }
+
+    // stack contains newest transactions first
+    std::reverse(mBatch.begin(), mBatch.end());
+
+    return mIsRunning;
+}
+
+void I2CBus::invalidateMuxState()
+{
+    // mux state is owned by worker thread. it will be reset before next batch
+    mMuxStateInvalid = true;
+}
+
+void I2CBus::groupByRoute()
+{
+    bool hasRoutes = false;
+
+    for (const I2CTransaction* curTransaction: mBatch)
+    {
+        if (I2C_NO_MUX != curTransaction->route.muxAddress)
+        {
+            hasRoutes = true;
+            break;
+        }
+    }
+
+    if (true == hasRoutes)
+    {
+        // direct transactions first (they don't need switching), then currently selected channel, then the rest.
+        // stable sort keeps submission order within the same channel
+        auto getRank = [&](const I2CTransaction* transaction)
+        {
+            int64_t rank = 0;
+
+            if (I2C_NO_MUX != transaction->route.muxAddress)
+            {
+                const int mask = 1 << transaction->route.channel;
+                bool isSelected = false;
+
+                for (const MuxState& curMux: mMuxes)
+                {
+                    if (curMux.address == transaction->route.muxAddress)
+                    {
+                        isSelected = (curMux.selectedMask == mask);
+                        break;
+                    }
+                }
+
+                rank = (true == isSelected ? 1 : 2 + ((static_cast<int64_t>(transaction->route.muxAddress) << 8) | transaction->route.channel));
+            }
+
+            return rank;
+        };
+
+        std::stable_sort(mBatch.begin(), mBatch.end(), [&](const I2CTransaction* left, const I2CTransaction* right)
+        {
+            return getRank(left) < getRank(right);
+        });
+    }
+}
+
+bool I2CBus::selectRoute(const I2CMuxRoute& route)
+{
+    bool result = true;
+    MuxState* target = nullptr;
+
+    // disconnect channels of all other muxes (all of them for directly connected devices), so that
+    // devices behind them can't conflict with the target device. muxes in unknown state are disconnected too
+    for (MuxState& curMux: mMuxes)
+    {
+        if ((I2C_NO_MUX != route.muxAddress) && (curMux.address == route.muxAddress))
+        {
+            target = &curMux;
+        }
+        else if ((0 != curMux.selectedMask) && (false == writeMuxMask(curMux, 0)))
+        {
+            result = false;
+        }
+    }
+
+    if (I2C_NO_MUX != route.muxAddress)
+    {
+        const int mask = 1 << route.channel;
+
+        if (nullptr == target)
+        {
+            mMuxes.emplace_back();
+            target = &mMuxes.back();
+            target->address = route.muxAddress;
+        }
+
+        if (true == result)
+        {
+            if (mask != target->selectedMask)
+            {
+                result = writeMuxMask(*target, mask);
+            }
+            else
+            {
+                ++mMuxSwitchesAvoided;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool I2CBus::writeMuxMask(MuxState& mux, const int mask)
+{
+    struct i2c_rdwr_ioctl_data transaction;
+    struct i2c_msg msg;
+    byte value = static_cast<byte>(mask);
+
+    msg.addr = static_cast<__u16>(mux.address);
+    msg.flags = 0;
+    msg.len = sizeof(value);
+    msg.buf = &value;
+    transaction.msgs = &msg;
+    transaction.nmsgs = 1;
+
+    const struct timespec ioctlStart = GenericDevice::getMonotonicTime();
+    const bool success = (1 == ioctl(mFD, I2C_RDWR, &transaction));
+
+    mBusyTime += GenericDevice::diffNanoseconds(GenericDevice::getMonotonicTime(), ioctlStart);
+    ++mIoctlsCount;
+    ++mMuxSwitches;
+
+    if (true == success)
+    {
+        mux.selectedMask = mask;
+    }
+    else
+    {
+        TRACE_ERROR("failed to select channels 0x%X of mux 0x%X (errno=%d)", mask, mux.address, errno);
+        mux.selectedMask = -1;
+    }
+
+    return success;
+}
+
+void I2CBus::executeGroup(const size_t first, const size_t count, const size_t messagesCount)
+{
+    struct i2c_rdwr_ioctl_data transaction;
+    size_t msgIndex = 0;
+    uint64_t bytesCount = 0;
+
+    for (size_t i = first ; i < first + count; ++i)
+    {
+        const I2CTransaction* curTransaction = mBatch[i];
+
+        for (size_t m = 0 ; m < curTransaction->messagesCount; ++m)
+        {
+            const I2CMessage& curMessage = curTransaction->messages[m];
+            struct i2c_msg& curMsg = mMessages[msgIndex++];
+
+            curMsg.addr = static_cast<__u16>(I2C_DEVICE_ADDRESS == curMessage.address ? curTransaction->defaultAddress : curMessage.address);
+            curMsg.flags = (true == curMessage.isRead ? I2C_M_RD : 0);
+            curMsg.len = static_cast<__u16>(curMessage.size);
+            curMsg.buf = curMessage.buffer;
+            bytesCount += curMessage.size;
+        }
+    }
+
+    transaction.msgs = mMessages.data();
+    transaction.nmsgs = messagesCount;
+
+    const struct timespec ioctlStart = GenericDevice::getMonotonicTime();
+    const bool success = (static_cast<int>(messagesCount) == ioctl(mFD, I2C_RDWR, &transaction));
+
+    mBusyTime += GenericDevice::diffNanoseconds(GenericDevice::getMonotonicTime(), ioctlStart);
+    ++mIoctlsCount;
+    mMessagesCount += messagesCount;
+    mBytesCount += bytesCount;
+
+    if (false == success)
+    {
+        TRACE_ERROR("I2C_RDWR failed (transactions=%lu, messages=%lu, errno=%d)", count, messagesCount, errno);
+    }
+
+    for (size_t i = first ; i < first + count; ++i)
+    {
+        completeTransaction(mBatch[i], success);
+    }
+}
+
+void I2CBus::completeTransaction(I2CTransaction* transaction, const bool success)
+{
+    I2CTransactionCallback_t callback;
+
+    ++mTransactionsCount;
+
+    if (false == success)
+    {
+        ++mFailedTransactions;
+    }
+
+    // waiting thread can destroy transaction as soon as its state is changed
+    callback.swap(transaction->onComplete);
+    transaction->state = (true == success ? I2CTransactionState::COMPLETED : I2CTransactionState::FAILED);
+
+    if (callback)
+    {
+        callback(success);
+    }
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "i2c/I2CBusExecutor.hpp"
+#include <utils/logging.hpp>
+#include <algorithm>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "I2CBusExecutor"
+
+I2CBusExecutor::~I2CBusExecutor()
+{
+    // sample() always waits for all transactions, so there is nothing pending at this point
+    clear();
+}
+
+int I2CBusExecutor::addSample(const DeviceI2C& device, const std::vector<byte>& txData, const size_t rxSize)
+{
+    return addSample(device.getBus(), device.getRoute(), device.getAddress(), txData, rxSize);
+}
+
+int I2CBusExecutor::addSample(const std::shared_ptr<I2CBus>& bus, const I2CMuxRoute& route, const int address,
+                              const std::vector<byte>& txData, const size_t rxSize)
+{
+    TRACE_CALL_DEBUG_ARGS("address=0x%X, tx=%d, rx=%d", address, SC2INT(txData.size()), SC2INT(rxSize));
+    int index = -1;
+
+    if ((nullptr != bus) && ((false == txData.empty()) || (rxSize > 0)))
+    {
+        std::unique_ptr<Entry> entry(new Entry());
+        size_t messagesCount = 0;
+
+        entry->bus = bus;
+        entry->address = address;
+        entry->txData = txData;
+        entry->rxSize = rxSize;
+
+        if (false == entry->txData.empty())
+        {
+            entry->messages[messagesCount].buffer = entry->txData.data();
+            entry->messages[messagesCount].size = entry->txData.size();
+            entry->messages[messagesCount].isRead = false;
+            ++messagesCount;
+        }
+
+        if (rxSize > 0)
+        {
+            // buffer is set by sample() to point directly to the frame
+            entry->messages[messagesCount].size = rxSize;
+            entry->messages[messagesCount].isRead = true;
+            ++messagesCount;
+        }
+
+        entry->transaction.messages = entry->messages;
+        entry->transaction.messagesCount = messagesCount;
+        entry->transaction.defaultAddress = address;
+        entry->transaction.route = route;
+
+        index = static_cast<int>(mEntries.size());
+        mEntries.push_back(std::move(entry));
+    }
+    else
+    {
+        TRACE_ERROR("invalid sample (bus=%d)", BOOL2INT(nullptr != bus));
+    }
+
+    return index;
+}
+
+void I2CBusExecutor::clear()
+{
+    mEntries.clear();
+}
+
+size_t I2CBusExecutor::getBusesCount() const
+{
+    std::vector<const I2CBus*> buses;
+
+    for (const std::unique_ptr<Entry>& curEntry: mEntries)
+    {
+        if (buses.end() == std::find(buses.begin(), buses.end(), curEntry->bus.get()))
+        {
+            buses.push_back(curEntry->bus.get());
+        }
+    }
+
+    return buses.size();
+}
+
+bool I2CBusExecutor::sample(I2CFrame& outFrame)
+{
+    TRACE_CALL_DEBUG_ARGS("samples=%d", SC2INT(mEntries.size()));
+
+    outFrame.sequence = ++mSequence;
+    outFrame.samples.resize(mEntries.size());
+
+    for (size_t i = 0 ; i < mEntries.size(); ++i)
+    {
+        I2CFrameSample& curSample = outFrame.samples[i];
+        Entry& curEntry = *mEntries[i];
+
+        curSample.success = false;
+        curSample.data.resize(curEntry.rxSize);
+
+        if (curEntry.rxSize > 0)
+        {
+            curEntry.messages[curEntry.transaction.messagesCount - 1].buffer = curSample.data.data();
+        }
+    }
+
+    mCurrentFrame = &outFrame;
+    mPendingCount = mEntries.size();// no transactions are pending yet, so lock is not needed
+    outFrame.startTime = GenericDevice::getMonotonicTime();
+
+    // submission doesn't block, so all adapters start working on their part of the plan right away
+    for (size_t i = 0 ; i < mEntries.size(); ++i)
+    {
+        I2CTransaction& transaction = mEntries[i]->transaction;
+
+        // lambda fits into small buffer of std::function, so callback doesn't allocate memory
+        transaction.onComplete = [this, i](const bool success)
+        {
+            onSampleCompleted(i, success);
+        };
+
+        if (false == mEntries[i]->bus->submit(transaction))
+        {
+            TRACE_ERROR("failed to submit sample %d", SC2INT(i));
+            transaction.onComplete = nullptr;
+            onSampleCompleted(i, false);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mSync);
+
+        mCompleteCondition.wait(lock, [&](){ return 0 == mPendingCount; });
+    }
+
+    outFrame.endTime = GenericDevice::getMonotonicTime();
+    outFrame.isComplete = true;
+    mCurrentFrame = nullptr;
+
+    for (const I2CFrameSample& curSample: outFrame.samples)
+    {
+        if (false == curSample.success)
+        {
+            outFrame.isComplete = false;
+            break;
+        }
+    }
+
+    return outFrame.isComplete;
+}
+
+void I2CBusExecutor::onSampleCompleted(const size_t index, const bool success)
+{
+    // called from bus worker threads. each of them accesses only its own sample
+    I2CFrameSample& curSample = mCurrentFrame->samples[index];
+
+    curSample.timestamp = GenericDevice::getMonotonicTime();
+    curSample.success = success;
+
+    // counter is changed under the lock, so sample() can't return (and executor can't be destroyed)
+    // while worker thread still uses it
+    std::lock_guard<std::mutex> lock(mSync);
+
+    --mPendingCount;
+
+    if (0 == mPendingCount)
+    {
+        mCompleteCondition.notify_one();
+    }
+}
@@ -5,60 +5,119 @@
 #include "i2c/ads1x15.hpp"
 #include <stdio.h>
 
+#define ADS1X15_CONVERSION_TIMEOUT_NS       (100000000LL)// 100ms
+#define ADS1X15_POLL_INTERVAL_NS            (100000ULL)// 100us
+
 bool ADS1X15::initialize(const int adapterNumber, const int address)
 {
+    declareRegisters();
     return openDevice(adapterNumber, address);
 }
 
+bool ADS1X15::initialize(const std::shared_ptr<I2CBus>& bus, const int address, const I2CMuxRoute& route)
+{
+    declareRegisters();
+    return openDevice(bus, route, address);
+}
+
+uint8_t ADS1X15::getChannelsCount() const
+{
+    return 4;
+}
+
 int16_t ADS1X15::readSingleChannel(uint8_t channel)
 {
     int16_t result = 0;
 
+    if ((true == startSingleChannelConversion(channel)) && (true == waitForConversion()))
+    {
+        // Read the conversion results
+        result = getLastConversionResults();
+    }
+
+    return result;
+}
+
+bool ADS1X15::startSingleChannelConversion(uint8_t channel)
+{
+    bool result = false;
+
     if (channel < 4)
     {
-        // Start with default values
-        uint16_t config = ADS1X15_REG_CONFIG_CQUE_NONE |    // Disable the comparator (default val)
-                          ADS1X15_REG_CONFIG_CLAT_NONLAT |  // Non-latching (default val)
-                          ADS1X15_REG_CONFIG_CPOL_ACTVLOW | // Alert/Rdy active low     (default val)
-                          ADS1X15_REG_CONFIG_CMODE_TRAD |   // Traditional comparator (default val)
-                          ADS1X15_REG_CONFIG_MODE_SINGLE;   // Single-shot mode (default)
+        // Write config register to the ADC
+        result = writeRegister(ADS1X15_REG_POINTER_CONFIG, getSingleChannelConfig(channel));
+    }
 
-        // Set PGA/voltage range
-        config |= static_cast<int>(mGain);
+    return result;
+}
 
-        // Set data rate
-        config |= mDataRate;
+#ifdef HWIOCPP_ENABLE_COROUTINES
 
-        // Set single-ended input channel
-        switch (channel) 
+Task<int16_t> ADS1X15::readSingleChannelAsync(AsyncScheduler& scheduler, uint8_t channel)
+{
+    int16_t result = 0;
+
+    if (channel < 4)
+    {
+        const uint16_t config = getSingleChannelConfig(channel);
+        std::vector<byte> configData(3);
+        const std::vector<byte> configReg(1, ADS1X15_REG_POINTER_CONFIG);
+        const std::vector<byte> conversionReg(1, ADS1X15_REG_POINTER_CONVERT);
+
+        configData[0] = ADS1X15_REG_POINTER_CONFIG;
+        configData[1] = static_cast<byte>(config >> 8);
+        configData[2] = static_cast<byte>(config & 0xFF);
+
+        // config register is written bypassing the shadow
+        invalidateRegister(ADS1X15_REG_POINTER_CONFIG);
+
+        I2CAsyncResult res = co_await i2cWrite(scheduler, *this, configData);
+
+        if (true == res.success)
         {
-            case 0:
-                config |= ADS1X15_REG_CONFIG_MUX_SINGLE_0;
-                break;
-            case 1:
-                config |= ADS1X15_REG_CONFIG_MUX_SINGLE_1;
-                break;
-            case 2:
-                config |= ADS1X15_REG_CONFIG_MUX_SINGLE_2;
-                break;
-            case 3:
-                config |= ADS1X15_REG_CONFIG_MUX_SINGLE_3;
-                break;
+            const struct timespec startTime = getMonotonicTime();
+            struct timespec readyTime = addNanoseconds(startTime, getConversionTime() * 1000ULL);
+
+            // conversion can't be completed earlier, so don't poll the bus while it's running
+            co_await sleepUntil(scheduler, readyTime);
+
+            res = co_await i2cTransfer(scheduler, *this, configReg, 2);
+
+            // ADC clock can be slightly slower than nominal. poll config register until OS bit is set
+            while ((true == res.success) && (0 == (res.data[0] & 0x80)) &&
+                   (diffNanoseconds(getMonotonicTime(), startTime) < ADS1X15_CONVERSION_TIMEOUT_NS))
+            {
+                readyTime = addNanoseconds(readyTime, ADS1X15_POLL_INTERVAL_NS);
+                co_await sleepUntil(scheduler, readyTime);
+                res = co_await i2cTransfer(scheduler, *this, configReg, 2);
+            }
+
+            if ((true == res.success) && (0 != (res.data[0] & 0x80)))
+            {
+                res = co_await i2cTransfer(scheduler, *this, conversionReg, 2);
+
+                if (true == res.success)
+                {
+                    result = convertRawResult(loadBE<uint16_t>(res.data.data()));
+                }
+            }
         }
+    }
 
-        // Set 'start single-conversion' bit
-        config |= ADS1X15_REG_CONFIG_OS_SINGLE;
+    co_return result;
+}
 
-        // Write config register to the ADC
-        writeRegister(ADS1X15_REG_POINTER_CONFIG, config);
+#endif // HWIOCPP_ENABLE_COROUTINES
 
-        // TODO: add timeout
-        // Wait for the conversion to complete
-        while (false == conversionComplete())
-        {}
+unsigned int ADS1X15::getConversionTime() const
+{
+    unsigned int result = 0;
+    const unsigned int sps = getSamplesPerSecond(mDataRate);
 
-        // Read the conversion results
-        result = getLastConversionResults();
+    if (sps > 0)
+    {
+        // round up
+        result = (1000000 + sps - 1) / sps;
     }
 
     return result;
@@ -85,15 +144,16 @@ int16_t ADS1X15::readDifferential_0_1()
     // Set 'start single-conversion' bit
     config |= ADS1X15_REG_CONFIG_OS_SINGLE;
 
-    // Write config register to the ADC
-    writeRegister(ADS1X15_REG_POINTER_CONFIG, config);
+    int16_t result = 0;
 
-    // Wait for the conversion to complete
-    while (false == conversionComplete())
-    {}
+    // Write config register to the ADC and wait for the conversion to complete
+    if ((true == writeRegister(ADS1X15_REG_POINTER_CONFIG, config)) && (true == waitForConversion()))
+    {
+        // Read the conversion results
+        result = getLastConversionResults();
+    }
 
-    // Read the conversion results
-    return getLastConversionResults();
+    return result;
 }
 
 int16_t ADS1X15::readDifferential_2_3()
@@ -117,15 +177,16 @@ int16_t ADS1X15::readDifferential_2_3()
     // Set 'start single-conversion' bit
     config |= ADS1X15_REG_CONFIG_OS_SINGLE;
 
-    // Write config register to the ADC
-    writeRegister(ADS1X15_REG_POINTER_CONFIG, config);
+    int16_t result = 0;
 
-    // Wait for the conversion to complete
-    while (false == conversionComplete())
-    {}
+    // Write config register to the ADC and wait for the conversion to complete
+    if ((true == writeRegister(ADS1X15_REG_POINTER_CONFIG, config)) && (true == waitForConversion()))
+    {
+        // Read the conversion results
+        result = getLastConversionResults();
+    }
 
-    // Read the conversion results
-    return getLastConversionResults();
+    return result;
 }
 
 void ADS1X15::startComparator_SingleEnded(uint8_t channel, int16_t threshold)
@@ -174,21 +235,12 @@ void ADS1X15::startComparator_SingleEnded(uint8_t channel, int16_t threshold)
 
 int16_t ADS1X15::getLastConversionResults()
 {
-    // Read the conversion results
-    uint16_t res = readRegister(ADS1X15_REG_POINTER_CONVERT) >> mBitShift;
+    uint32_t res = 0;
 
-    if (0 != mBitShift)
-    {
-        // Shift 12-bit results right 4 bits for the ADS1015,
-        // making sure we keep the sign bit intact
-        if (res > 0x07FF)
-        {
-            // negative number - extend the sign to 16th bit
-            res |= 0xF000;
-        }
-    }
+    // Read the conversion results
+    readRegister(ADS1X15_REG_POINTER_CONVERT, res);
 
-    return static_cast<int16_t>(res);
+    return convertRawResult(static_cast<uint16_t>(res));
 }
 
 float ADS1X15::computeVolts(int16_t counts)
@@ -223,21 +275,96 @@ float ADS1X15::computeVolts(int16_t counts)
     return counts * (fsRange / (32768 >> mBitShift));
 }
 
+unsigned int ADS1X15::getSamplesPerSecond(const uint16_t) const
+{
+    return 0;
+}
+
+uint16_t ADS1X15::getSingleChannelConfig(const uint8_t channel) const
+{
+    // Start with default values
+    uint16_t config = ADS1X15_REG_CONFIG_CQUE_NONE |    // Disable the comparator (default val)
+                      ADS1X15_REG_CONFIG_CLAT_NONLAT |  // Non-latching (default val)
+                      ADS1X15_REG_CONFIG_CPOL_ACTVLOW | // Alert/Rdy active low     (default val)
+                      ADS1X15_REG_CONFIG_CMODE_TRAD |   // Traditional comparator (default val)
+                      ADS1X15_REG_CONFIG_MODE_SINGLE;   // Single-shot mode (default)
+
+    // Set PGA/voltage range
+    config |= static_cast<int>(mGain);
+
+    // Set data rate
+    config |= mDataRate;
+
+    // Set single-ended input channel
+    switch (channel)
+    {
+        case 0:
+            config |= ADS1X15_REG_CONFIG_MUX_SINGLE_0;
+            break;
+        case 1:
+            config |= ADS1X15_REG_CONFIG_MUX_SINGLE_1;
+            break;
+        case 2:
+            config |= ADS1X15_REG_CONFIG_MUX_SINGLE_2;
+            break;
+        case 3:
+            config |= ADS1X15_REG_CONFIG_MUX_SINGLE_3;
+            break;
+    }
+
+    // Set 'start single-conversion' bit
+    config |= ADS1X15_REG_CONFIG_OS_SINGLE;
+
+    return config;
+}
+
+int16_t ADS1X15::convertRawResult(const uint16_t rawValue) const
+{
+    uint16_t res = rawValue >> mBitShift;
+
+    if (0 != mBitShift)
+    {
+        // Shift 12-bit results right 4 bits for the ADS1015,
+        // making sure we keep the sign bit intact
+        if (res > 0x07FF)
+        {
+            // negative number - extend the sign to 16th bit
+            res |= 0xF000;
+        }
+    }
+
+    return static_cast<int16_t>(res);
+}
+
 bool ADS1X15::conversionComplete()
 {
-    return (readRegister(ADS1X15_REG_POINTER_CONFIG) & 0x8000) != 0;
+    uint32_t config = 0;
+
+    return (true == readRegister(ADS1X15_REG_POINTER_CONFIG, config)) && (0 != (config & ADS1X15_REG_CONFIG_OS_MASK));
 }
 
-void ADS1X15::writeRegister(uint8_t reg, uint16_t value)
+bool ADS1X15::waitForConversion()
 {
-    // mBuffer[0] = reg;
-    // mBuffer[1] = value >> 8;// HIGH
-    // mBuffer[2] = value & 0xFF;// LOW
-    // writeBuffer(mBuffer, 3);
-    writeData(reg, value, Endianness::BIG);
+    const struct timespec startTime = getMonotonicTime();
+    uint32_t config = 0;
+    bool isReadOk = readRegister(ADS1X15_REG_POINTER_CONFIG, config);
+
+    // read error is not retried (device is not responding)
+    while ((true == isReadOk) && (0 == (config & ADS1X15_REG_CONFIG_OS_MASK)) &&
+           (diffNanoseconds(getMonotonicTime(), startTime) < ADS1X15_CONVERSION_TIMEOUT_NS))
+    {
+        isReadOk = readRegister(ADS1X15_REG_POINTER_CONFIG, config);
+    }
+
+    return (true == isReadOk) && (0 != (config & ADS1X15_REG_CONFIG_OS_MASK));
 }
 
-uint16_t ADS1X15::readRegister(uint8_t reg)
+void ADS1X15::declareRegisters()
 {
-    return readWord(reg, Endianness::BIG);
-}
\ No newline at end of file
+    // conversion result and OS (conversion status) bit are updated by ADC. Other registers change only when they are written,
+    // so shadow skips repeated threshold and comparator configuration writes
+    declareRegister(ADS1X15_REG_POINTER_CONVERT, sizeof(uint16_t), I2C_REGISTER_VOLATILE, Endianness::BIG);
+    declareRegister(ADS1X15_REG_POINTER_CONFIG, sizeof(uint16_t), ADS1X15_REG_CONFIG_OS_MASK, Endianness::BIG);
+    declareRegister(ADS1X15_REG_POINTER_LOWTHRESH, sizeof(uint16_t), I2C_REGISTER_NON_VOLATILE, Endianness::BIG);
+    declareRegister(ADS1X15_REG_POINTER_HITHRESH, sizeof(uint16_t), I2C_REGISTER_NON_VOLATILE, Endianness::BIG);
+}
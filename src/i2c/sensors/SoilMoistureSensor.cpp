@@ -6,8 +6,15 @@
 #include "i2c/ads1x15.hpp"
 
 SoilMoistureSensor::SoilMoistureSensor(ADS1X15* ads, const int adsChannel)
-    : mADS(ads)
-    , mAdsChannel(adsChannel)
+    : SoilMoistureSensor(static_cast<AnalogInputDevice*>(ads), adsChannel)
+{
+    mADS = ads;
+}
+
+SoilMoistureSensor::SoilMoistureSensor(AnalogInputDevice* adc, const int adcChannel)
+    : mADS(nullptr)
+    , mADC(adc)
+    , mAdsChannel(adcChannel)
     , mLastSensorValue(0)
     , mDryValue(22000)
     , mWaterValue(7963)
@@ -51,6 +58,10 @@ void SoilMoistureSensor::readSensorValue()
         mADS->setGain(adsGain_t::GAIN_ONE);
         // mADS->setGain(adsGain_t::GAIN_TWO);
         // mADS->setDataRate(RATE_ADS1115_8SPS);
-        mLastSensorValue = mADS->readSingleChannel(mAdsChannel);
+    }
+
+    if (nullptr != mADC)
+    {
+        mLastSensorValue = mADC->readSingleChannel(mAdsChannel);
     }
 }
\ No newline at end of file
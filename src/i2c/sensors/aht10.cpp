@@ -3,7 +3,12 @@
  * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
  */
 #include "i2c/sensors/aht10.hpp"
+#include <utils/logging.hpp>
 #include <cstdio>
+#include <array>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "AHT10"
 
 #define AHT10_ADDRESS                   0x38
 
@@ -37,15 +42,27 @@ AHT10::~AHT10()
 }
 
 bool AHT10::initialize(const int adapterNumber)
+{
+    return (true == openDevice(adapterNumber, AHT10_ADDRESS)) && (true == configure());
+}
+
+bool AHT10::initialize(const std::shared_ptr<I2CBus>& bus, const I2CMuxRoute& route)
+{
+    return (true == openDevice(bus, route, AHT10_ADDRESS)) && (true == configure());
+}
+
+bool AHT10::configure()
 {
     bool result = false;
 
-    if (true == openDevice(adapterNumber, AHT10_ADDRESS))
+    if (true == isDeviceOpen())
     {
-        const byte mode = AHT10_MODE_DEF_CALIBRATION | AHT10_MODE_CYCLE;
+        const std::array<byte, 2> initParams = {AHT10_MODE_DEF_CALIBRATION | AHT10_MODE_CYCLE, 0x00};
+
+        const struct timespec cmdTime = getMonotonicTime();
 
-        writeBuffer(AHT10_CMD_INIT, {mode, 0x00});
-        wait(AHT10_DELAY_POWER_ON);// Try mult by 2 if not always initialized
+        writeBytes(AHT10_CMD_INIT, initParams);
+        waitUntil(addNanoseconds(cmdTime, AHT10_DELAY_POWER_ON * 1000000ULL));// Try mult by 2 if not always initialized
 
         const byte status = readByte();
 
@@ -76,16 +93,22 @@ bool AHT10::initialize(const int adapterNumber)
 SensorDataAHT10 AHT10::getSensorData()
 {
     SensorDataAHT10 result;
+    const std::array<byte, 3> triggerCmd = {AHT10_CMD_TRIGGER_MEASUREMENT, AHT10_DATA_MEASURMENT_CMD, 0x00};
+
+    // measurement time is counted from the moment command was sent
+    struct timespec readyTime = getMonotonicTime();
 
-    if (true == writeBuffer({AHT10_CMD_TRIGGER_MEASUREMENT, AHT10_DATA_MEASURMENT_CMD, 0x00}))
+    if (I2CError::OK == writeBytes(triggerCmd))
     {
         int attempt = 0;
 
-        wait(AHT10_DELAY_MEASURMENT);
+        readyTime = addNanoseconds(readyTime, AHT10_DELAY_MEASURMENT * 1000000ULL);
+        waitUntil(readyTime);
 
         while ((attempt < MAX_READ_ATTEMPS) && (true == isBusy()))
         {
-            wait(AHT10_DELAY_MEASURMENT_RETRY);
+            readyTime = addNanoseconds(readyTime, AHT10_DELAY_MEASURMENT_RETRY * 1000000ULL);
+            waitUntil(readyTime);
             ++attempt;
         }
 
@@ -93,20 +116,14 @@ SensorDataAHT10 AHT10::getSensorData()
         {
             byte blockData[6] = {0};
 
-            if (sizeof(blockData) == readBuffer(blockData, sizeof(blockData)))
+            if (I2CError::OK == readBytes(blockData))
             {
                 for (int j = 0; j < sizeof(blockData); ++j)
                 {
                     printf("0x%X ", blockData[j]);
                 }
                 printf("\n");
-                unsigned int temp;
-                
-                temp = ((blockData[3] & 0x0F) << 16) | (blockData[4] << 8) | blockData[5];
-                result.temperature = ((temp * 200) / 1048576) - 50;
-
-                temp = ((blockData[1] << 16) | (blockData[2] << 8) | blockData[3]) >> 4;
-                result.humidity = temp * 100 / 1048576;
+                decodeSensorData(blockData, result);
             }
         }
         else
@@ -118,11 +135,75 @@ SensorDataAHT10 AHT10::getSensorData()
     return result;
 }
 
+#ifdef HWIOCPP_ENABLE_COROUTINES
+
+Task<SensorDataAHT10> AHT10::getSensorDataAsync(AsyncScheduler& scheduler)
+{
+    SensorDataAHT10 result;
+    std::vector<byte> triggerCmd(3, 0x00);
+    const std::vector<byte> noData;
+    struct timespec readyTime = getMonotonicTime();
+
+    // NOTE: braced init lists are not used inside of co_await expressions because of GCC 12 bug
+    triggerCmd[0] = AHT10_CMD_TRIGGER_MEASUREMENT;
+    triggerCmd[1] = AHT10_DATA_MEASURMENT_CMD;
+
+    I2CAsyncResult res = co_await i2cWrite(scheduler, *this, triggerCmd);
+
+    if (true == res.success)
+    {
+        int attempt = 0;
+
+        readyTime = addNanoseconds(readyTime, AHT10_DELAY_MEASURMENT * 1000000ULL);
+        co_await sleepUntil(scheduler, readyTime);
+
+        // status byte is the first byte of the data block
+        res = co_await i2cTransfer(scheduler, *this, noData, 6);
+
+        while ((true == res.success) && (0 != (res.data[0] & AHT10_STATUS_BIT_BUSY)) && (attempt < MAX_READ_ATTEMPS))
+        {
+            readyTime = addNanoseconds(readyTime, AHT10_DELAY_MEASURMENT_RETRY * 1000000ULL);
+            co_await sleepUntil(scheduler, readyTime);
+            res = co_await i2cTransfer(scheduler, *this, noData, 6);
+            ++attempt;
+        }
+
+        if ((true == res.success) && (0 == (res.data[0] & AHT10_STATUS_BIT_BUSY)))
+        {
+            decodeSensorData(res.data.data(), result);
+        }
+        else if (true == res.success)
+        {
+            TRACE_ERROR("failed to read data. sensor is busy");
+        }
+        else
+        {
+            TRACE_ERROR("failed to read data");
+        }
+    }
+
+    co_return result;
+}
+
+#endif // HWIOCPP_ENABLE_COROUTINES
+
 bool AHT10::isBusy()
 {
-    byte status = readByte();
+    byte status = 0;
+
+    // failed read is treated as busy sensor
+    return (I2CError::OK != readBytes(ByteView(&status, sizeof(status)))) || ((status & AHT10_STATUS_BIT_BUSY) != 0);
+}
+
+void AHT10::decodeSensorData(const byte* blockData, SensorDataAHT10& outData)
+{
+    unsigned int temp;
+
+    temp = ((blockData[3] & 0x0F) << 16) | (blockData[4] << 8) | blockData[5];
+    outData.temperature = ((temp * 200) / 1048576) - 50;
 
-    return (status & AHT10_STATUS_BIT_BUSY) != 0;
+    temp = ((blockData[1] << 16) | (blockData[2] << 8) | blockData[3]) >> 4;
+    outData.humidity = temp * 100 / 1048576;
 }
 
 
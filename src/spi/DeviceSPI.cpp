@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "spi/DeviceSPI.hpp"
+#include <utils/logging.hpp>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "DeviceSPI"
+
+// temporary buffers up to this size are allocated on stack
+#define SPI_LOCAL_BUFFER_SIZE               (64)
+#define SPIDEV_BUFSIZ_PARAM                 "/sys/module/spidev/parameters/bufsiz"
+
+DeviceSPI::~DeviceSPI()
+{
+    closeDevice();
+}
+
+bool DeviceSPI::openDevice(const int bus, const int chipSelect, const SpiMode mode, const uint32_t speedHz, const SpiChipSelect csMode)
+{
+    TRACE_CALL_DEBUG_ARGS("bus=%d, chipSelect=%d, mode=%d, speedHz=%u", bus, chipSelect, SC2INT(mode), speedHz);
+    bool result = false;
+    char devPath[32] = {0};
+
+    closeDevice();
+    snprintf(devPath, sizeof(devPath) - 1, "/dev/spidev%d.%d", bus, chipSelect);
+    mFD = open(devPath, O_RDWR | O_CLOEXEC);
+
+    if (mFD >= 0)
+    {
+        mMode = mode;
+        mCsMode = csMode;
+        mBitOrder = SpiBitOrder::MSB_FIRST;
+        mModeFlags = 0xFF;// force update
+
+        result = (true == applyModeFlags()) &&
+                 (0 == ioctl(mFD, SPI_IOC_WR_BITS_PER_WORD, &mBitsPerWord)) &&
+                 (0 == ioctl(mFD, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz));
+
+        if (true == result)
+        {
+            FILE* paramFile = fopen(SPIDEV_BUFSIZ_PARAM, "r");
+
+            mSpeed = speedHz;
+
+            if (nullptr != paramFile)
+            {
+                unsigned long bufsiz = 0;
+
+                if ((1 == fscanf(paramFile, "%lu", &bufsiz)) && (bufsiz > 0))
+                {
+                    mMaxMessageSize = bufsiz;
+                }
+
+                fclose(paramFile);
+            }
+        }
+        else
+        {
+            TRACE_ERROR("failed to configure %s", devPath);
+        }
+    }
+    else
+    {
+        TRACE_ERROR("failed to open %s", devPath);
+        mFD = INVALID_FD;
+    }
+
+    if ((false == result) && (INVALID_FD != mFD))
+    {
+        close(mFD);
+        mFD = INVALID_FD;
+    }
+
+    return result;
+}
+
+void DeviceSPI::closeDevice()
+{
+    if (true == isDeviceOpen())
+    {
+        close(mFD);
+        mFD = INVALID_FD;
+    }
+}
+
+bool DeviceSPI::setMode(const SpiMode mode)
+{
+    mMode = mode;
+    return applyModeFlags();
+}
+
+bool DeviceSPI::setBitOrder(const SpiBitOrder bitOrder)
+{
+    mBitOrder = bitOrder;
+    return applyModeFlags();
+}
+
+bool DeviceSPI::setChipSelectMode(const SpiChipSelect csMode)
+{
+    mCsMode = csMode;
+    return applyModeFlags();
+}
+
+bool DeviceSPI::setSpeed(const uint32_t speedHz)
+{
+    bool result = false;
+
+    if (true == isDeviceOpen())
+    {
+        result = (speedHz == mSpeed) || (0 == ioctl(mFD, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz));
+
+        if (true == result)
+        {
+            mSpeed = speedHz;
+        }
+    }
+
+    return result;
+}
+
+bool DeviceSPI::setBitsPerWord(const uint8_t bits)
+{
+    bool result = false;
+
+    if (true == isDeviceOpen())
+    {
+        result = (bits == mBitsPerWord) || (0 == ioctl(mFD, SPI_IOC_WR_BITS_PER_WORD, &bits));
+
+        if (true == result)
+        {
+            mBitsPerWord = bits;
+        }
+    }
+
+    return result;
+}
+
+bool DeviceSPI::transfer(const SpiTransfer* segments, const size_t segmentsCount)
+{
+    bool result = false;
+
+    if ((true == isDeviceOpen()) && (nullptr != segments) && (segmentsCount > 0))
+    {
+        size_t totalSize = 0;
+
+        // NOTE: resize doesn't allocate after the first few calls
+        mMessage.resize(segmentsCount);
+        memset(mMessage.data(), 0, sizeof(struct spi_ioc_transfer) * segmentsCount);
+
+        for (size_t i = 0 ; i < segmentsCount; ++i)
+        {
+            struct spi_ioc_transfer& curIoc = mMessage[i];
+
+            curIoc.tx_buf = reinterpret_cast<uintptr_t>(segments[i].txBuffer);
+            curIoc.rx_buf = reinterpret_cast<uintptr_t>(segments[i].rxBuffer);
+            curIoc.len = segments[i].size;
+            curIoc.speed_hz = (segments[i].speedHz > 0 ? segments[i].speedHz : mSpeed);
+            curIoc.delay_usecs = segments[i].delayUs;
+            curIoc.bits_per_word = (segments[i].bitsPerWord > 0 ? segments[i].bitsPerWord : mBitsPerWord);
+            // for the last segment cs_change means "keep selected after message", which is not what we want
+            curIoc.cs_change = ((true == segments[i].deselectAfter) && (i + 1 < segmentsCount) ? 1 : 0);
+            totalSize += segments[i].size;
+        }
+
+        if ((totalSize <= mMaxMessageSize) && (0 != SPI_MSGSIZE(segmentsCount)))
+        {
+            result = (ioctl(mFD, SPI_IOC_MESSAGE(segmentsCount), mMessage.data()) >= 0);
+
+            if (false == result)
+            {
+                TRACE_ERROR("SPI_IOC_MESSAGE failed (segments=%lu, size=%lu): %s", segmentsCount, totalSize, strerror(errno));
+            }
+        }
+        else
+        {
+            TRACE_ERROR("message is too big (segments=%lu, size=%lu, max=%lu)", segmentsCount, totalSize, mMaxMessageSize);
+        }
+    }
+
+    return result;
+}
+
+bool DeviceSPI::transfer(const std::vector<SpiTransfer>& segments)
+{
+    return transfer(segments.data(), segments.size());
+}
+
+bool DeviceSPI::transfer(const byte* txBuffer, byte* rxBuffer, const size_t bytesCount)
+{
+    SpiTransfer segment;
+
+    segment.txBuffer = txBuffer;
+    segment.rxBuffer = rxBuffer;
+    segment.size = bytesCount;
+
+    return transfer(&segment, 1);
+}
+
+int DeviceSPI::readBuffer(byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder)
+{
+    int actualBytes = 0;
+
+    if (true == transfer(nullptr, outBuffer, bytesCount))
+    {
+        normalizeBytes(outBuffer, bytesCount, bytesOrder);
+        actualBytes = bytesCount;
+    }
+
+    return actualBytes;
+}
+
+bool DeviceSPI::writeBuffer(const byte* buffer, const size_t bytesCount, const Endianness bytesOrder)
+{
+    ScratchBuffer<SPI_LOCAL_BUFFER_SIZE> scratch;
+
+    return transfer(normalizeBytes(buffer, bytesCount, bytesOrder, scratch), nullptr, bytesCount);
+}
+
+bool DeviceSPI::writeBuffer(const std::vector<byte>& buffer, const Endianness bytesOrder)
+{
+    return writeBuffer(buffer.data(), buffer.size(), bytesOrder);
+}
+
+bool DeviceSPI::writeData(const uint8_t data)
+{
+    return writeBuffer(reinterpret_cast<const byte*>(&data), sizeof(data), Endianness::NATIVE);
+}
+
+bool DeviceSPI::writeData(const uint16_t data, const Endianness bytesOrder)
+{
+    return writeBuffer(reinterpret_cast<const byte*>(&data), sizeof(data), bytesOrder);
+}
+
+bool DeviceSPI::writeData(const uint32_t data, const Endianness bytesOrder)
+{
+    return writeBuffer(reinterpret_cast<const byte*>(&data), sizeof(data), bytesOrder);
+}
+
+int DeviceSPI::writeThenRead(const byte* cmd, const size_t cmdSize, byte* outBuffer, const size_t bytesCount, const Endianness bytesOrder)
+{
+    int actualBytes = 0;
+    SpiTransfer segments[2];
+
+    segments[0].txBuffer = cmd;
+    segments[0].size = cmdSize;
+    segments[1].rxBuffer = outBuffer;
+    segments[1].size = bytesCount;
+
+    if (true == transfer(segments, 2))
+    {
+        normalizeBytes(outBuffer, bytesCount, bytesOrder);
+        actualBytes = bytesCount;
+    }
+
+    return actualBytes;
+}
+
+bool DeviceSPI::applyModeFlags()
+{
+    bool result = false;
+
+    if (true == isDeviceOpen())
+    {
+        uint8_t flags = 0;
+
+        switch (mMode)
+        {
+            case SpiMode::MODE_1:
+                flags = SPI_MODE_1;
+                break;
+            case SpiMode::MODE_2:
+                flags = SPI_MODE_2;
+                break;
+            case SpiMode::MODE_3:
+                flags = SPI_MODE_3;
+                break;
+            case SpiMode::MODE_0:
+            default:
+                flags = SPI_MODE_0;
+                break;
+        }
+
+        if (SpiBitOrder::LSB_FIRST == mBitOrder)
+        {
+            flags |= SPI_LSB_FIRST;
+        }
+
+        if (SpiChipSelect::ACTIVE_HIGH == mCsMode)
+        {
+            flags |= SPI_CS_HIGH;
+        }
+        else if (SpiChipSelect::NONE == mCsMode)
+        {
+            flags |= SPI_NO_CS;
+        }
+
+        result = (flags == mModeFlags) || (0 == ioctl(mFD, SPI_IOC_WR_MODE, &flags));
+
+        if (true == result)
+        {
+            mModeFlags = flags;
+        }
+        else
+        {
+            TRACE_ERROR("failed to set SPI mode 0x%X", SC2INT(flags));
+        }
+    }
+
+    return result;
+}
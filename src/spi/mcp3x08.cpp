@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "spi/mcp3x08.hpp"
+#include "utils/ThreadPolicy.hpp"
+#include <utils/logging.hpp>
+#include <algorithm>
+#include <cstring>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "MCP3X08"
+
+#define MCP3X08_TRANSFER_SIZE               (3)
+#define MCP3X08_START_BIT                   (0x10)
+#define MCP3X08_SINGLE_ENDED_BIT            (0x08)
+#define MCP3X08_DIFFERENTIAL_FLAG           (0x80)
+
+static void updateMax(std::atomic<uint64_t>& maxValue, const uint64_t value)
+{
+    uint64_t current = maxValue.load(std::memory_order_relaxed);
+
+    while ((value > current) && (false == maxValue.compare_exchange_weak(current, value, std::memory_order_relaxed)))
+    {}
+}
+
+MCP3X08::~MCP3X08()
+{
+    stopAcquisition();
+}
+
+bool MCP3X08::initialize(const int bus, const int chipSelect, const uint32_t speedHz)
+{
+    TRACE_CALL_DEBUG_ARGS("bus=%d, chipSelect=%d, speedHz=%u", bus, chipSelect, speedHz);
+
+    return openDevice(bus, chipSelect, SpiMode::MODE_0, speedHz);
+}
+
+uint8_t MCP3X08::getChannelsCount() const
+{
+    return mChannelsCount;
+}
+
+int16_t MCP3X08::readSingleChannel(uint8_t channel)
+{
+    int16_t value = 0;
+
+    readChannels(&channel, 1, &value);
+    return value;
+}
+
+float MCP3X08::computeVolts(int16_t counts)
+{
+    return counts * (mReferenceVoltage / (1 << mResolution));
+}
+
+int16_t MCP3X08::readDifferential(const uint8_t pair)
+{
+    const uint8_t channel = MCP3X08_DIFFERENTIAL(pair);
+    int16_t value = 0;
+
+    readChannels(&channel, 1, &value);
+    return value;
+}
+
+bool MCP3X08::readChannels(const uint8_t* channels, const size_t channelsCount, int16_t* outValues)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    return readChannelsLocked(channels, channelsCount, outValues);
+}
+
+bool MCP3X08::startAcquisition(const std::vector<uint8_t>& channels, const unsigned int sampleRateHz, const size_t bufferFrames)
+{
+    TRACE_CALL_DEBUG_ARGS("channels=%lu, sampleRateHz=%u, bufferFrames=%lu", channels.size(), sampleRateHz, bufferFrames);
+    bool result = false;
+
+    if ((false == mIsAcquiring) && (true == isDeviceOpen()) && (false == channels.empty()) && (sampleRateHz > 0) && (bufferFrames > 0))
+    {
+        if (true == mAcquisitionThread.joinable())
+        {
+            mAcquisitionThread.join();
+        }
+
+        mAcquisitionChannels = channels;
+        mAcquisitionPeriod = 1000000000ULL / sampleRateHz;
+        mRingCapacity = bufferFrames;
+        mRingValues.assign(bufferFrames * channels.size(), 0);
+        mRingTimestamps.assign(bufferFrames, {0, 0});
+        mRingHead = 0;
+        mRingTail = 0;
+
+        mFramesAcquired = 0;
+        mFramesDropped = 0;
+        mMissedDeadlines = 0;
+        mMaxStartLatency = 0;
+        mMaxFrameDuration = 0;
+        mTransferErrors = 0;
+
+        mIsAcquiring = true;
+        mAcquisitionThread = std::thread(&MCP3X08::threadAcquisition, this);
+        result = true;
+    }
+
+    return result;
+}
+
+void MCP3X08::stopAcquisition()
+{
+    mIsAcquiring = false;
+
+    if (true == mAcquisitionThread.joinable())
+    {
+        mAcquisitionThread.join();
+    }
+}
+
+size_t MCP3X08::readFrames(int16_t* outValues, struct timespec* outTimestamps, const size_t maxFrames)
+{
+    size_t framesCount = 0;
+
+    if ((nullptr != outValues) && (mRingCapacity > 0))
+    {
+        const size_t frameSize = mAcquisitionChannels.size();
+        const size_t tail = mRingTail.load(std::memory_order_relaxed);
+        const size_t head = mRingHead.load(std::memory_order_acquire);
+
+        framesCount = std::min(head - tail, maxFrames);
+
+        for (size_t i = 0 ; i < framesCount; ++i)
+        {
+            const size_t index = (tail + i) % mRingCapacity;
+
+            memcpy(outValues + i * frameSize, mRingValues.data() + index * frameSize, frameSize * sizeof(int16_t));
+
+            if (nullptr != outTimestamps)
+            {
+                outTimestamps[i] = mRingTimestamps[index];
+            }
+        }
+
+        mRingTail.store(tail + framesCount, std::memory_order_release);
+    }
+
+    return framesCount;
+}
+
+size_t MCP3X08::getAvailableFrames() const
+{
+    return mRingHead.load(std::memory_order_acquire) - mRingTail.load(std::memory_order_acquire);
+}
+
+AdcAcquisitionStats MCP3X08::getAcquisitionStats() const
+{
+    AdcAcquisitionStats stats;
+
+    stats.framesAcquired = mFramesAcquired.load(std::memory_order_relaxed);
+    stats.framesDropped = mFramesDropped.load(std::memory_order_relaxed);
+    stats.missedDeadlines = mMissedDeadlines.load(std::memory_order_relaxed);
+    stats.maxStartLatency = mMaxStartLatency.load(std::memory_order_relaxed);
+    stats.maxFrameDuration = mMaxFrameDuration.load(std::memory_order_relaxed);
+    stats.transferErrors = mTransferErrors.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+bool MCP3X08::readChannelsLocked(const uint8_t* channels, const size_t channelsCount, int16_t* outValues)
+{
+    bool result = false;
+
+    if ((nullptr != channels) && (nullptr != outValues) && (channelsCount > 0) && (mResolution > 0))
+    {
+        const size_t bufferSize = channelsCount * MCP3X08_TRANSFER_SIZE;
+        const uint32_t valueMask = (1u << mResolution) - 1;
+
+        if (mTxBuffer.size() < bufferSize)
+        {
+            mTxBuffer.resize(bufferSize);
+            mRxBuffer.resize(bufferSize);
+        }
+
+        if (mSegments.size() < channelsCount)
+        {
+            mSegments.resize(channelsCount);
+        }
+
+        result = true;
+
+        for (size_t i = 0 ; i < channelsCount; ++i)
+        {
+            const bool isDifferential = (0 != (channels[i] & MCP3X08_DIFFERENTIAL_FLAG));
+            const uint8_t input = (channels[i] & 0x07);
+            byte* tx = mTxBuffer.data() + i * MCP3X08_TRANSFER_SIZE;
+
+            if (input >= mChannelsCount)
+            {
+                TRACE_ERROR("invalid channel 0x%X", SC2INT(channels[i]));
+                result = false;
+                break;
+            }
+
+            // command: start, SGL/DIFF, D2, D1, D0. it's aligned so that the last bit of the result is the last bit of the transfer:
+            //   [leading zeros][5 bits command][sampling clock][null bit][N bits of result]
+            // (for MCP3008: 0x01, (SGL | channel) << 4, 0x00)
+            const uint32_t command = (MCP3X08_START_BIT | (true == isDifferential ? 0 : MCP3X08_SINGLE_ENDED_BIT) | input) << (mResolution + 2);
+
+            tx[0] = GET_BYTE2(command);
+            tx[1] = GET_BYTE1(command);
+            tx[2] = GET_BYTE0(command);
+
+            mSegments[i].txBuffer = tx;
+            mSegments[i].rxBuffer = mRxBuffer.data() + i * MCP3X08_TRANSFER_SIZE;
+            mSegments[i].size = MCP3X08_TRANSFER_SIZE;
+            // every conversion is started by falling edge of chip select
+            mSegments[i].deselectAfter = true;
+        }
+
+        if (true == result)
+        {
+            result = transfer(mSegments.data(), channelsCount);
+        }
+
+        if (true == result)
+        {
+            for (size_t i = 0 ; i < channelsCount; ++i)
+            {
+                const byte* rx = mRxBuffer.data() + i * MCP3X08_TRANSFER_SIZE;
+
+                outValues[i] = static_cast<int16_t>(((rx[0] << 16) | (rx[1] << 8) | rx[2]) & valueMask);
+            }
+        }
+    }
+
+    return result;
+}
+
+void MCP3X08::threadAcquisition()
+{
+    TRACE_CALL();
+    ThreadPolicyManager::onThreadStarted(HwioThread::ADC_ACQUISITION);
+
+    const size_t frameSize = mAcquisitionChannels.size();
+    struct timespec deadline = getMonotonicTime();
+
+    while (true == mIsAcquiring)
+    {
+        waitUntil(deadline);
+
+        const struct timespec frameStart = getMonotonicTime();
+        const int64_t latency = diffNanoseconds(frameStart, deadline);
+
+        if (latency > 0)
+        {
+            updateMax(mMaxStartLatency, latency);
+
+            // skip frames which can't be acquired in time anymore
+            if (static_cast<uint64_t>(latency) > mAcquisitionPeriod)
+            {
+                const uint64_t missedFrames = latency / mAcquisitionPeriod;
+
+                mMissedDeadlines.fetch_add(missedFrames, std::memory_order_relaxed);
+                deadline = addNanoseconds(deadline, missedFrames * mAcquisitionPeriod);
+            }
+        }
+
+        const size_t head = mRingHead.load(std::memory_order_relaxed);
+        const size_t tail = mRingTail.load(std::memory_order_acquire);
+
+        if ((head - tail) < mRingCapacity)
+        {
+            const size_t index = head % mRingCapacity;
+
+            if (true == readChannels(mAcquisitionChannels.data(), frameSize, mRingValues.data() + index * frameSize))
+            {
+                mRingTimestamps[index] = frameStart;
+                mRingHead.store(head + 1, std::memory_order_release);
+                mFramesAcquired.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                mTransferErrors.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            mFramesDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        updateMax(mMaxFrameDuration, diffNanoseconds(getMonotonicTime(), frameStart));
+        deadline = addNanoseconds(deadline, mAcquisitionPeriod);
+    }
+
+    ThreadPolicyManager::onThreadFinished(HwioThread::ADC_ACQUISITION);
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "spi/ws2812.hpp"
+#include <utils/logging.hpp>
+#include <algorithm>
+#include <cstring>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "WS2812"
+
+#define SYMBOL_BYTES_PER_COLOR              (3)
+#define SYMBOL_BIT_ONE                      (0x6)// 110
+#define SYMBOL_BIT_ZERO                     (0x4)// 100
+// each SPI byte takes 8 bits / 2.4 MHz = 3.33 us
+#define RESET_BYTES                         ((WS2812_RESET_US * (WS2812_SPI_SPEED_HZ / 1000) / 1000 + 7) / 8)
+
+// maps every possible color byte to 3 bytes of SPI symbols
+struct SymbolsTable
+{
+    byte symbols[256][SYMBOL_BYTES_PER_COLOR];
+
+    SymbolsTable()
+    {
+        for (int value = 0 ; value < 256; ++value)
+        {
+            uint32_t encoded = 0;
+
+            for (int bit = 7 ; bit >= 0; --bit)
+            {
+                encoded = (encoded << 3) | ((value & (1 << bit)) ? SYMBOL_BIT_ONE : SYMBOL_BIT_ZERO);
+            }
+
+            symbols[value][0] = GET_BYTE2(encoded);
+            symbols[value][1] = GET_BYTE1(encoded);
+            symbols[value][2] = GET_BYTE0(encoded);
+        }
+    }
+};
+
+static const SymbolsTable sSymbolsTable;
+
+bool WS2812::initialize(const int bus, const int chipSelect, const size_t ledsCount, const LedStripType type)
+{
+    TRACE_CALL_DEBUG_ARGS("bus=%d, chipSelect=%d, ledsCount=%lu, type=%d", bus, chipSelect, ledsCount, SC2INT(type));
+    bool result = false;
+
+    if ((ledsCount > 0) && (true == openDevice(bus, chipSelect, SpiMode::MODE_0, WS2812_SPI_SPEED_HZ, SpiChipSelect::NONE)))
+    {
+        mType = type;
+        mChannelsCount = (LedStripType::SK6812_RGBW == type ? 4 : 3);
+        mPixels.assign(ledsCount, 0);
+        mDirtyMask.assign((ledsCount + 63) / 64, 0);
+        // zeros at the end of the buffer are reset (latch) period
+        mSymbols.assign(ledsCount * mChannelsCount * SYMBOL_BYTES_PER_COLOR + RESET_BYTES, 0);
+        setBrightness(mBrightness);
+
+        if (mSymbols.size() > getMaxMessageSize())
+        {
+            TRACE_ERROR("strip doesn't fit into a single SPI message (%lu > %lu). increase spidev.bufsiz", mSymbols.size(), getMaxMessageSize());
+        }
+
+        result = true;
+    }
+
+    return result;
+}
+
+void WS2812::setPixel(const size_t index, const uint32_t color)
+{
+    if ((index < mPixels.size()) && (mPixels[index] != color))
+    {
+        mPixels[index] = color;
+        markDirty(index);
+    }
+}
+
+void WS2812::setPixel(const size_t index, const uint8_t red, const uint8_t green, const uint8_t blue, const uint8_t white)
+{
+    setPixel(index, WS2812_COLOR_W(red, green, blue, white));
+}
+
+uint32_t WS2812::getPixel(const size_t index) const
+{
+    return (index < mPixels.size() ? mPixels[index] : 0);
+}
+
+void WS2812::fill(const uint32_t color)
+{
+    for (size_t i = 0 ; i < mPixels.size(); ++i)
+    {
+        setPixel(i, color);
+    }
+}
+
+void WS2812::clear()
+{
+    fill(0);
+}
+
+void WS2812::setBrightness(const uint8_t brightness)
+{
+    for (int i = 0 ; i < 256; ++i)
+    {
+        mBrightnessTable[i] = static_cast<uint8_t>((i * (brightness + 1)) >> 8);
+    }
+
+    mBrightness = brightness;
+    markAllDirty();
+}
+
+bool WS2812::show()
+{
+    bool result = false;
+
+    if (true == isDeviceOpen())
+    {
+        if (true == mHasChanges)
+        {
+            for (size_t word = 0 ; word < mDirtyMask.size(); ++word)
+            {
+                uint64_t mask = mDirtyMask[word];
+
+                while (0 != mask)
+                {
+                    encodePixel(word * 64 + __builtin_ctzll(mask));
+                    mask &= mask - 1;// clear lowest set bit
+                }
+
+                mDirtyMask[word] = 0;
+            }
+
+            mHasChanges = false;
+        }
+
+        const size_t chunkSize = getMaxMessageSize();
+
+        result = true;
+
+        for (size_t offset = 0 ; (offset < mSymbols.size()) && (true == result); offset += chunkSize)
+        {
+            result = transfer(mSymbols.data() + offset, nullptr, std::min(chunkSize, mSymbols.size() - offset));
+        }
+    }
+
+    return result;
+}
+
+void WS2812::markDirty(const size_t index)
+{
+    mDirtyMask[index / 64] |= (1ULL << (index % 64));
+    mHasChanges = true;
+}
+
+void WS2812::markAllDirty()
+{
+    std::fill(mDirtyMask.begin(), mDirtyMask.end(), ~0ULL);
+
+    // don't encode pixels past the end of the strip
+    if ((mPixels.size() % 64) > 0)
+    {
+        mDirtyMask.back() = (1ULL << (mPixels.size() % 64)) - 1;
+    }
+
+    mHasChanges = (false == mPixels.empty());
+}
+
+void WS2812::encodePixel(const size_t index)
+{
+    const uint32_t color = mPixels[index];
+    // wire order is G, R, B (W)
+    const uint8_t channels[4] = {static_cast<uint8_t>(GET_BYTE1(color)),
+                                 static_cast<uint8_t>(GET_BYTE2(color)),
+                                 static_cast<uint8_t>(GET_BYTE0(color)),
+                                 static_cast<uint8_t>(GET_BYTE3(color))};
+    byte* out = mSymbols.data() + index * mChannelsCount * SYMBOL_BYTES_PER_COLOR;
+
+    for (size_t i = 0 ; i < mChannelsCount; ++i)
+    {
+        memcpy(out, sSymbolsTable.symbols[mBrightnessTable[channels[i]]], SYMBOL_BYTES_PER_COLOR);
+        out += SYMBOL_BYTES_PER_COLOR;
+    }
+}
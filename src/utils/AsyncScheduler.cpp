@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "utils/AsyncScheduler.hpp"
+#include "GenericDevice.hpp"
+#include <algorithm>
+#include <chrono>
+
+void AsyncScheduler::post(const AsyncCallback_t& callback)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mQueue.push_back(callback);
+    mWakeUp.notify_one();
+}
+
+void AsyncScheduler::postAt(const struct timespec& deadline, const AsyncCallback_t& callback)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mTimers.push_back({deadline, mTimersSequence++, callback});
+    std::push_heap(mTimers.begin(), mTimers.end(), &AsyncScheduler::isLater);
+    mWakeUp.notify_one();
+}
+
+void AsyncScheduler::postAfter(const unsigned int milliseconds, const AsyncCallback_t& callback)
+{
+    postAt(GenericDevice::addNanoseconds(GenericDevice::getMonotonicTime(), milliseconds * 1000000ULL), callback);
+}
+
+void AsyncScheduler::retainTask()
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    ++mActiveTasks;
+}
+
+void AsyncScheduler::releaseTask()
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    if (mActiveTasks > 0)
+    {
+        --mActiveTasks;
+    }
+
+    mWakeUp.notify_one();
+}
+
+void AsyncScheduler::run()
+{
+    std::unique_lock<std::mutex> lock(mSync);
+
+    mStopRequested = false;
+
+    while (false == mStopRequested)
+    {
+        const struct timespec now = GenericDevice::getMonotonicTime();
+
+        // move expired timers to the queue
+        while ((false == mTimers.empty()) && (GenericDevice::diffNanoseconds(now, mTimers.front().deadline) >= 0))
+        {
+            std::pop_heap(mTimers.begin(), mTimers.end(), &AsyncScheduler::isLater);
+            mQueue.push_back(std::move(mTimers.back().callback));
+            mTimers.pop_back();
+        }
+
+        if (false == mQueue.empty())
+        {
+            AsyncCallback_t callback = std::move(mQueue.front());
+
+            mQueue.pop_front();
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+        else if (false == mTimers.empty())
+        {
+            mWakeUp.wait_for(lock, std::chrono::nanoseconds(GenericDevice::diffNanoseconds(mTimers.front().deadline, now)));
+        }
+        else if (mActiveTasks > 0)
+        {
+            mWakeUp.wait(lock);
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+void AsyncScheduler::stop()
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    mStopRequested = true;
+    mWakeUp.notify_one();
+}
+
+bool AsyncScheduler::isLater(const TimedCallback& left, const TimedCallback& right)
+{
+    const int64_t diff = GenericDevice::diffNanoseconds(left.deadline, right.deadline);
+
+    return (diff > 0) || ((0 == diff) && (left.sequence > right.sequence));
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "utils/ThreadPolicy.hpp"
+#include <utils/logging.hpp>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "ThreadPolicyManager"
+
+#define THREAD_TYPES_COUNT                  (static_cast<int>(HwioThread::COUNT))
+// stack left untouched by prefaulting (guard page, frames of the caller, signal handlers)
+#define STACK_PREFAULT_SAFETY_MARGIN        (64 * 1024)
+
+static std::mutex sSync;
+static ThreadPolicy sDefaultPolicy;
+static ThreadPolicy sPolicies[THREAD_TYPES_COUNT];
+static bool sHasPolicy[THREAD_TYPES_COUNT] = {false};
+static ThreadPolicyStatus sLastStatus[THREAD_TYPES_COUNT];
+static std::vector<std::pair<HwioThread, pthread_t>> sRunningThreads;
+static bool sMemoryLocked = false;
+
+// touches stack pages so they are mapped before time critical code runs
+static void __attribute__((noinline)) prefaultStack(const size_t size)
+{
+    volatile char* stack = static_cast<volatile char*>(alloca(size));
+    const long pageSize = sysconf(_SC_PAGESIZE);
+
+    for (size_t i = 0 ; i < size; i += (pageSize > 0 ? pageSize : 4096))
+    {
+        stack[i] = 0;
+    }
+}
+
+// returns amount of stack (in bytes) which can be safely allocated by the calling thread (0 - unknown)
+static size_t getAvailableStackSize()
+{
+    size_t available = 0;
+    pthread_attr_t attr;
+
+    if (0 == pthread_getattr_np(pthread_self(), &attr))
+    {
+        void* stackAddr = nullptr;
+        size_t stackSize = 0;
+
+        if (0 == pthread_attr_getstack(&attr, &stackAddr, &stackSize))
+        {
+            // stack grows down from stackAddr + stackSize
+            const char marker = 0;
+            const uintptr_t stackBottom = reinterpret_cast<uintptr_t>(stackAddr);
+            const uintptr_t stackPosition = reinterpret_cast<uintptr_t>(&marker);
+
+            if (stackPosition > (stackBottom + STACK_PREFAULT_SAFETY_MARGIN))
+            {
+                available = stackPosition - stackBottom - STACK_PREFAULT_SAFETY_MARGIN;
+            }
+        }
+
+        pthread_attr_destroy(&attr);
+    }
+
+    return available;
+}
+
+void ThreadPolicyManager::setDefaultPolicy(const ThreadPolicy& policy)
+{
+    TRACE_CALL_DEBUG_ARGS("scheduling=%d, priority=%d", SC2INT(policy.scheduling), policy.priority);
+    std::lock_guard<std::mutex> lock(sSync);
+
+    sDefaultPolicy = policy;
+    applyToRunningThreads();
+}
+
+void ThreadPolicyManager::setPolicy(const HwioThread type, const ThreadPolicy& policy)
+{
+    TRACE_CALL_DEBUG_ARGS("type=%d, scheduling=%d, priority=%d", SC2INT(type), SC2INT(policy.scheduling), policy.priority);
+
+    if (type < HwioThread::COUNT)
+    {
+        std::lock_guard<std::mutex> lock(sSync);
+
+        sPolicies[SC2INT(type)] = policy;
+        sHasPolicy[SC2INT(type)] = true;
+        applyToRunningThreads();
+    }
+}
+
+void ThreadPolicyManager::resetPolicy(const HwioThread type)
+{
+    if (type < HwioThread::COUNT)
+    {
+        std::lock_guard<std::mutex> lock(sSync);
+
+        sPolicies[SC2INT(type)] = ThreadPolicy();
+        sHasPolicy[SC2INT(type)] = false;
+        applyToRunningThreads();
+    }
+}
+
+ThreadPolicy ThreadPolicyManager::getPolicy(const HwioThread type)
+{
+    std::lock_guard<std::mutex> lock(sSync);
+
+    return getPolicyLocked(type);
+}
+
+ThreadPolicyStatus ThreadPolicyManager::getLastStatus(const HwioThread type)
+{
+    std::lock_guard<std::mutex> lock(sSync);
+    ThreadPolicyStatus status;
+
+    if (type < HwioThread::COUNT)
+    {
+        status = sLastStatus[SC2INT(type)];
+    }
+
+    return status;
+}
+
+ThreadPolicyStatus ThreadPolicyManager::onThreadStarted(const HwioThread type)
+{
+    TRACE_CALL_DEBUG_ARGS("type=%d", SC2INT(type));
+    std::lock_guard<std::mutex> lock(sSync);
+    const pthread_t self = pthread_self();
+
+    sRunningThreads.emplace_back(type, self);
+
+    return applyPolicy(type, self, true);
+}
+
+void ThreadPolicyManager::onThreadFinished(const HwioThread type)
+{
+    TRACE_CALL_DEBUG_ARGS("type=%d", SC2INT(type));
+    std::lock_guard<std::mutex> lock(sSync);
+    const pthread_t self = pthread_self();
+
+    sRunningThreads.erase(std::remove_if(sRunningThreads.begin(),
+                                         sRunningThreads.end(),
+                                         [&](const std::pair<HwioThread, pthread_t>& item)
+                                         {
+                                             return (item.first == type) && (0 != pthread_equal(item.second, self));
+                                         }),
+                          sRunningThreads.end());
+}
+
+const ThreadPolicy& ThreadPolicyManager::getPolicyLocked(const HwioThread type)
+{
+    if ((type < HwioThread::COUNT) && (true == sHasPolicy[SC2INT(type)]))
+    {
+        return sPolicies[SC2INT(type)];
+    }
+
+    return sDefaultPolicy;
+}
+
+ThreadPolicyStatus ThreadPolicyManager::applyPolicy(const HwioThread type, const pthread_t thread, const bool isStarting)
+{
+    const ThreadPolicy& policy = getPolicyLocked(type);
+    ThreadPolicyStatus status;
+
+    if (ThreadSchedPolicy::DEFAULT != policy.scheduling)
+    {
+        struct sched_param param;
+        int schedPolicy = SCHED_OTHER;
+
+        memset(&param, 0, sizeof(param));
+
+        if (ThreadSchedPolicy::FIFO == policy.scheduling)
+        {
+            schedPolicy = SCHED_FIFO;
+            param.sched_priority = policy.priority;
+        }
+        else if (ThreadSchedPolicy::RR == policy.scheduling)
+        {
+            schedPolicy = SCHED_RR;
+            param.sched_priority = policy.priority;
+        }
+
+        status.schedulingError = pthread_setschedparam(thread, schedPolicy, &param);
+        status.schedulingApplied = (0 == status.schedulingError);
+
+        if (false == status.schedulingApplied)
+        {
+            TRACE_ERROR("failed to set scheduling policy %d (priority=%d) for thread type %d: %s",
+                        schedPolicy, policy.priority, SC2INT(type), strerror(status.schedulingError));
+        }
+    }
+
+    if (false == policy.cpuAffinity.empty())
+    {
+        cpu_set_t cpus;
+
+        CPU_ZERO(&cpus);
+
+        for (const int cpu: policy.cpuAffinity)
+        {
+            if ((cpu >= 0) && (cpu < CPU_SETSIZE))
+            {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+
+        status.affinityError = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+        status.affinityApplied = (0 == status.affinityError);
+
+        if (false == status.affinityApplied)
+        {
+            TRACE_ERROR("failed to set CPU affinity for thread type %d: %s", SC2INT(type), strerror(status.affinityError));
+        }
+    }
+
+    if (true == policy.lockMemory)
+    {
+        if (false == sMemoryLocked)
+        {
+            if (0 == mlockall(MCL_CURRENT | MCL_FUTURE))
+            {
+                sMemoryLocked = true;
+            }
+            else
+            {
+                status.memoryLockError = errno;
+                TRACE_ERROR("mlockall failed: %s", strerror(status.memoryLockError));
+            }
+        }
+
+        status.memoryLocked = sMemoryLocked;
+    }
+
+    // stack can only be prefaulted by the thread itself
+    if ((true == isStarting) && (policy.stackPrefaultSize > 0))
+    {
+        const size_t availableStack = getAvailableStackSize();
+
+        status.stackPrefaultedSize = std::min(policy.stackPrefaultSize, availableStack);
+        status.stackPrefaultClamped = (status.stackPrefaultedSize < policy.stackPrefaultSize);
+
+        if (true == status.stackPrefaultClamped)
+        {
+            TRACE_ERROR("stack prefault size for thread type %d reduced from %lu to %lu bytes",
+                        SC2INT(type), policy.stackPrefaultSize, status.stackPrefaultedSize);
+        }
+
+        if (status.stackPrefaultedSize > 0)
+        {
+            prefaultStack(status.stackPrefaultedSize);
+            status.stackPrefaulted = true;
+        }
+    }
+    else if (type < HwioThread::COUNT)
+    {
+        status.stackPrefaulted = sLastStatus[SC2INT(type)].stackPrefaulted;
+        status.stackPrefaultClamped = sLastStatus[SC2INT(type)].stackPrefaultClamped;
+        status.stackPrefaultedSize = sLastStatus[SC2INT(type)].stackPrefaultedSize;
+    }
+
+    if (type < HwioThread::COUNT)
+    {
+        sLastStatus[SC2INT(type)] = status;
+    }
+
+    return status;
+}
+
+void ThreadPolicyManager::applyToRunningThreads()
+{
+    for (const auto& curThread: sRunningThreads)
+    {
+        applyPolicy(curThread.first, curThread.second, false);
+    }
+}
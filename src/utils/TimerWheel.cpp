@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2022 Igor Krechetov
+ * Distributed under MIT License. See file LICENSE for details (http://www.opensource.org/licenses/MIT)
+ */
+#include "utils/TimerWheel.hpp"
+#include "utils/ThreadPolicy.hpp"
+#include <utils/logging.hpp>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+
+#undef TRACE_CLASS
+#define TRACE_CLASS                         "TimerWheel"
+
+#define WHEEL_LEVELS                        (4)
+#define WHEEL_SLOT_BITS                     (6)
+#define WHEEL_SLOTS                         (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK                     (WHEEL_SLOTS - 1)
+
+#define WHEEL_SLOT_INDEX(_level, _slot)     ((_level) * WHEEL_SLOTS + (_slot))
+#define WHEEL_LEVEL_SLOT(_tick, _level)     (((_tick) >> ((_level) * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK)
+
+TimerWheel::TimerWheel(const unsigned int tickUs)
+    : mTickUs(tickUs > 0 ? tickUs : TIMERWHEEL_DEFAULT_TICK_US)
+    , mSlots(WHEEL_LEVELS * WHEEL_SLOTS, -1)
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+    stop();
+}
+
+TimerWheel& TimerWheel::getInstance()
+{
+    static TimerWheel sInstance;
+    static std::once_flag sStartFlag;
+
+    std::call_once(sStartFlag, [&](){ sInstance.start(); });
+
+    return sInstance;
+}
+
+bool TimerWheel::start()
+{
+    TRACE_CALL_DEBUG();
+    std::lock_guard<std::mutex> lock(mSync);
+
+    if (false == mIsRunning)
+    {
+        mTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+        if (mTimerFD >= 0)
+        {
+            mIsRunning = true;
+            mThread = std::thread(&TimerWheel::threadTimer, this);
+            mThreadID = mThread.get_id();
+
+            if (mActiveTimers > 0)
+            {
+                armTimer(true);
+            }
+        }
+        else
+        {
+            TRACE_ERROR("timerfd_create failed");
+            mTimerFD = -1;
+        }
+    }
+
+    return mIsRunning;
+}
+
+void TimerWheel::stop()
+{
+    TRACE_CALL_DEBUG();
+    bool needJoin = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+
+        if (true == mIsRunning)
+        {
+            struct itimerspec wakeup = {{0, 0}, {0, 1}};
+
+            mIsRunning = false;
+            // wake up timer thread
+            timerfd_settime(mTimerFD, 0, &wakeup, nullptr);
+            needJoin = true;
+        }
+    }
+
+    if ((true == needJoin) && (true == mThread.joinable()))
+    {
+        mThread.join();
+        close(mTimerFD);
+        mTimerFD = -1;
+        mIsArmed = false;
+    }
+}
+
+TimerID_t TimerWheel::startTimer(const unsigned int delayMs, const TimerCallback_t& callback, const unsigned int periodMs)
+{
+    TRACE_CALL_DEBUG_ARGS("delayMs=%u, periodMs=%u", delayMs, periodMs);
+    TimerID_t id = INVALID_TIMER_ID;
+
+    if (callback)
+    {
+        std::lock_guard<std::mutex> lock(mSync);
+        const int index = allocateNode();
+        TimerNode& node = mNodes[index];
+        const uint64_t delayTicks = msToTicks(delayMs);
+
+        node.callback = callback;
+        node.expireTick = mCurrentTick + (delayTicks > 0 ? delayTicks : 1);
+        node.periodTicks = (periodMs > 0 ? static_cast<uint32_t>(std::max<uint64_t>(msToTicks(periodMs), 1)) : 0);
+        insertNode(index);
+
+        id = (static_cast<TimerID_t>(node.generation) << 32) | static_cast<TimerID_t>(index);
+
+        if ((true == mIsRunning) && (false == mIsArmed))
+        {
+            armTimer(true);
+        }
+    }
+
+    return id;
+}
+
+bool TimerWheel::cancelTimer(const TimerID_t id)
+{
+    std::unique_lock<std::mutex> lock(mSync);
+    bool result = false;
+    const int index = findNode(id);
+
+    if (index >= 0)
+    {
+        unlinkNode(index);
+        result = true;
+
+        if (id == mRunningTimer)
+        {
+            // node will be released by timer thread after callback returns
+            if (std::this_thread::get_id() != mThreadID)
+            {
+                mCallbackDone.wait(lock, [&](){ return id != mRunningTimer; });
+            }
+        }
+        else
+        {
+            releaseNode(index);
+        }
+    }
+
+    return result;
+}
+
+bool TimerWheel::isTimerActive(const TimerID_t id)
+{
+    std::lock_guard<std::mutex> lock(mSync);
+    const int index = findNode(id);
+
+    return (index >= 0) && ((mNodes[index].slot >= 0) || (id == mRunningTimer));
+}
+
+size_t TimerWheel::getActiveTimersCount()
+{
+    std::lock_guard<std::mutex> lock(mSync);
+
+    return mActiveTimers;
+}
+
+void TimerWheel::threadTimer()
+{
+    TRACE_CALL();
+    ThreadPolicyManager::onThreadStarted(HwioThread::TIMER_WHEEL);
+
+    while (true)
+    {
+        uint64_t expirations = 0;
+        const ssize_t bytesRead = read(mTimerFD, &expirations, sizeof(expirations));
+        std::unique_lock<std::mutex> lock(mSync);
+
+        if (false == mIsRunning)
+        {
+            break;
+        }
+
+        if (sizeof(expirations) == bytesRead)
+        {
+            // NOTE: if thread was delayed, process all missed ticks
+            for (uint64_t i = 0 ; (i < expirations) && (true == mIsRunning); ++i)
+            {
+                processTick(lock);
+            }
+        }
+
+        if ((0 == mActiveTimers) && (true == mIsArmed) && (true == mIsRunning))
+        {
+            armTimer(false);
+        }
+    }
+
+    ThreadPolicyManager::onThreadFinished(HwioThread::TIMER_WHEEL);
+}
+
+void TimerWheel::processTick(std::unique_lock<std::mutex>& lock)
+{
+    ++mCurrentTick;
+
+    // cascade timers from higher levels when lower level wraps around
+    for (int level = 1 ; (level < WHEEL_LEVELS) && (0 == WHEEL_LEVEL_SLOT(mCurrentTick, level - 1)); ++level)
+    {
+        cascade(level);
+    }
+
+    const int slotIndex = WHEEL_SLOT_INDEX(0, WHEEL_LEVEL_SLOT(mCurrentTick, 0));
+
+    mExpiredNodes.clear();
+
+    while (mSlots[slotIndex] >= 0)
+    {
+        const int index = mSlots[slotIndex];
+
+        unlinkNode(index);
+        mExpiredNodes.push_back((static_cast<TimerID_t>(mNodes[index].generation) << 32) | static_cast<TimerID_t>(index));
+    }
+
+    for (const TimerID_t id: mExpiredNodes)
+    {
+        // timer could have been canceled while callback of another expired timer was running
+        const int index = findNode(id);
+
+        if (index >= 0)
+        {
+            TimerNode& node = mNodes[index];
+
+            if (node.periodTicks > 0)
+            {
+                node.expireTick += node.periodTicks;
+                insertNode(index);
+            }
+
+            mRunningTimer = id;
+            lock.unlock();
+            node.callback();
+            lock.lock();
+            mRunningTimer = INVALID_TIMER_ID;
+            mCallbackDone.notify_all();
+
+            // one-shot timers and timers canceled during callback
+            if (node.slot < 0)
+            {
+                releaseNode(index);
+            }
+        }
+    }
+}
+
+void TimerWheel::cascade(const int level)
+{
+    const int slotIndex = WHEEL_SLOT_INDEX(level, WHEEL_LEVEL_SLOT(mCurrentTick, level));
+    int index = mSlots[slotIndex];
+
+    mSlots[slotIndex] = -1;
+
+    while (index >= 0)
+    {
+        const int nextIndex = mNodes[index].next;
+
+        mNodes[index].slot = -1;
+        insertNode(index);
+        index = nextIndex;
+    }
+}
+
+void TimerWheel::insertNode(const int index)
+{
+    TimerNode& node = mNodes[index];
+    const uint64_t delta = (node.expireTick > mCurrentTick ? node.expireTick - mCurrentTick : 0);
+    int slotIndex = -1;
+
+    if (node.expireTick < mCurrentTick)
+    {
+        node.expireTick = mCurrentTick;
+    }
+
+    for (int level = 0 ; level < WHEEL_LEVELS; ++level)
+    {
+        if (delta < (static_cast<uint64_t>(1) << ((level + 1) * WHEEL_SLOT_BITS)))
+        {
+            slotIndex = WHEEL_SLOT_INDEX(level, WHEEL_LEVEL_SLOT(node.expireTick, level));
+            break;
+        }
+    }
+
+    if (slotIndex < 0)
+    {
+        // timer is out of wheel range. put it to the farthest slot so it's rescheduled later
+        const int topLevel = WHEEL_LEVELS - 1;
+
+        slotIndex = WHEEL_SLOT_INDEX(topLevel, (WHEEL_LEVEL_SLOT(mCurrentTick, topLevel) + WHEEL_SLOT_MASK) & WHEEL_SLOT_MASK);
+    }
+
+    node.slot = slotIndex;
+    node.prev = -1;
+    node.next = mSlots[slotIndex];
+
+    if (node.next >= 0)
+    {
+        mNodes[node.next].prev = index;
+    }
+
+    mSlots[slotIndex] = index;
+}
+
+void TimerWheel::unlinkNode(const int index)
+{
+    TimerNode& node = mNodes[index];
+
+    if (node.slot >= 0)
+    {
+        if (node.prev >= 0)
+        {
+            mNodes[node.prev].next = node.next;
+        }
+        else
+        {
+            mSlots[node.slot] = node.next;
+        }
+
+        if (node.next >= 0)
+        {
+            mNodes[node.next].prev = node.prev;
+        }
+
+        node.prev = -1;
+        node.next = -1;
+        node.slot = -1;
+    }
+}
+
+int TimerWheel::allocateNode()
+{
+    int index = mFreeNodes;
+
+    if (index >= 0)
+    {
+        mFreeNodes = mNodes[index].next;
+        mNodes[index].next = -1;
+    }
+    else
+    {
+        index = mNodes.size();
+        mNodes.emplace_back();
+    }
+
+    ++mActiveTimers;
+    return index;
+}
+
+void TimerWheel::releaseNode(const int index)
+{
+    TimerNode& node = mNodes[index];
+
+    node.callback = nullptr;
+    node.periodTicks = 0;
+    // invalidate all existing IDs of this node
+    node.generation = (node.generation + 1 > 0 ? node.generation + 1 : 1);
+    node.slot = -1;
+    node.prev = -1;
+    node.next = mFreeNodes;
+    mFreeNodes = index;
+    --mActiveTimers;
+}
+
+int TimerWheel::findNode(const TimerID_t id) const
+{
+    int result = -1;
+    const uint64_t index = (id & 0xFFFFFFFF);
+
+    if ((index < mNodes.size()) && (mNodes[index].generation == static_cast<uint32_t>(id >> 32)) && (mNodes[index].callback))
+    {
+        result = static_cast<int>(index);
+    }
+
+    return result;
+}
+
+uint64_t TimerWheel::msToTicks(const unsigned int milliseconds) const
+{
+    return (static_cast<uint64_t>(milliseconds) * 1000 + mTickUs - 1) / mTickUs;
+}
+
+void TimerWheel::armTimer(const bool enable)
+{
+    struct itimerspec spec = {{0, 0}, {0, 0}};
+
+    if (true == enable)
+    {
+        spec.it_interval.tv_sec = mTickUs / 1000000;
+        spec.it_interval.tv_nsec = (mTickUs % 1000000) * 1000;
+        spec.it_value = spec.it_interval;
+    }
+
+    if (0 == timerfd_settime(mTimerFD, 0, &spec, nullptr))
+    {
+        mIsArmed = enable;
+    }
+    else
+    {
+        TRACE_ERROR("timerfd_settime failed");
+    }
+}